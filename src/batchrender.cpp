@@ -0,0 +1,367 @@
+// Headless renderer: turns .pxz drawings into images without creating any windows.
+//
+//   batchrender [options] <file.pxz | directory>...
+
+#include <wx/init.h>
+#include <wx/cmdline.h>
+#include <wx/dir.h>
+#include <wx/filename.h>
+#include <wx/wfstream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <vector>
+
+#include "xmlserializer.h"
+#include "canvas/objectspace.h"
+#include "rendering/tiledexporter.h"
+#include "rendering/svgexporter.h"
+#include "utils/threadpool.h"
+#include "utils/trace.h"
+
+namespace
+{
+    constexpr long MaxOutputSize = 100000;
+
+    enum class OutputFormat
+    {
+        Png,
+        Svg
+    };
+
+    struct BatchSettings
+    {
+        wxString outputDirectory; // empty = next to each input
+        OutputFormat format{OutputFormat::Png};
+
+        int width{1024};
+        int height{0}; // 0 = follow the drawing's aspect ratio
+        double margin{16};
+        unsigned threadsPerFile{1};
+    };
+
+    struct FileResult
+    {
+        wxString output;
+        bool succeeded{false};
+        wxString error;
+
+        double loadMs{0};
+        double renderMs{0};
+    };
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    wxString GetExtension(OutputFormat format)
+    {
+        switch (format)
+        {
+        case OutputFormat::Svg:
+            return "svg";
+        case OutputFormat::Png:
+        default:
+            return "png";
+        }
+    }
+
+    wxRect2DDouble GetDrawingBounds(const std::vector<CanvasObject> &objects)
+    {
+        return objects.empty() ? wxRect2DDouble(0, 0, 1, 1) : ObjectSpace::GetWorldBounds(objects);
+    }
+
+    // Fits the drawing's bounds (plus margin) into the requested size, keeping the aspect ratio
+    TiledExportSettings GetExportSettings(const std::vector<CanvasObject> &objects, const BatchSettings &settings)
+    {
+        auto area = GetDrawingBounds(objects);
+        area.Inset(-settings.margin, -settings.margin);
+        area.m_width = std::max(area.m_width, 1.0);
+        area.m_height = std::max(area.m_height, 1.0);
+
+        TiledExportSettings exportSettings;
+        exportSettings.outputWidth = settings.width;
+        exportSettings.threadCount = settings.threadsPerFile;
+
+        if (settings.height > 0)
+        {
+            exportSettings.outputHeight = settings.height;
+
+            const double targetAspect = static_cast<double>(settings.width) / settings.height;
+            const auto centre = area.GetCentre();
+
+            if (area.m_width / area.m_height < targetAspect)
+            {
+                area.m_width = area.m_height * targetAspect;
+            }
+            else
+            {
+                area.m_height = area.m_width / targetAspect;
+            }
+
+            area.m_x = centre.m_x - area.m_width / 2;
+            area.m_y = centre.m_y - area.m_height / 2;
+        }
+        else
+        {
+            exportSettings.outputHeight = static_cast<int>(std::clamp(std::lround(settings.width * area.m_height / area.m_width), 1L, MaxOutputSize));
+        }
+
+        exportSettings.sourceArea = area;
+
+        return exportSettings;
+    }
+
+    wxString GetOutputPath(const wxString &input, const BatchSettings &settings)
+    {
+        wxFileName output(input);
+        output.SetExt(GetExtension(settings.format));
+
+        if (!settings.outputDirectory.empty())
+        {
+            output.SetPath(settings.outputDirectory);
+        }
+
+        return output.GetFullPath();
+    }
+
+    FileResult RenderFile(XmlSerializer &serializer, const wxString &input, const BatchSettings &settings)
+    {
+        Trace::Scope scope("RenderFile");
+
+        FileResult result;
+        result.output = GetOutputPath(input, settings);
+
+        auto start = std::chrono::steady_clock::now();
+
+        wxFileInputStream in(input);
+
+        if (!in.IsOk())
+        {
+            result.error = "cannot open the file";
+            return result;
+        }
+
+        EncodedImages images;
+        const auto doc = serializer.DecompressXml(in, images);
+
+        if (!doc.IsOk() || !doc.GetRoot())
+        {
+            result.error = "not a drawing";
+            return result;
+        }
+
+        std::vector<CanvasObject> objects;
+
+        // a malformed drawing fails this file only, not the whole batch
+        try
+        {
+            objects = serializer.DeserializeCanvasObjects(doc, images);
+        }
+        catch (const std::exception &e)
+        {
+            result.error = e.what();
+            return result;
+        }
+
+        result.loadMs = MillisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+
+        wxFileOutputStream out(result.output);
+
+        if (!out.IsOk())
+        {
+            result.error = "cannot create " + result.output;
+            return result;
+        }
+
+        const auto exportSettings = GetExportSettings(objects, settings);
+        bool exported;
+
+        if (settings.format == OutputFormat::Svg)
+        {
+            SvgExportSettings svgSettings;
+            svgSettings.sourceArea = exportSettings.sourceArea;
+            svgSettings.outputWidth = exportSettings.outputWidth;
+            svgSettings.outputHeight = exportSettings.outputHeight;
+
+            exported = SvgExporter::Export(objects, svgSettings, out);
+        }
+        else
+        {
+            exported = TiledExporter::ExportPng(objects, exportSettings, out) == TiledExporter::Result::Done;
+        }
+
+        exported = out.Close() && exported;
+        result.renderMs = MillisecondsSince(start);
+
+        if (!exported)
+        {
+            wxRemoveFile(result.output);
+            result.error = "rendering failed";
+            return result;
+        }
+
+        result.succeeded = true;
+        return result;
+    }
+
+    std::vector<wxString> CollectInputs(const wxCmdLineParser &parser)
+    {
+        std::vector<wxString> inputs;
+
+        for (size_t i = 0; i < parser.GetParamCount(); i++)
+        {
+            const auto param = parser.GetParam(i);
+
+            if (wxDir::Exists(param))
+            {
+                wxArrayString files;
+                wxDir::GetAllFiles(param, &files, "*.pxz");
+                files.Sort();
+
+                inputs.insert(inputs.end(), files.begin(), files.end());
+            }
+            else
+            {
+                inputs.push_back(param);
+            }
+        }
+
+        return inputs;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    wxInitializer initializer(argc, argv);
+
+    if (!initializer.IsOk())
+    {
+        std::fprintf(stderr, "Failed to initialize wxWidgets.\n");
+        return 1;
+    }
+
+    Trace::Initialize();
+
+    static const wxCmdLineEntryDesc commandLine[] = {
+        {wxCMD_LINE_SWITCH, "h", "help", "show this help", wxCMD_LINE_VAL_NONE, wxCMD_LINE_OPTION_HELP},
+        {wxCMD_LINE_OPTION, "o", "output", "output directory (default: next to each input)", wxCMD_LINE_VAL_STRING, 0},
+        {wxCMD_LINE_OPTION, "f", "format", "output format: png or svg (default: png)", wxCMD_LINE_VAL_STRING, 0},
+        {wxCMD_LINE_OPTION, "W", "width", "output width in pixels (default: 1024)", wxCMD_LINE_VAL_NUMBER, 0},
+        {wxCMD_LINE_OPTION, "H", "height", "output height in pixels (default: follows the drawing)", wxCMD_LINE_VAL_NUMBER, 0},
+        {wxCMD_LINE_OPTION, "m", "margin", "margin around the drawing, in drawing units (default: 16)", wxCMD_LINE_VAL_DOUBLE, 0},
+        {wxCMD_LINE_OPTION, "j", "jobs", "number of worker threads (default: one per core)", wxCMD_LINE_VAL_NUMBER, 0},
+        {wxCMD_LINE_PARAM, nullptr, nullptr, "input .pxz files or directories", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_MULTIPLE},
+        wxCMD_LINE_DESC_END};
+
+    wxCmdLineParser parser(commandLine, argc, argv);
+
+    if (parser.Parse() != 0)
+    {
+        return 1;
+    }
+
+    BatchSettings settings;
+    long number;
+    wxString text;
+
+    if (parser.Found("o", &settings.outputDirectory) && !wxDir::Exists(settings.outputDirectory) &&
+        !wxDir::Make(settings.outputDirectory, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL))
+    {
+        std::fprintf(stderr, "Cannot create the output directory %s.\n", settings.outputDirectory.utf8_str().data());
+        return 1;
+    }
+
+    if (parser.Found("f", &text))
+    {
+        if (text.Lower() == "svg")
+        {
+            settings.format = OutputFormat::Svg;
+        }
+        else if (text.Lower() != "png")
+        {
+            std::fprintf(stderr, "Unsupported format %s.\n", text.utf8_str().data());
+            return 1;
+        }
+    }
+
+    if (parser.Found("W", &number))
+    {
+        settings.width = static_cast<int>(std::clamp(number, 1L, MaxOutputSize));
+    }
+
+    if (parser.Found("H", &number))
+    {
+        settings.height = static_cast<int>(std::clamp(number, 1L, MaxOutputSize));
+    }
+
+    parser.Found("m", &settings.margin);
+
+    unsigned threadCount = ThreadPool::DefaultThreadCount();
+
+    if (parser.Found("j", &number))
+    {
+        threadCount = static_cast<unsigned>(std::max(1L, number));
+    }
+
+    const auto inputs = CollectInputs(parser);
+
+    if (inputs.empty())
+    {
+        std::fprintf(stderr, "No .pxz files found.\n");
+        return 1;
+    }
+
+    // few big files still get every core, through the exporter's own tiles
+    settings.threadsPerFile = std::max(1u, threadCount / static_cast<unsigned>(std::min<std::size_t>(inputs.size(), threadCount)));
+
+    // one serializer for all threads: constructing it registers a global file system handler
+    XmlSerializer serializer;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // not the shared pool: a file waits for its tiles, which run there
+    ThreadPool pool(std::min<unsigned>(threadCount, static_cast<unsigned>(inputs.size())));
+    std::vector<std::future<FileResult>> results;
+
+    for (const auto &input : inputs)
+    {
+        results.push_back(pool.Submit([&serializer, &settings, input]
+                                      { return RenderFile(serializer, input, settings); }));
+    }
+
+    int failures = 0;
+
+    for (std::size_t i = 0; i < inputs.size(); i++)
+    {
+        const auto result = results[i].get();
+
+        if (result.succeeded)
+        {
+            std::printf("%s -> %s  (load %.1f ms, render %.1f ms)\n", inputs[i].utf8_str().data(),
+                        result.output.utf8_str().data(), result.loadMs, result.renderMs);
+        }
+        else
+        {
+            failures++;
+            std::fprintf(stderr, "%s: %s\n", inputs[i].utf8_str().data(), result.error.utf8_str().data());
+        }
+    }
+
+    std::printf("%zu file(s), %d failed, %.1f ms total\n", inputs.size(), failures, MillisecondsSince(start));
+
+    if (!Trace::Flush())
+    {
+        std::fprintf(stderr, "Could not write the trace to %s\n", std::getenv(Trace::EnvironmentVariable));
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cmath>
+#include <array>
+
+#include "baking.h"
+#include "canvasobject.h"
+#include "objectspace.h"
+#include "grouping.h"
+#include "../utils/visitor.h"
+
+namespace
+{
+    constexpr double MinPolygonSegmentLength = 2.0;
+    constexpr int MinEllipseSegments = 32;
+    constexpr double ScaleTolerance = 1e-9;
+
+    std::vector<wxPoint2DDouble> ToScreen(const CanvasObject &object, const std::vector<wxPoint2DDouble> &points)
+    {
+        std::vector<wxPoint2DDouble> result(points.size());
+        ObjectSpace::ToScreenCoordinates(object, points.data(), result.data(), points.size());
+
+        return result;
+    }
+
+    Shape BakeRect(const CanvasObject &object, const Rect &rect)
+    {
+        std::vector<wxPoint2DDouble> corners{rect.rect.GetLeftTop(), rect.rect.GetRightTop(),
+                                             rect.rect.GetRightBottom(), rect.rect.GetLeftBottom()};
+        corners = ToScreen(object, corners);
+
+        if (object.transformation.rotationAngle != 0.0)
+        {
+            return FilledPolygon{corners, rect.color};
+        }
+
+        // negative scales flip the corners, so rebuild the rect from its extremes
+        const auto left = std::min(corners[0].m_x, corners[2].m_x);
+        const auto right = std::max(corners[0].m_x, corners[2].m_x);
+        const auto top = std::min(corners[0].m_y, corners[2].m_y);
+        const auto bottom = std::max(corners[0].m_y, corners[2].m_y);
+
+        return Rect{{left, top, right - left, bottom - top}, rect.color};
+    }
+
+    Shape BakeCircle(const CanvasObject &object, const Circle &circle)
+    {
+        const auto &t = object.transformation;
+        const auto center = ObjectSpace::ToScreenCoordinates(object, circle.center);
+
+        if (std::fabs(t.scaleX) == std::fabs(t.scaleY))
+        {
+            // rotating a circle doesn't change its geometry
+            return Circle{circle.radius * std::fabs(t.scaleX), center, circle.color};
+        }
+
+        const auto largestRadius = circle.radius * std::max(std::fabs(t.scaleX), std::fabs(t.scaleY));
+        const int segments = std::max(MinEllipseSegments, static_cast<int>(std::ceil(2.0 * M_PI * largestRadius / MinPolygonSegmentLength)));
+
+        std::vector<wxPoint2DDouble> points;
+        points.reserve(segments);
+
+        for (int i = 0; i < segments; i++)
+        {
+            const double angle = 2.0 * M_PI * i / segments;
+            points.push_back({circle.center.m_x + circle.radius * std::cos(angle),
+                              circle.center.m_y + circle.radius * std::sin(angle)});
+        }
+
+        return FilledPolygon{ToScreen(object, points), circle.color};
+    }
+
+    Shape BakePath(const CanvasObject &object, const Path &path)
+    {
+        // a stroke can't be scaled non-uniformly, so use the width that preserves its area
+        const auto &t = object.transformation;
+        const auto width = std::max(1, static_cast<int>(std::lround(path.width * std::sqrt(std::fabs(t.scaleX * t.scaleY)))));
+
+        return Path{ToScreen(object, path.points), path.color, width};
+    }
+
+    bool IsUnit(double scale)
+    {
+        return std::fabs(scale - 1.0) < ScaleTolerance;
+    }
+
+    // `parentScale` is the uniform scale of the groups above the object
+    bool BakesExactlyUnder(const CanvasObject &object, double parentScale)
+    {
+        const auto &t = object.transformation;
+        const double scaleX = std::fabs(t.scaleX) * parentScale;
+        const double scaleY = std::fabs(t.scaleY) * parentScale;
+        const bool uniform = std::fabs(scaleX - scaleY) < ScaleTolerance;
+
+        return std::visit(visitor{[&](const Path &path)
+                                  {
+                                      // the baked width is whole, so only a stroke that scales to a whole width keeps its look
+                                      const double width = path.width * scaleX;
+                                      return uniform && width > 0.5 && std::fabs(width - std::round(width)) < ScaleTolerance;
+                                  },
+                                  [&](const Group &group)
+                                  {
+                                      // under a non-uniform scale the children's own rotations turn into skews
+                                      return uniform && std::all_of(group.children.begin(), group.children.end(), [&](const CanvasObject &child)
+                                                                    { return BakesExactlyUnder(child, scaleX); });
+                                  },
+                                  [&](const RasterImage &)
+                                  { return true; },
+                                  [&](const auto &)
+                                  {
+                                      // the 1px outline of fills is drawn in object space and would stop scaling, and
+                                      // ellipses become polygons
+                                      return IsUnit(scaleX) && IsUnit(scaleY);
+                                  }},
+                          *object.shape);
+    }
+
+    // Only a move and a positive scale fold into the image's rect; anything else would need resampling
+    bool CanBakeImage(const Transformation &t)
+    {
+        return t.rotationAngle == 0.0 && t.scaleX > 0.0 && t.scaleY > 0.0;
+    }
+
+    Shape BakeImage(const CanvasObject &object, const RasterImage &image)
+    {
+        const auto leftTop = ObjectSpace::ToScreenCoordinates(object, image.rect.GetLeftTop());
+        const auto rightBottom = ObjectSpace::ToScreenCoordinates(object, image.rect.GetRightBottom());
+
+        return RasterImage{image.source, {leftTop.m_x, leftTop.m_y, rightBottom.m_x - leftTop.m_x, rightBottom.m_y - leftTop.m_y}};
+    }
+}
+
+namespace Baking
+{
+    bool NeedsBaking(const CanvasObject &object)
+    {
+        if (std::holds_alternative<RasterImage>(*object.shape))
+        {
+            return TransformationKinds::Classify(object.transformation) != TransformationKind::Identity && CanBakeImage(object.transformation);
+        }
+
+        if (TransformationKinds::Classify(object.transformation) != TransformationKind::Identity)
+        {
+            return true;
+        }
+
+        const auto group = std::get_if<Group>(object.shape.get());
+        return group && std::any_of(group->children.begin(), group->children.end(), [](const CanvasObject &child)
+                                    { return NeedsBaking(child); });
+    }
+
+    bool BakesExactly(const CanvasObject &object)
+    {
+        return BakesExactlyUnder(object, 1.0);
+    }
+
+    CanvasObject Bake(const CanvasObject &object)
+    {
+        if (!NeedsBaking(object))
+        {
+            return object;
+        }
+
+        Shape baked = std::visit(visitor{[&](const Path &path)
+                                         { return BakePath(object, path); },
+                                         [&](const Rect &rect)
+                                         { return BakeRect(object, rect); },
+                                         [&](const Circle &circle)
+                                         { return BakeCircle(object, circle); },
+                                         [&](const FilledPolygon &polygon)
+                                         { return Shape{FilledPolygon{ToScreen(object, polygon.points), polygon.color}}; },
+                                         [&](const Group &)
+                                         {
+                                             // the group's transformation goes into the children, then theirs into their geometry
+                                             auto children = Grouping::Ungroup(object);
+                                             BakeInPlace(children);
+
+                                             return Shape{Grouping::BuildGroup(std::move(children))};
+                                         },
+                                         [&](const RasterImage &image)
+                                         { return BakeImage(object, image); }},
+                                 *object.shape);
+
+        return CanvasObject{baked};
+    }
+
+    int BakeInPlace(CanvasObject &object)
+    {
+        if (!NeedsBaking(object))
+        {
+            return 0;
+        }
+
+        object = Bake(object);
+        return 1;
+    }
+
+    int BakeInPlace(std::vector<CanvasObject> &objects)
+    {
+        int count = 0;
+        for (auto &object : objects)
+        {
+            count += BakeInPlace(object);
+        }
+
+        return count;
+    }
+}
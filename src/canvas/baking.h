@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+struct CanvasObject;
+
+// Applies an object's Transformation to its geometry and resets the transformation to identity,
+// so the object takes the cheapest draw and hit-test path from then on.
+// Rotated or non-uniformly scaled Rects and Circles can't stay what they are and become FilledPolygons.
+// Groups pass their transformation down and bake their children. Images only bake moves and positive
+// scales; rotated or mirrored ones keep their transformation rather than be resampled.
+namespace Baking
+{
+    bool NeedsBaking(const CanvasObject &object);
+
+    // False if baking would change how the object looks. Only images, unscaled fills and strokes that
+    // scale uniformly to a whole width come out the same: a fill's outline is one unit wide before the
+    // scale, and a Path's width is a whole number afterwards.
+    bool BakesExactly(const CanvasObject &object);
+
+    CanvasObject Bake(const CanvasObject &object);
+
+    // Bakes in place, so references to the objects (e.g. the selection) stay valid.
+    // Returns the number of objects that changed.
+    int BakeInPlace(CanvasObject &object);
+    int BakeInPlace(std::vector<CanvasObject> &objects);
+}
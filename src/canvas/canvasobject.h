@@ -1,27 +1,56 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
 #include "../shapes/shape.h"
 #include "../shapes/shapeutils.h"
 #include "../transforms/transformation.h"
+#include "../transforms/transformationkind.h"
 #include "drawingvisitor.h"
 #include "objectspace.h"
 
 struct CanvasObject
 {
-    CanvasObject(const Shape &shape, Transformation transformation = {})
-        : shape{shape}, boundingBox{ShapeUtils::CalculateBoundingBox(shape)}, transformation{transformation} {}
+    CanvasObject(Shape shape, Transformation transformation = {})
+        : CanvasObject(std::make_shared<const Shape>(std::move(shape)), transformation) {}
+
+    CanvasObject(std::shared_ptr<const Shape> shape, Transformation transformation = {})
+        : shape{std::move(shape)}, boundingBox{ShapeUtils::CalculateBoundingBox(*this->shape)}, transformation{transformation}, id{NewId()} {}
 
-    void Draw(wxGraphicsContext &gc) const
+    void Draw(wxGraphicsContext &gc, const DrawingOptions &options = {}) const
     {
         gc.PushState();
 
-        gc.SetTransform(gc.CreateMatrix(ObjectSpace::GetTransformationMatrix(*this)));
-        std::visit(DrawingVisitor{gc}, shape);
+        TransformationKinds::Dispatch(transformation, [&](auto kind)
+                                      { TransformationPath<decltype(kind)::value>::Apply(gc, transformation, boundingBox.GetCentre()); });
+        std::visit(DrawingVisitor{gc, options}, *shape);
 
         gc.PopState();
     }
 
-    const Shape shape;
-    const wxRect2DDouble boundingBox;
+    // Never modified once built, so copies (instances) share it and differ only in their transformation.
+    // An edit of the geometry builds a new object.
+    std::shared_ptr<const Shape> shape;
+    wxRect2DDouble boundingBox;
     Transformation transformation;
+
+    // Identifies the geometry for caches: copies keep it, newly constructed objects get a fresh one
+    std::uint64_t id;
+
+private:
+    static std::uint64_t NewId()
+    {
+        static std::atomic<std::uint64_t> nextId{1};
+        return nextId++;
+    }
 };
+
+inline void DrawingVisitor::operator()(const Group &obj)
+{
+    for (const auto &child : obj.children)
+    {
+        child.Draw(gc, options);
+    }
+}
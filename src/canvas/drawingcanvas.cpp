@@ -1,27 +1,62 @@
 #include <wx/graphics.h>
 #include <wx/dcbuffer.h>
+#include <wx/display.h>
+#include <wx/filefn.h>
+#include <wx/numdlg.h>
+#include <wx/progdlg.h>
+#include <wx/wfstream.h>
 #include "drawingcanvas.h"
+#include "../myapp.h"
+#include "../rendering/tiledexporter.h"
+#include "../rendering/svgexporter.h"
+#include "../utils/trace.h"
 
 DrawingCanvas::DrawingCanvas(wxWindow *parent, DrawingView *view, wxWindowID id, const wxPoint &pos, const wxSize &size)
-    : wxWindow(parent, id, pos, size), view(view)
+    : wxWindow(parent, id, pos, size), view(view), frameTimer(this), refineTimer(this)
 {
     this->SetBackgroundStyle(wxBG_STYLE_PAINT);
 
+    constexpr int FallbackRefreshRate = 60;
+    const int displayRefreshRate = wxDisplay(this).GetCurrentMode().GetRefresh();
+    frameIntervalMs = 1000 / (displayRefreshRate > 0 ? displayRefreshRate : FallbackRefreshRate);
+
     this->Bind(wxEVT_PAINT, &DrawingCanvas::OnPaint, this);
     this->Bind(wxEVT_LEFT_DOWN, &DrawingCanvas::OnMouseDown, this);
     this->Bind(wxEVT_MOTION, &DrawingCanvas::OnMouseMove, this);
     this->Bind(wxEVT_LEFT_UP, &DrawingCanvas::OnMouseUp, this);
     this->Bind(wxEVT_LEAVE_WINDOW, &DrawingCanvas::OnMouseLeave, this);
+    this->Bind(wxEVT_MOUSEWHEEL, &DrawingCanvas::OnMouseWheel, this);
+    this->Bind(wxEVT_MIDDLE_DOWN, &DrawingCanvas::OnMiddleDown, this);
+    this->Bind(wxEVT_MIDDLE_UP, &DrawingCanvas::OnMiddleUp, this);
+    this->Bind(wxEVT_TIMER, &DrawingCanvas::OnFrameTimer, this, frameTimer.GetId());
+    this->Bind(wxEVT_TIMER, &DrawingCanvas::OnRefineTimer, this, refineTimer.GetId());
 
     BuildContextMenu();
 
     this->Bind(wxEVT_CONTEXT_MENU, &DrawingCanvas::OnContextMenuEvent, this);
 }
 
+DrawingCanvas::~DrawingCanvas() noexcept
+{
+    // joins the worker before the window it posts to goes away
+    backgroundRenderer.reset();
+}
+
 void DrawingCanvas::BuildContextMenu()
 {
     auto clear = contextMenu.Append(wxID_ANY, "&Clear");
     auto save = contextMenu.Append(wxID_ANY, "&Export...");
+    auto resetZoom = contextMenu.Append(wxID_ANY, "Reset &Zoom");
+    contextMenu.AppendSeparator();
+    auto bakeSelection = contextMenu.Append(wxID_ANY, "&Bake Selection");
+    auto bakeAll = contextMenu.Append(wxID_ANY, "Bake &All");
+    auto bakeOnSave = contextMenu.AppendCheckItem(wxID_ANY, "Bake on &Save");
+    auto snapToObjects = contextMenu.AppendCheckItem(wxID_ANY, "Snap to O&bjects");
+    auto snapToGrid = contextMenu.AppendCheckItem(wxID_ANY, "Snap to &Grid");
+    auto fastInteraction = contextMenu.AppendCheckItem(wxID_ANY, "&Fast Rendering While Dragging");
+    auto backgroundRendering = contextMenu.AppendCheckItem(wxID_ANY, "&Render in Background");
+    auto tileCaching = contextMenu.AppendCheckItem(wxID_ANY, "Cache Rendered &Tiles");
+    auto spriteCaching = contextMenu.AppendCheckItem(wxID_ANY, "Cache Complex &Objects as Images");
 
     this->Bind(
         wxEVT_MENU,
@@ -39,6 +74,119 @@ void DrawingCanvas::BuildContextMenu()
             this->ShowExportDialog();
         },
         save->GetId());
+
+    this->Bind(
+        wxEVT_MENU,
+        [this](wxCommandEvent &)
+        {
+            this->view->ResetViewport();
+            this->Refresh();
+        },
+        resetZoom->GetId());
+
+    this->Bind(
+        wxEVT_MENU,
+        [this](wxCommandEvent &)
+        {
+            this->view->OnBakeSelection();
+            this->Refresh();
+        },
+        bakeSelection->GetId());
+
+    this->Bind(
+        wxEVT_MENU,
+        [this](wxCommandEvent &)
+        {
+            this->view->OnBakeAll();
+            this->Refresh();
+        },
+        bakeAll->GetId());
+
+    bakeOnSave->Check(MyApp::GetToolSettings().bakeTransformationsOnSave);
+
+    this->Bind(
+        wxEVT_MENU,
+        [](wxCommandEvent &e)
+        {
+            MyApp::GetToolSettings().bakeTransformationsOnSave = e.IsChecked();
+        },
+        bakeOnSave->GetId());
+
+    snapToObjects->Check(MyApp::GetToolSettings().snapToObjects);
+
+    this->Bind(
+        wxEVT_MENU,
+        [](wxCommandEvent &e)
+        {
+            MyApp::GetToolSettings().snapToObjects = e.IsChecked();
+        },
+        snapToObjects->GetId());
+
+    snapToGrid->Check(MyApp::GetToolSettings().snapToGrid);
+
+    this->Bind(
+        wxEVT_MENU,
+        [](wxCommandEvent &e)
+        {
+            MyApp::GetToolSettings().snapToGrid = e.IsChecked();
+        },
+        snapToGrid->GetId());
+
+    fastInteraction->Check(MyApp::GetToolSettings().renderQualityPolicy.enabled);
+
+    this->Bind(
+        wxEVT_MENU,
+        [](wxCommandEvent &e)
+        {
+            MyApp::GetToolSettings().renderQualityPolicy.enabled = e.IsChecked();
+        },
+        fastInteraction->GetId());
+
+    backgroundRendering->Check(MyApp::GetToolSettings().backgroundRendering);
+
+    this->Bind(
+        wxEVT_MENU,
+        [this](wxCommandEvent &e)
+        {
+            MyApp::GetToolSettings().backgroundRendering = e.IsChecked();
+
+            if (!e.IsChecked())
+            {
+                this->backgroundRenderer.reset();
+                this->backgroundBitmap = wxBitmap();
+            }
+
+            this->Refresh();
+        },
+        backgroundRendering->GetId());
+
+    tileCaching->Check(MyApp::GetToolSettings().tileCaching);
+
+    this->Bind(
+        wxEVT_MENU,
+        [this](wxCommandEvent &e)
+        {
+            MyApp::GetToolSettings().tileCaching = e.IsChecked();
+
+            if (!e.IsChecked())
+            {
+                this->tileCache.Clear();
+            }
+
+            this->Refresh();
+        },
+        tileCaching->GetId());
+
+    spriteCaching->Check(MyApp::GetToolSettings().spriteCachePolicy.enabled);
+
+    this->Bind(
+        wxEVT_MENU,
+        [this](wxCommandEvent &e)
+        {
+            MyApp::GetToolSettings().spriteCachePolicy.enabled = e.IsChecked();
+            this->Refresh();
+        },
+        spriteCaching->GetId());
 }
 
 void DrawingCanvas::OnContextMenuEvent(wxContextMenuEvent &e)
@@ -51,31 +199,106 @@ void DrawingCanvas::OnContextMenuEvent(wxContextMenuEvent &e)
 
 void DrawingCanvas::ShowExportDialog()
 {
+    constexpr long MaxExportSize = 100000;
+
     if (view)
     {
         wxFileDialog exportFileDialog(this, _("Export drawing"), "", "",
-                                      "PNG files (*.png)|*.png", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+                                      "PNG files (*.png)|*.png|SVG files (*.svg)|*.svg", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
 
         if (exportFileDialog.ShowModal() == wxID_CANCEL)
             return;
 
-        wxBitmap bitmap(this->GetSize() * this->GetContentScaleFactor());
+        const auto windowSize = this->GetSize();
+        const auto visibleArea = view->GetViewport().ToWorld(wxRect2DDouble(0, 0, windowSize.GetWidth(), windowSize.GetHeight()));
+
+        // the exporters only draw what is in their area, so only that is read back from the cache file
+        const auto restore = [this](const wxRect2DDouble &area)
+        {
+            std::vector<std::size_t> indices;
+            view->GetSpatialIndex().Query(area, indices);
+
+            if (!view->GetDocument()->chunks.Restore(view->GetDocument()->objects, indices))
+            {
+                wxMessageBox(_("Could not export the drawing."), _("Export drawing"), wxOK | wxICON_ERROR, this);
+                return false;
+            }
+
+            return true;
+        };
 
-        wxMemoryDC memDC;
+        if (exportFileDialog.GetFilterIndex() == 1 || exportFileDialog.GetPath().Lower().EndsWith(".svg"))
+        {
+            SvgExportSettings settings;
+            settings.sourceArea = visibleArea;
+            settings.outputWidth = windowSize.GetWidth();
+            settings.outputHeight = windowSize.GetHeight();
 
-        memDC.SetUserScale(this->GetContentScaleFactor(), this->GetContentScaleFactor());
-        memDC.SelectObject(bitmap);
+            if (!restore(settings.sourceArea))
+                return;
 
-        view->OnDraw(&memDC);
+            wxFileOutputStream out(exportFileDialog.GetPath());
 
-        bitmap.SaveFile(exportFileDialog.GetPath(), wxBITMAP_TYPE_PNG);
+            if (!out.IsOk() || !SvgExporter::Export(view->GetDocument()->objects, settings, out) || !out.Close())
+            {
+                wxRemoveFile(exportFileDialog.GetPath());
+                wxMessageBox(_("Could not export the drawing."), _("Export drawing"), wxOK | wxICON_ERROR, this);
+            }
+
+            return;
+        }
+        const int defaultWidth = static_cast<int>(windowSize.GetWidth() * this->GetContentScaleFactor());
+
+        const long outputWidth = wxGetNumberFromUser(_("Width of the exported image in pixels.\nThe height follows the window's aspect ratio."),
+                                                     _("Width:"), _("Export drawing"), defaultWidth, 1, MaxExportSize, this);
+        if (outputWidth <= 0)
+            return;
+
+        TiledExportSettings settings;
+        settings.sourceArea = visibleArea;
+        settings.outputWidth = static_cast<int>(outputWidth);
+        settings.outputHeight = std::max(1, static_cast<int>(std::lround(outputWidth * static_cast<double>(windowSize.GetHeight()) / windowSize.GetWidth())));
+
+        // the tiles take objects up to a pixel outside the area
+        auto restoreArea = settings.sourceArea;
+        restoreArea.Inset(-settings.sourceArea.m_width / outputWidth, -settings.sourceArea.m_width / outputWidth);
+
+        if (!restore(restoreArea))
+            return;
+
+        wxFileOutputStream out(exportFileDialog.GetPath());
+        if (!out.IsOk())
+            return;
+
+        wxProgressDialog progressDialog(_("Export drawing"), _("Rendering..."), 100, this,
+                                        wxPD_CAN_ABORT | wxPD_APP_MODAL | wxPD_AUTO_HIDE | wxPD_ELAPSED_TIME | wxPD_REMAINING_TIME);
+
+        const auto result = TiledExporter::ExportPng(view->GetDocument()->objects, settings, out,
+                                                     [&progressDialog](int finishedTiles, int totalTiles)
+                                                     {
+                                                         return progressDialog.Update(finishedTiles * 100 / totalTiles);
+                                                     });
+        out.Close();
+
+        if (result != TiledExporter::Result::Done)
+        {
+            wxRemoveFile(exportFileDialog.GetPath());
+
+            if (result == TiledExporter::Result::Failed)
+            {
+                wxMessageBox(_("Could not export the drawing."), _("Export drawing"), wxOK | wxICON_ERROR, this);
+            }
+        }
     }
 }
 
 void DrawingCanvas::OnMouseDown(wxMouseEvent &event)
 {
-    view->OnMouseDown(event.GetPosition());
+    Trace::Scope scope("DrawingCanvas::OnMouseDown");
+
+    view->OnMouseDown(event.GetPosition(), event.ShiftDown());
     isDragging = true;
+    NoteInteraction();
     Refresh();
 
     event.Skip(); // For correct focus handling
@@ -83,17 +306,29 @@ void DrawingCanvas::OnMouseDown(wxMouseEvent &event)
 
 void DrawingCanvas::OnMouseMove(wxMouseEvent &event)
 {
-    if (isDragging)
+    Trace::Scope scope("DrawingCanvas::OnMouseMove");
+
+    if (isPanning)
     {
-        view->OnMouseDrag(event.GetPosition());
+        view->PanBy(event.GetPosition() - lastPanPoint);
+        lastPanPoint = event.GetPosition();
         Refresh();
     }
+    else if (isDragging)
+    {
+        pendingDragPoints.push_back(event.GetPosition());
+        NoteInteraction();
+        ScheduleFrame();
+    }
 }
 
 void DrawingCanvas::OnMouseUp(wxMouseEvent &)
 {
+    Trace::Scope scope("DrawingCanvas::OnMouseUp");
+
     if (isDragging)
     {
+        FlushPendingInput();
         isDragging = false;
         view->OnMouseDragEnd();
         Refresh();
@@ -102,26 +337,276 @@ void DrawingCanvas::OnMouseUp(wxMouseEvent &)
 
 void DrawingCanvas::OnMouseLeave(wxMouseEvent &)
 {
+    Trace::Scope scope("DrawingCanvas::OnMouseLeave");
+
+    isPanning = false;
+
     if (isDragging)
     {
+        FlushPendingInput();
         isDragging = false;
         view->OnMouseDragEnd();
         Refresh();
     }
 }
 
+void DrawingCanvas::OnMouseWheel(wxMouseEvent &event)
+{
+    Trace::Scope scope("DrawingCanvas::OnMouseWheel");
+
+    if (view && !isDragging && event.GetWheelRotation() != 0)
+    {
+        constexpr double ZoomStep = 1.1;
+
+        const double notches = static_cast<double>(event.GetWheelRotation()) / event.GetWheelDelta();
+        view->ZoomAt(event.GetPosition(), std::pow(ZoomStep, notches));
+        Refresh();
+    }
+}
+
+void DrawingCanvas::OnMiddleDown(wxMouseEvent &event)
+{
+    if (view && !isDragging)
+    {
+        isPanning = true;
+        lastPanPoint = event.GetPosition();
+    }
+
+    event.Skip();
+}
+
+void DrawingCanvas::OnMiddleUp(wxMouseEvent &)
+{
+    isPanning = false;
+}
+
+void DrawingCanvas::ScheduleFrame()
+{
+    if (!frameTimer.IsRunning())
+    {
+        frameTimer.StartOnce(frameIntervalMs);
+    }
+}
+
+void DrawingCanvas::OnFrameTimer(wxTimerEvent &)
+{
+    if (!pendingDragPoints.empty())
+    {
+        FlushPendingInput();
+        Refresh();
+    }
+}
+
+void DrawingCanvas::NoteInteraction()
+{
+    const auto &policy = MyApp::GetToolSettings().renderQualityPolicy;
+
+    if (view && policy.enabled)
+    {
+        view->SetRenderQuality(RenderQuality::Interactive);
+        refineTimer.StartOnce(policy.refineDelayMs);
+    }
+}
+
+void DrawingCanvas::OnRefineTimer(wxTimerEvent &)
+{
+    if (view && view->GetRenderQuality() != RenderQuality::Full)
+    {
+        view->SetRenderQuality(RenderQuality::Full);
+        Refresh();
+    }
+}
+
+void DrawingCanvas::FlushPendingInput()
+{
+    if (view && !pendingDragPoints.empty())
+    {
+        // moves are batched until the next frame, so this is where dragging spends its time
+        Trace::Scope scope("DrawingCanvas::FlushPendingInput");
+        view->OnMouseDrag(pendingDragPoints);
+    }
+
+    pendingDragPoints.clear();
+}
+
 void DrawingCanvas::OnPaint(wxPaintEvent &)
 {
+    Trace::Scope scope("DrawingCanvas::OnPaint");
+
+    FlushPendingInput();
+
     wxAutoBufferedPaintDC dc(this);
 
     if (view)
     {
-        view->OnDraw(&dc);
+        view->UpdateResidentChunks(this->GetSize());
+
+        if (MyApp::GetToolSettings().backgroundRendering)
+        {
+            PaintFromBackgroundFrame(dc);
+        }
+        else if (MyApp::GetToolSettings().tileCaching)
+        {
+            PaintFromTileCache(dc);
+        }
+        else
+        {
+            view->OnDraw(&dc);
+        }
     }
 }
 
+void DrawingCanvas::RequestBackgroundFrame()
+{
+    if (!backgroundRenderer)
+    {
+        backgroundRenderer = std::make_unique<BackgroundRenderer>([this]
+                                                                  { this->CallAfter([this]
+                                                                                    { this->Refresh(); }); });
+    }
+
+    const auto *document = view->GetDocument();
+    const auto &objects = document->objects;
+    const double scale = this->GetContentScaleFactor();
+
+    BackgroundRenderer::SceneKey key;
+    key.sceneVersion = document->GetSceneVersion();
+    key.rewriteVersion = document->GetRewriteVersion();
+    key.objectCount = objects.size();
+    key.excludedIndices = view->GetExcludedIndices();
+    key.width = std::max(1, static_cast<int>(std::lround(this->GetSize().GetWidth() * scale)));
+    key.height = std::max(1, static_cast<int>(std::lround(this->GetSize().GetHeight() * scale)));
+    key.scale = scale;
+    key.viewport = view->GetViewport();
+
+    if (backgroundRenderer->GetSubmittedKey() != key)
+    {
+        backgroundRenderer->Submit(key, objects);
+    }
+}
+
+void DrawingCanvas::PaintFromBackgroundFrame(wxDC &dc)
+{
+    RequestBackgroundFrame();
+
+    const auto &frame = backgroundRenderer->GetFrontFrame();
+
+    if (backgroundRenderer->AcquireLatestFrame())
+    {
+        // wxImage takes ownership of malloc'ed data, so copy the frame
+        wxImage image(frame->key.width, frame->key.height, const_cast<unsigned char *>(frame->rgb.data()), true);
+        backgroundBitmap = wxBitmap(image.Copy(), -1, frame->key.scale);
+    }
+
+    dc.SetBackground(*wxWHITE_BRUSH);
+    dc.Clear();
+
+    std::unique_ptr<wxGraphicsContext> gc{wxGraphicsContext::CreateFromUnknownDC(dc)};
+
+    if (!gc)
+    {
+        return;
+    }
+
+    const auto *document = view->GetDocument();
+
+    // after a rewrite the frame's indices mean nothing, and it may show deleted objects: until its
+    // replacement arrives, everything is drawn here
+    const bool frameIsCurrent = frame && frame->key.rewriteVersion == document->GetRewriteVersion();
+
+    if (frameIsCurrent && backgroundBitmap.IsOk())
+    {
+        // a frame made for an older viewport is stretched into place until its replacement arrives
+        const auto frameWorldArea = frame->key.viewport.ToWorld(
+            wxRect2DDouble(0, 0, frame->key.width / frame->key.scale, frame->key.height / frame->key.scale));
+        const auto area = view->GetViewport().ToWindow(frameWorldArea);
+
+        gc->DrawBitmap(backgroundBitmap, area.m_x, area.m_y, area.m_width, area.m_height);
+    }
+
+    const auto &objects = document->objects;
+    const auto &selected = view->GetSelectedIndices();
+    const auto &erased = view->GetErasedIndices();
+
+    // objects the frame doesn't show, in z-order; the ones being erased stay hidden
+    std::vector<const CanvasObject *> missing;
+
+    if (!frameIsCurrent)
+    {
+        auto nextErased = erased.begin();
+
+        for (std::size_t i = 0; i < objects.size(); i++)
+        {
+            if (nextErased != erased.end() && *nextErased == i)
+            {
+                ++nextErased;
+                continue;
+            }
+
+            missing.push_back(&objects[i]);
+        }
+    }
+    else
+    {
+        // indices are stable since the frame's snapshot: only appended objects and the exclusions differ
+        const auto &excluded = frame->key.excludedIndices;
+        auto nextExcluded = excluded.begin();
+        auto nextSelected = selected.begin();
+        auto nextErased = erased.begin();
+
+        for (std::size_t i = 0; i < objects.size(); i++)
+        {
+            const bool wasExcluded = nextExcluded != excluded.end() && *nextExcluded == i;
+            const bool isSelected = nextSelected != selected.end() && *nextSelected == i;
+            const bool isErased = nextErased != erased.end() && *nextErased == i;
+
+            nextExcluded += wasExcluded;
+            nextSelected += isSelected;
+            nextErased += isErased;
+
+            if ((i >= frame->key.objectCount || wasExcluded || isSelected) && !isErased)
+            {
+                missing.push_back(&objects[i]);
+            }
+        }
+    }
+
+    view->DrawObjects(*gc, missing, this->GetContentScaleFactor());
+    view->DrawOverlays(*gc);
+}
+
+void DrawingCanvas::PaintFromTileCache(wxDC &dc)
+{
+    dc.SetBackground(*wxWHITE_BRUSH);
+    dc.Clear();
+
+    std::unique_ptr<wxGraphicsContext> gc{wxGraphicsContext::CreateFromUnknownDC(dc)};
+
+    if (!gc)
+    {
+        return;
+    }
+
+    const auto *document = view->GetDocument();
+    const TileCache::Scene scene{document->objects, document->GetSceneVersion(), document->GetRewriteVersion(),
+                                 view->GetExcludedIndices(), view->GetSpatialIndex()};
+
+    tileCache.Draw(*gc, scene, view->GetViewport(), this->GetSize(), this->GetContentScaleFactor());
+
+    // the selection is drawn live, so dragging it never touches the tiles
+    view->DrawObjects(*gc, view->GetSelectedObjects(), this->GetContentScaleFactor());
+
+    view->DrawOverlays(*gc);
+}
+
 void DrawingCanvas::SetView(DrawingView *view)
 {
     this->view = view;
+
+    // cached pixels are keyed by versions of the old view's document
+    backgroundRenderer.reset();
+    backgroundBitmap = wxBitmap();
+    tileCache.Clear();
+
     Refresh();
 }
@@ -1,21 +1,31 @@
 #pragma once
 
 #include <wx/wx.h>
+#include <memory>
 #include <vector>
 
 #include "../drawingview.h"
+#include "../rendering/backgroundrenderer.h"
+#include "../rendering/tilecache.h"
 
 class DrawingCanvas : public wxWindow
 {
 public:
     DrawingCanvas(wxWindow *parent, DrawingView *view, wxWindowID id, const wxPoint &pos, const wxSize &size);
-    virtual ~DrawingCanvas() noexcept {}
+    virtual ~DrawingCanvas() noexcept;
 
     void ShowExportDialog();
     void SetView(DrawingView *view);
 
 private:
     void OnPaint(wxPaintEvent &);
+
+    // Blits the latest background frame and draws live whatever it doesn't show (yet)
+    void PaintFromBackgroundFrame(wxDC &dc);
+    void RequestBackgroundFrame();
+
+    void PaintFromTileCache(wxDC &dc);
+
     void DrawOnContext(wxGraphicsContext *gc);
 
     void OnMouseDown(wxMouseEvent &);
@@ -23,10 +33,37 @@ private:
     void OnMouseUp(wxMouseEvent &);
     void OnMouseLeave(wxMouseEvent &);
 
+    void OnMouseWheel(wxMouseEvent &);
+    void OnMiddleDown(wxMouseEvent &);
+    void OnMiddleUp(wxMouseEvent &);
+
+    // Motion events are queued and applied once per frame, so high-rate mice don't flood the loop with paints
+    void OnFrameTimer(wxTimerEvent &);
+    void FlushPendingInput();
+    void ScheduleFrame();
+
+    // Drops to interactive quality while input keeps coming and refines once it has been idle for a while
+    void NoteInteraction();
+    void OnRefineTimer(wxTimerEvent &);
+
     DrawingView *view;
 
     bool isDragging{false};
 
+    bool isPanning{false};
+    wxPoint lastPanPoint;
+
+    std::vector<wxPoint> pendingDragPoints;
+    wxTimer frameTimer;
+    int frameIntervalMs;
+
+    wxTimer refineTimer;
+
+    std::unique_ptr<BackgroundRenderer> backgroundRenderer;
+    wxBitmap backgroundBitmap;
+
+    TileCache tileCache;
+
     wxMenu contextMenu;
     void BuildContextMenu();
     void OnContextMenuEvent(wxContextMenuEvent &);
@@ -2,26 +2,47 @@
 
 #include <wx/graphics.h>
 
+#include <cmath>
+
 #include "../shapes/circle.h"
 #include "../shapes/rect.h"
 #include "../shapes/path.h"
+#include "../shapes/filledpolygon.h"
+#include "../shapes/group.h"
+#include "graphicsstyles.h"
+#include "../rendering/imagesource.h"
+
+struct DrawingOptions
+{
+    // Paths longer than this are drawn with an evenly decimated subset of their points (0 = all points)
+    std::size_t pathPointBudget{0};
+
+    // Build pens and brushes from fresh colours instead of sharing the shapes' ref-counted ones, and
+    // images from their pixels instead of the main thread's bitmaps. wxColour reference counting isn't
+    // thread safe, so worker threads must draw with this on.
+    bool detachColours{false};
+
+    // Pens and brushes are taken from here instead of built per shape; must belong to the context drawn on
+    GraphicsStyleCache *styles{nullptr};
+};
 
 struct DrawingVisitor
 {
     wxGraphicsContext &gc;
+    DrawingOptions options{};
 
     void operator()(const Circle &obj)
     {
-        gc.SetPen(wxPen(obj.color));
-        gc.SetBrush(wxBrush(obj.color));
+        SetPen(obj.color);
+        SetBrush(obj.color);
         gc.DrawEllipse(obj.center.m_x - obj.radius, obj.center.m_y - obj.radius,
                        obj.radius * 2, obj.radius * 2);
     }
 
     void operator()(const Rect &obj)
     {
-        gc.SetPen(wxPen(obj.color));
-        gc.SetBrush(wxBrush(obj.color));
+        SetPen(obj.color);
+        SetBrush(obj.color);
         gc.DrawRectangle(obj.rect.m_x, obj.rect.m_y, obj.rect.m_width, obj.rect.m_height);
     }
 
@@ -29,8 +50,113 @@ struct DrawingVisitor
     {
         if (obj.points.size() > 1)
         {
-            gc.SetPen(wxPen(obj.color, obj.width));
-            gc.StrokeLines(obj.points.size(), obj.points.data());
+            SetPen(obj.color, obj.width);
+
+            if (options.pathPointBudget > 1 && obj.points.size() > options.pathPointBudget)
+            {
+                StrokeDecimated(obj.points);
+            }
+            else
+            {
+                gc.StrokeLines(obj.points.size(), obj.points.data());
+            }
+        }
+    }
+
+    void operator()(const FilledPolygon &obj)
+    {
+        if (obj.points.size() > 2)
+        {
+            SetPen(obj.color);
+            SetBrush(obj.color);
+
+            // closed, so the outline runs along the last edge too
+            auto path = gc.CreatePath();
+            path.MoveToPoint(obj.points.front());
+
+            for (std::size_t i = 1; i < obj.points.size(); i++)
+            {
+                path.AddLineToPoint(obj.points[i]);
+            }
+
+            path.CloseSubpath();
+            gc.DrawPath(path);
         }
     }
+
+    // Draws the children under their own transformations; defined with CanvasObject
+    void operator()(const Group &obj);
+
+    void operator()(const RasterImage &obj)
+    {
+        const auto &source = *obj.source;
+
+        // device pixels per image pixel under the context's current transformation
+        double a, b, c, d;
+        gc.GetTransform().Get(&a, &b, &c, &d);
+
+        const double scale = std::sqrt(std::fabs(a * d - b * c) * obj.rect.m_width * obj.rect.m_height /
+                                       (static_cast<double>(source.GetWidth()) * source.GetHeight()));
+        const auto level = source.ChooseLevel(scale);
+
+        if (options.detachColours)
+        {
+            gc.DrawBitmap(gc.CreateBitmapFromImage(source.ToImage(level)), obj.rect.m_x, obj.rect.m_y, obj.rect.m_width, obj.rect.m_height);
+        }
+        else
+        {
+            gc.DrawBitmap(source.GetBitmap(level), obj.rect.m_x, obj.rect.m_y, obj.rect.m_width, obj.rect.m_height);
+        }
+    }
+
+private:
+    wxColour Colour(const wxColour &colour) const
+    {
+        return options.detachColours ? wxColour(colour.Red(), colour.Green(), colour.Blue(), colour.Alpha()) : colour;
+    }
+
+    void SetPen(const wxColour &colour, int width = 1)
+    {
+        if (options.styles)
+        {
+            gc.SetPen(options.styles->GetPen(colour, width));
+        }
+        else
+        {
+            gc.SetPen(wxPen(Colour(colour), width));
+        }
+    }
+
+    void SetBrush(const wxColour &colour)
+    {
+        if (options.styles)
+        {
+            gc.SetBrush(options.styles->GetBrush(colour));
+        }
+        else
+        {
+            gc.SetBrush(wxBrush(Colour(colour)));
+        }
+    }
+
+    void StrokeDecimated(const std::vector<wxPoint2DDouble> &points)
+    {
+        const auto budget = options.pathPointBudget;
+        const auto stride = (points.size() + budget - 2) / (budget - 1);
+
+        std::vector<wxPoint2DDouble> decimated;
+        decimated.reserve(budget + 1);
+
+        for (std::size_t i = 0; i < points.size(); i += stride)
+        {
+            decimated.push_back(points[i]);
+        }
+
+        if (decimated.back() != points.back())
+        {
+            decimated.push_back(points.back());
+        }
+
+        gc.StrokeLines(decimated.size(), decimated.data());
+    }
 };
\ No newline at end of file
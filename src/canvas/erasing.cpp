@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cmath>
+
+#include "erasing.h"
+#include "canvasobject.h"
+#include "../utils/visitor.h"
+
+namespace
+{
+    using Point = wxPoint2DDouble;
+
+    double Cross(Point a, Point b, Point c)
+    {
+        return (b.m_x - a.m_x) * (c.m_y - a.m_y) - (b.m_y - a.m_y) * (c.m_x - a.m_x);
+    }
+
+    double DistanceSquared(Point p, Point a, Point b)
+    {
+        const double dx = b.m_x - a.m_x;
+        const double dy = b.m_y - a.m_y;
+        const double lengthSquared = dx * dx + dy * dy;
+
+        const double t = lengthSquared > 0 ? std::clamp(((p.m_x - a.m_x) * dx + (p.m_y - a.m_y) * dy) / lengthSquared, 0.0, 1.0) : 0.0;
+
+        const double ex = a.m_x + t * dx - p.m_x;
+        const double ey = a.m_y + t * dy - p.m_y;
+
+        return ex * ex + ey * ey;
+    }
+
+    // Proper crossings only; touching and collinear cases come out of the endpoint distances as zero
+    bool Crosses(Point a, Point b, Point c, Point d)
+    {
+        const double c1 = Cross(c, d, a), c2 = Cross(c, d, b);
+        const double c3 = Cross(a, b, c), c4 = Cross(a, b, d);
+
+        return ((c1 > 0 && c2 < 0) || (c1 < 0 && c2 > 0)) && ((c3 > 0 && c4 < 0) || (c3 < 0 && c4 > 0));
+    }
+
+    double DistanceSquared(Point a, Point b, Point c, Point d)
+    {
+        if (Crosses(a, b, c, d))
+        {
+            return 0.0;
+        }
+
+        return std::min({DistanceSquared(a, c, d), DistanceSquared(b, c, d), DistanceSquared(c, a, b), DistanceSquared(d, a, b)});
+    }
+
+    // The eraser segment in an object's scaled space: coordinates relative to the object's centre with its
+    // scale applied, but not yet rotated or moved. Only isometries follow, so world distances hold there.
+    struct Capsule
+    {
+        Point from;
+        Point to;
+        double radius;
+
+        // whether a segment could come within `reach` of the capsule's axis at all
+        bool Near(Point a, Point b, double reach) const
+        {
+            return std::max(a.m_x, b.m_x) >= std::min(from.m_x, to.m_x) - reach && std::min(a.m_x, b.m_x) <= std::max(from.m_x, to.m_x) + reach &&
+                   std::max(a.m_y, b.m_y) >= std::min(from.m_y, to.m_y) - reach && std::min(a.m_y, b.m_y) <= std::max(from.m_y, to.m_y) + reach;
+        }
+
+        bool Touches(Point a, Point b, double reach) const
+        {
+            return Near(a, b, reach) && DistanceSquared(from, to, a, b) <= reach * reach;
+        }
+    };
+
+    bool Inside(Point p, double left, double top, double right, double bottom)
+    {
+        return p.m_x >= left && p.m_x <= right && p.m_y >= top && p.m_y <= bottom;
+    }
+
+    template <typename Scale>
+    bool InsidePolygon(Point p, const std::vector<Point> &points, Scale scale)
+    {
+        bool inside = false;
+        Point previous = scale(points.back());
+
+        for (const auto &point : points)
+        {
+            const Point current = scale(point);
+
+            if ((current.m_y > p.m_y) != (previous.m_y > p.m_y) &&
+                p.m_x < previous.m_x + (current.m_x - previous.m_x) * (p.m_y - previous.m_y) / (current.m_y - previous.m_y))
+            {
+                inside = !inside;
+            }
+
+            previous = current;
+        }
+
+        return inside;
+    }
+}
+
+namespace Erasing
+{
+    bool Touches(const CanvasObject &object, wxPoint2DDouble from, wxPoint2DDouble to, double radius)
+    {
+        const auto &t = object.transformation;
+        const auto centre = object.boundingBox.GetCentre();
+
+        const double cosine = std::cos(t.rotationAngle);
+        const double sine = std::sin(t.rotationAngle);
+
+        const auto toScaled = [&](Point p)
+        {
+            const double x = p.m_x - t.translationX - centre.m_x;
+            const double y = p.m_y - t.translationY - centre.m_y;
+            return Point{x * cosine + y * sine, -x * sine + y * cosine};
+        };
+
+        const auto scale = [&](Point p)
+        { return Point{(p.m_x - centre.m_x) * t.scaleX, (p.m_y - centre.m_y) * t.scaleY}; };
+
+        const Capsule capsule{toScaled(from), toScaled(to), radius};
+
+        const auto touchesRect = [&](const wxRect2DDouble &rect)
+        {
+            const auto a = scale(rect.GetLeftTop());
+            const auto b = scale(rect.GetRightBottom());
+
+            const double left = std::min(a.m_x, b.m_x), right = std::max(a.m_x, b.m_x);
+            const double top = std::min(a.m_y, b.m_y), bottom = std::max(a.m_y, b.m_y);
+
+            return Inside(capsule.from, left, top, right, bottom) ||
+                   capsule.Touches({left, top}, {right, top}, radius) ||
+                   capsule.Touches({right, top}, {right, bottom}, radius) ||
+                   capsule.Touches({right, bottom}, {left, bottom}, radius) ||
+                   capsule.Touches({left, bottom}, {left, top}, radius);
+        };
+
+        return std::visit(visitor{[&](const Path &path)
+                                  {
+                                      // a stroke scales like baking scales it: by the width that keeps its area
+                                      const double reach = radius + path.width / 2.0 * std::sqrt(std::fabs(t.scaleX * t.scaleY));
+
+                                      if (path.points.size() == 1)
+                                      {
+                                          const auto point = scale(path.points.front());
+                                          return capsule.Touches(point, point, reach);
+                                      }
+
+                                      Point previous = scale(path.points.front());
+
+                                      for (std::size_t i = 1; i < path.points.size(); i++)
+                                      {
+                                          const Point current = scale(path.points[i]);
+
+                                          if (capsule.Touches(previous, current, reach))
+                                          {
+                                              return true;
+                                          }
+
+                                          previous = current;
+                                      }
+
+                                      return false;
+                                  },
+                                  [&](const Rect &rect)
+                                  { return touchesRect(rect.rect); },
+                                  [&](const RasterImage &image)
+                                  { return touchesRect(image.rect); },
+                                  [&](const Circle &circle)
+                                  {
+                                      const auto circleCentre = scale(circle.center);
+                                      const double scaleX = std::fabs(t.scaleX), scaleY = std::fabs(t.scaleY);
+
+                                      if (scaleX == scaleY)
+                                      {
+                                          const double reach = circle.radius * scaleX + radius;
+                                          return DistanceSquared(circleCentre, capsule.from, capsule.to) <= reach * reach;
+                                      }
+
+                                      if (scaleX == 0 || scaleY == 0)
+                                      {
+                                          return false;
+                                      }
+
+                                      // an ellipse: unscaled it's the circle again, and the eraser is measured along the shorter axis
+                                      const auto unscale = [&](Point p)
+                                      { return Point{(p.m_x - circleCentre.m_x) / scaleX, (p.m_y - circleCentre.m_y) / scaleY}; };
+
+                                      const double reach = circle.radius + radius / std::min(scaleX, scaleY);
+                                      return DistanceSquared({0, 0}, unscale(capsule.from), unscale(capsule.to)) <= reach * reach;
+                                  },
+                                  [&](const FilledPolygon &polygon)
+                                  {
+                                      if (polygon.points.size() < 3)
+                                      {
+                                          return false;
+                                      }
+
+                                      Point previous = scale(polygon.points.back());
+
+                                      for (const auto &point : polygon.points)
+                                      {
+                                          const Point current = scale(point);
+
+                                          if (capsule.Touches(previous, current, radius))
+                                          {
+                                              return true;
+                                          }
+
+                                          previous = current;
+                                      }
+
+                                      return InsidePolygon(capsule.from, polygon.points, scale);
+                                  },
+                                  [&](const Group &group)
+                                  {
+                                      if (t.scaleX == 0 || t.scaleY == 0)
+                                      {
+                                          return false;
+                                      }
+
+                                      // into the children's coordinates; a non-uniform scale stretches the eraser, so it's
+                                      // measured along the shorter axis there
+                                      const auto toLocal = [&](Point p)
+                                      { return Point{centre.m_x + p.m_x / t.scaleX, centre.m_y + p.m_y / t.scaleY}; };
+
+                                      const auto localFrom = toLocal(capsule.from);
+                                      const auto localTo = toLocal(capsule.to);
+                                      const double localRadius = radius / std::min(std::fabs(t.scaleX), std::fabs(t.scaleY));
+
+                                      return std::any_of(group.children.begin(), group.children.end(), [&](const CanvasObject &child)
+                                                         { return Touches(child, localFrom, localTo, localRadius); });
+                                  }},
+                          *object.shape);
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <wx/geometry.h>
+
+struct CanvasObject;
+
+// Hit tests for the eraser against an object's actual geometry, not just its box. A stroke segment is
+// a capsule: the segment from `from` to `to` swept by a disc of `radius`, all in world units.
+namespace Erasing
+{
+    bool Touches(const CanvasObject &object, wxPoint2DDouble from, wxPoint2DDouble to, double radius);
+}
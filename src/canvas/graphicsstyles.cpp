@@ -0,0 +1,33 @@
+#include "graphicsstyles.h"
+
+namespace
+{
+    wxColour Detached(const StyleKey &key)
+    {
+        return wxColour(key.rgba >> 24, (key.rgba >> 16) & 0xff, (key.rgba >> 8) & 0xff, key.rgba & 0xff);
+    }
+}
+
+const wxGraphicsPen &GraphicsStyleCache::GetPen(const wxColour &colour, int width)
+{
+    const auto key = StyleKey::Of(colour, width);
+
+    if (auto found = pens.find(key); found != pens.end())
+    {
+        return found->second;
+    }
+
+    return pens.emplace(key, gc.CreatePen(wxPen(Detached(key), width))).first->second;
+}
+
+const wxGraphicsBrush &GraphicsStyleCache::GetBrush(const wxColour &colour)
+{
+    const auto key = StyleKey::Of(colour);
+
+    if (auto found = brushes.find(key); found != brushes.end())
+    {
+        return found->second;
+    }
+
+    return brushes.emplace(key, gc.CreateBrush(wxBrush(Detached(key)))).first->second;
+}
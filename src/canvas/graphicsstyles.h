@@ -0,0 +1,24 @@
+#pragma once
+
+#include <unordered_map>
+
+#include <wx/graphics.h>
+
+#include "../shapes/styletable.h"
+
+// Pens and brushes for one graphics context, created once per style and reused by every shape drawn
+// with it. They're made from fresh colours, so a worker thread can keep a cache of its own.
+class GraphicsStyleCache
+{
+public:
+    explicit GraphicsStyleCache(wxGraphicsContext &gc) : gc(gc) {}
+
+    const wxGraphicsPen &GetPen(const wxColour &colour, int width = 1);
+    const wxGraphicsBrush &GetBrush(const wxColour &colour);
+
+private:
+    wxGraphicsContext &gc;
+
+    std::unordered_map<StyleKey, wxGraphicsPen, StyleKeyHash> pens;
+    std::unordered_map<StyleKey, wxGraphicsBrush, StyleKeyHash> brushes;
+};
@@ -0,0 +1,100 @@
+#include <cmath>
+#include <stdexcept>
+
+#include "grouping.h"
+#include "canvasobject.h"
+#include "objectspace.h"
+#include "baking.h"
+
+namespace
+{
+    constexpr double Tolerance = 1e-9;
+
+    double Snap(double value, double target)
+    {
+        return std::fabs(value - target) < Tolerance ? target : value;
+    }
+
+    // The Transformation about `centre` whose matrix is `matrix`, if there is one: its linear part has to
+    // be a rotation after an axis-aligned scale, i.e. map the axes to perpendicular vectors
+    bool Decompose(const wxAffineMatrix2D &matrix, wxPoint2DDouble centre, Transformation &result)
+    {
+        const auto xAxis = matrix.TransformDistance({1, 0});
+        const auto yAxis = matrix.TransformDistance({0, 1});
+
+        const double scaleX = std::hypot(xAxis.m_x, xAxis.m_y);
+        const double dot = xAxis.m_x * yAxis.m_x + xAxis.m_y * yAxis.m_y;
+
+        if (scaleX < Tolerance || std::fabs(dot) > Tolerance * scaleX * std::hypot(yAxis.m_x, yAxis.m_y))
+        {
+            return false;
+        }
+
+        const auto movedCentre = matrix.TransformPoint(centre);
+
+        result.translationX = movedCentre.m_x - centre.m_x;
+        result.translationY = movedCentre.m_y - centre.m_y;
+        result.rotationAngle = Snap(std::atan2(xAxis.m_y, xAxis.m_x), 0.0);
+        result.scaleX = Snap(scaleX, 1.0);
+        result.scaleY = Snap((xAxis.m_x * yAxis.m_y - xAxis.m_y * yAxis.m_x) / scaleX, 1.0);
+
+        return true;
+    }
+}
+
+namespace Grouping
+{
+    bool IsGroup(const CanvasObject &object)
+    {
+        return std::holds_alternative<Group>(*object.shape);
+    }
+
+    Group BuildGroup(std::vector<CanvasObject> children)
+    {
+        if (children.empty())
+        {
+            throw std::invalid_argument("A group needs at least one object");
+        }
+
+        Group group{std::move(children)};
+        group.bounds = ObjectSpace::GetWorldBounds(group.children);
+
+        for (const auto &child : group.children)
+        {
+            group.pointCount += ShapeUtils::CountPoints(*child.shape);
+        }
+
+        return group;
+    }
+
+    CanvasObject MakeGroup(std::vector<CanvasObject> children)
+    {
+        return CanvasObject{BuildGroup(std::move(children))};
+    }
+
+    std::vector<CanvasObject> Ungroup(const CanvasObject &group)
+    {
+        const auto &children = std::get<Group>(*group.shape).children;
+        const auto groupMatrix = ObjectSpace::GetTransformationMatrix(group);
+
+        std::vector<CanvasObject> result;
+        result.reserve(children.size());
+
+        for (const auto &child : children)
+        {
+            auto combined = groupMatrix;
+            combined.Concat(ObjectSpace::GetTransformationMatrix(child));
+
+            result.push_back(child);
+            auto &ungrouped = result.back();
+
+            if (!Decompose(combined, child.boundingBox.GetCentre(), ungrouped.transformation))
+            {
+                ungrouped = Baking::Bake(child);
+                Decompose(groupMatrix, ungrouped.boundingBox.GetCentre(), ungrouped.transformation);
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "../shapes/group.h"
+
+struct CanvasObject;
+
+// Building and taking apart Group objects. A group's children stay in the coordinates they had when
+// grouped; the group object's own Transformation moves all of them at once.
+namespace Grouping
+{
+    bool IsGroup(const CanvasObject &object);
+
+    // `children` must not be empty; they keep their transformations
+    Group BuildGroup(std::vector<CanvasObject> children);
+    CanvasObject MakeGroup(std::vector<CanvasObject> children);
+
+    // The children with the group's transformation folded into their own, in z-order. A combined
+    // transformation that a Transformation can't express (a shear, from scaling a rotated child
+    // non-uniformly) is baked into the child's geometry instead.
+    std::vector<CanvasObject> Ungroup(const CanvasObject &group);
+}
@@ -1,35 +1,192 @@
 #include <wx/geometry.h>
 #include <wx/affinematrix2d.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include "objectspace.h"
 #include "canvasobject.h"
 #include "../transforms/conversions.h"
+#include "../transforms/transformationkind.h"
+#include "../transforms/batchtransform.h"
+
+static_assert(sizeof(wxPoint2DDouble) == 2 * sizeof(double), "batch transforms treat wxPoint2DDouble spans as interleaved doubles");
 
 namespace ObjectSpace
 {
     wxPoint2DDouble ToObjectCoordinates(const CanvasObject &object, wxPoint2DDouble point)
     {
-        return GetInverseTransformationMatrix(object).TransformPoint(point);
+        return TransformationKinds::Dispatch(object.transformation, [&](auto kind)
+                                             { return TransformationPath<decltype(kind)::value>::ToObject(object.transformation, object.boundingBox.GetCentre(), point); });
     }
 
     wxPoint2DDouble ToObjectDistance(const CanvasObject &object, wxPoint2DDouble point)
     {
-        return GetInverseTransformationMatrix(object).TransformDistance(point);
+        return TransformationKinds::Dispatch(object.transformation, [&](auto kind)
+                                             { return TransformationPath<decltype(kind)::value>::ToObjectDistance(object.transformation, object.boundingBox.GetCentre(), point); });
     }
 
     wxPoint2DDouble ToScreenCoordinates(const CanvasObject &object, wxPoint2DDouble point)
     {
-        return GetTransformationMatrix(object).TransformPoint(point);
+        return TransformationKinds::Dispatch(object.transformation, [&](auto kind)
+                                             { return TransformationPath<decltype(kind)::value>::ToScreen(object.transformation, object.boundingBox.GetCentre(), point); });
     }
 
     wxPoint2DDouble ToScreenDistance(const CanvasObject &object, wxPoint2DDouble point)
     {
-        return GetTransformationMatrix(object).TransformDistance(point);
+        return TransformationKinds::Dispatch(object.transformation, [&](auto kind)
+                                             { return TransformationPath<decltype(kind)::value>::ToScreenDistance(object.transformation, object.boundingBox.GetCentre(), point); });
+    }
+
+    void ToObjectCoordinates(const CanvasObject &object, const wxPoint2DDouble *points, wxPoint2DDouble *out, std::size_t count)
+    {
+        if (TransformationKinds::Classify(object.transformation) == TransformationKind::Identity)
+        {
+            std::copy(points, points + count, out);
+            return;
+        }
+
+        TransformPoints(GetInverseTransformationMatrix(object), points, out, count);
+    }
+
+    void ToScreenCoordinates(const CanvasObject &object, const wxPoint2DDouble *points, wxPoint2DDouble *out, std::size_t count)
+    {
+        if (TransformationKinds::Classify(object.transformation) == TransformationKind::Identity)
+        {
+            std::copy(points, points + count, out);
+            return;
+        }
+
+        TransformPoints(GetTransformationMatrix(object), points, out, count);
+    }
+
+    wxRect2DDouble GetWorldBounds(const CanvasObject &object)
+    {
+        const auto &box = object.boundingBox;
+
+        if (TransformationKinds::Classify(object.transformation) != TransformationKind::General)
+        {
+            const auto leftTop = ToScreenCoordinates(object, box.GetLeftTop());
+            const auto rightBottom = ToScreenCoordinates(object, box.GetRightBottom());
+
+            return wxRect2DDouble(std::min(leftTop.m_x, rightBottom.m_x), std::min(leftTop.m_y, rightBottom.m_y),
+                                  std::fabs(rightBottom.m_x - leftTop.m_x), std::fabs(rightBottom.m_y - leftTop.m_y));
+        }
+
+        wxPoint2DDouble corners[] = {box.GetLeftTop(), box.GetRightTop(), box.GetRightBottom(), box.GetLeftBottom()};
+        ToScreenCoordinates(object, corners, corners, 4);
+
+        double minX = corners[0].m_x, maxX = corners[0].m_x;
+        double minY = corners[0].m_y, maxY = corners[0].m_y;
+
+        for (const auto &corner : corners)
+        {
+            minX = std::min(minX, corner.m_x);
+            maxX = std::max(maxX, corner.m_x);
+            minY = std::min(minY, corner.m_y);
+            maxY = std::max(maxY, corner.m_y);
+        }
+
+        return wxRect2DDouble(minX, minY, maxX - minX, maxY - minY);
+    }
+
+    wxRect2DDouble GetWorldBounds(const std::vector<CanvasObject> &objects)
+    {
+        if (objects.empty())
+        {
+            return wxRect2DDouble();
+        }
+
+        auto bounds = GetWorldBounds(objects.front());
+
+        for (const auto &object : objects)
+        {
+            bounds.Union(GetWorldBounds(object));
+        }
+
+        return bounds;
+    }
+
+    bool OverlapsWorldRect(const CanvasObject &object, const wxRect2DDouble &area)
+    {
+        const auto bounds = GetWorldBounds(object);
+
+        if (bounds.GetRight() < area.GetLeft() || area.GetRight() < bounds.GetLeft() ||
+            bounds.GetBottom() < area.GetTop() || area.GetBottom() < bounds.GetTop())
+        {
+            return false;
+        }
+
+        // without rotation the bounds are exact
+        if (TransformationKinds::Classify(object.transformation) != TransformationKind::General)
+        {
+            return true;
+        }
+
+        const auto &box = object.boundingBox;
+        wxPoint2DDouble corners[] = {box.GetLeftTop(), box.GetRightTop(), box.GetRightBottom(), box.GetLeftBottom()};
+        ToScreenCoordinates(object, corners, corners, 4);
+
+        const wxPoint2DDouble areaCorners[] = {area.GetLeftTop(), area.GetRightTop(), area.GetRightBottom(), area.GetLeftBottom()};
+
+        // the axes of `area` passed above; what's left are the box's own edge normals
+        for (const auto &edge : {corners[1] - corners[0], corners[3] - corners[0]})
+        {
+            const wxPoint2DDouble normal{-edge.m_y, edge.m_x};
+            const auto project = [&](const wxPoint2DDouble &point)
+            { return point.m_x * normal.m_x + point.m_y * normal.m_y; };
+
+            double boxMin = project(corners[0]), boxMax = boxMin;
+            double areaMin = project(areaCorners[0]), areaMax = areaMin;
+
+            for (int i = 1; i < 4; i++)
+            {
+                boxMin = std::min(boxMin, project(corners[i]));
+                boxMax = std::max(boxMax, project(corners[i]));
+                areaMin = std::min(areaMin, project(areaCorners[i]));
+                areaMax = std::max(areaMax, project(areaCorners[i]));
+            }
+
+            if (boxMax < areaMin || areaMax < boxMin)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool HitTest(const CanvasObject &object, wxPoint2DDouble point)
+    {
+        const auto local = ToObjectCoordinates(object, point);
+
+        if (!object.boundingBox.Contains(local))
+        {
+            return false;
+        }
+
+        const auto group = std::get_if<Group>(object.shape.get());
+        return !group || std::any_of(group->children.begin(), group->children.end(), [&](const CanvasObject &child)
+                                     { return HitTest(child, local); });
+    }
+
+    void TransformPoints(const wxAffineMatrix2D &matrix, const wxPoint2DDouble *points, wxPoint2DDouble *out, std::size_t count)
+    {
+        wxMatrix2D linear;
+        wxPoint2DDouble translation;
+        matrix.Get(&linear, &translation);
+
+        const BatchTransform::AffineCoefficients coefficients{linear.m_11, linear.m_12,
+                                                              linear.m_21, linear.m_22,
+                                                              translation.m_x, translation.m_y};
+
+        BatchTransform::TransformPoints(coefficients, reinterpret_cast<const double *>(points), reinterpret_cast<double *>(out), count);
     }
 
     wxAffineMatrix2D GetTransformationMatrix(const CanvasObject &object)
     {
-        return TransformWxConversions::GetMatrix(object.transformation, object.boundingBox.GetCentre(), object.boundingBox.GetCentre());
+        return TransformationKinds::Dispatch(object.transformation, [&](auto kind)
+                                             { return TransformationPath<decltype(kind)::value>::GetMatrix(object.transformation, object.boundingBox.GetCentre()); });
     }
 
     wxAffineMatrix2D GetInverseTransformationMatrix(const CanvasObject &object)
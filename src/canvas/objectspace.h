@@ -1,8 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
 struct CanvasObject;
 class wxPoint2DDouble;
 class wxAffineMatrix2D;
+class wxRect2DDouble;
 
 namespace ObjectSpace
 {
@@ -11,6 +15,23 @@ namespace ObjectSpace
     wxPoint2DDouble ToScreenCoordinates(const CanvasObject & object, wxPoint2DDouble point);
     wxPoint2DDouble ToScreenDistance(const CanvasObject & object, wxPoint2DDouble point);
 
+    // Batch versions for whole geometries. `out` may be the same span as `points`.
+    void ToObjectCoordinates(const CanvasObject &object, const wxPoint2DDouble *points, wxPoint2DDouble *out, std::size_t count);
+    void ToScreenCoordinates(const CanvasObject &object, const wxPoint2DDouble *points, wxPoint2DDouble *out, std::size_t count);
+    void TransformPoints(const wxAffineMatrix2D &matrix, const wxPoint2DDouble *points, wxPoint2DDouble *out, std::size_t count);
+
+    // Axis-aligned bounds of the transformed bounding box
+    wxRect2DDouble GetWorldBounds(const CanvasObject &object);
+    // Union of the world bounds of all objects; an empty rect when there are none
+    wxRect2DDouble GetWorldBounds(const std::vector<CanvasObject> &objects);
+
+    // Whether the transformed bounding box (not just its axis-aligned bounds) overlaps `area`
+    bool OverlapsWorldRect(const CanvasObject &object, const wxRect2DDouble &area);
+
+    // Whether `point` falls inside the object's box; for a group, inside one of its children's as well.
+    // A group's own box rejects a miss without looking at the children.
+    bool HitTest(const CanvasObject &object, wxPoint2DDouble point);
+
     wxAffineMatrix2D GetTransformationMatrix(const CanvasObject & object);
     wxAffineMatrix2D GetInverseTransformationMatrix(const CanvasObject & object);
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "selection.h"
+#include "objectspace.h"
+
+Selection::Selection(std::vector<CanvasObject> &objects, std::vector<std::size_t> indices, double handleWidth)
+    : objects(&objects), indices(Normalize(std::move(indices))),
+      groupBox(this->indices.size() > 1 ? std::make_unique<CanvasObject>(Rect{GetMemberBounds(), *wxBLACK}) : nullptr),
+      box(groupBox ? *groupBox : objects[this->indices.front()], handleWidth, groupBox != nullptr)
+{
+}
+
+std::vector<std::size_t> Selection::Normalize(std::vector<std::size_t> indices)
+{
+    if (indices.empty())
+    {
+        throw std::invalid_argument("Selection needs at least one object");
+    }
+
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+    return indices;
+}
+
+bool Selection::Contains(std::size_t index) const
+{
+    return std::binary_search(indices.begin(), indices.end(), index);
+}
+
+bool Selection::Rebind(std::vector<CanvasObject> &objects)
+{
+    this->objects = &objects;
+
+    if (indices.back() >= objects.size())
+    {
+        return false;
+    }
+
+    if (groupBox)
+    {
+        *groupBox = CanvasObject{Rect{GetMemberBounds(), *wxBLACK}};
+    }
+    else
+    {
+        box.object = objects[indices.front()];
+    }
+
+    return true;
+}
+
+void Selection::Draw(wxGraphicsContext &gc, const wxAffineMatrix2D &view) const
+{
+    box.Draw(gc, view);
+}
+
+void Selection::SetHandleWidth(double width)
+{
+    box.SetHandleWidth(width);
+}
+
+void Selection::SetTranslationSnap(SelectionBox::TranslationSnap snap)
+{
+    box.SetTranslationSnap(std::move(snap));
+}
+
+void Selection::StartDragIfClicked(wxPoint2DDouble pt)
+{
+    box.StartDragIfClicked(pt);
+
+    if (!box.IsDragging())
+    {
+        return;
+    }
+
+    dragStart.clear();
+    dragStart.reserve(indices.size());
+
+    for (const auto index : indices)
+    {
+        dragStart.push_back((*objects)[index].transformation);
+    }
+}
+
+bool Selection::IsDragging() const
+{
+    return box.IsDragging();
+}
+
+void Selection::Drag(const std::vector<wxPoint2DDouble> &points)
+{
+    for (const auto &pt : points)
+    {
+        box.Drag(pt);
+    }
+
+    if (groupBox && !points.empty())
+    {
+        ApplyGroupTransformation();
+    }
+}
+
+void Selection::FinishDrag()
+{
+    box.FinishDrag();
+
+    // the box starts every drag untransformed, snugly around the members
+    if (groupBox)
+    {
+        *groupBox = CanvasObject{Rect{GetMemberBounds(), *wxBLACK}};
+    }
+}
+
+wxRect2DDouble Selection::GetMemberBounds() const
+{
+    auto bounds = ObjectSpace::GetWorldBounds((*objects)[indices.front()]);
+
+    for (const auto index : indices)
+    {
+        bounds.Union(ObjectSpace::GetWorldBounds((*objects)[index]));
+    }
+
+    return bounds;
+}
+
+// The box's transformation since the drag started is a similarity (uniform scale, rotation, translation),
+// and so is its composition with each member's own: the member's centre moves with the box, its rotation
+// adds up and its scale multiplies.
+void Selection::ApplyGroupTransformation()
+{
+    const auto &group = groupBox->transformation;
+    const auto delta = ObjectSpace::GetTransformationMatrix(*groupBox);
+
+    for (std::size_t i = 0; i < indices.size(); i++)
+    {
+        auto &object = (*objects)[indices[i]];
+        const auto &start = dragStart[i];
+
+        const auto centre = object.boundingBox.GetCentre();
+        const auto movedCentre = delta.TransformPoint({centre.m_x + start.translationX, centre.m_y + start.translationY});
+
+        object.transformation.translationX = movedCentre.m_x - centre.m_x;
+        object.transformation.translationY = movedCentre.m_y - centre.m_y;
+        object.transformation.rotationAngle = start.rotationAngle + group.rotationAngle;
+        object.transformation.scaleX = start.scaleX * group.scaleX;
+        object.transformation.scaleY = start.scaleY * group.scaleY;
+    }
+}
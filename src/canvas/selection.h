@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <wx/wx.h>
+
+#include "canvasobject.h"
+#include "selectionbox.h"
+
+// One or more objects transformed as a unit. A single object keeps its own rotated box; several share an
+// axis-aligned box around their world bounds that only scales uniformly, so every drag is a similarity
+// that each member's Transformation can take exactly. Members are updated in one pass per drag batch.
+class Selection
+{
+public:
+    // `indices` must be valid for `objects`; duplicates are ignored
+    Selection(std::vector<CanvasObject> &objects, std::vector<std::size_t> indices, double handleWidth);
+
+    // Sorted, so iterating them follows the z-order
+    const std::vector<std::size_t> &GetIndices() const { return indices; }
+    bool Contains(std::size_t index) const;
+
+    // Points the selection at `objects` again after an edit. Returns false if a member no longer exists.
+    bool Rebind(std::vector<CanvasObject> &objects);
+
+    void Draw(wxGraphicsContext &gc, const wxAffineMatrix2D &view = {}) const;
+    void SetHandleWidth(double width);
+    void SetTranslationSnap(SelectionBox::TranslationSnap snap);
+
+    void StartDragIfClicked(wxPoint2DDouble pt);
+    bool IsDragging() const;
+    void Drag(const std::vector<wxPoint2DDouble> &points);
+    void FinishDrag();
+
+    // Member transformations from when the current drag started, parallel to GetIndices()
+    const std::vector<Transformation> &GetDragStartTransformations() const { return dragStart; }
+
+private:
+    static std::vector<std::size_t> Normalize(std::vector<std::size_t> indices);
+
+    wxRect2DDouble GetMemberBounds() const;
+    void ApplyGroupTransformation();
+
+    std::vector<CanvasObject> *objects;
+    std::vector<std::size_t> indices;
+
+    // a stand-in object for the shared box; null with a single member
+    std::unique_ptr<CanvasObject> groupBox;
+    SelectionBox box;
+
+    std::vector<Transformation> dragStart;
+};
@@ -15,11 +15,11 @@ enum class SelectionBox::DraggableElement
     FullBox
 };
 
-void SelectionBox::Draw(wxGraphicsContext &gc) const
+void SelectionBox::Draw(wxGraphicsContext &gc, const wxAffineMatrix2D &view) const
 {
     gc.PushState();
 
-    gc.SetTransform(gc.CreateMatrix()); // empty transform as the handle positions are already in screen coordinates
+    gc.SetTransform(gc.CreateMatrix()); // empty transform as the handle positions are mapped to the screen below
 
     gc.SetPen(wxPen(wxColour(128, 128, 128), 1));
     gc.SetBrush(*wxTRANSPARENT_BRUSH);
@@ -31,8 +31,13 @@ void SelectionBox::Draw(wxGraphicsContext &gc) const
         GetBottomLeftHandleCenter(),
         GetTopLeftHandleCenter()};
 
-    auto rotationHandleStart = GetRotationHandleStart();
-    auto rotationHandleCenter = GetRotationHandleCenter();
+    auto rotationHandleStart = view.TransformPoint(GetRotationHandleStart());
+    auto rotationHandleCenter = view.TransformPoint(GetRotationHandleCenter());
+
+    for (auto &vertex : rectVertices)
+    {
+        vertex = view.TransformPoint(vertex);
+    }
 
     gc.StrokeLines(rectVertices.size(), rectVertices.data());
     gc.StrokeLine(rotationHandleStart.m_x, rotationHandleStart.m_y, rotationHandleCenter.m_x, rotationHandleCenter.m_y);
@@ -44,15 +49,17 @@ void SelectionBox::Draw(wxGraphicsContext &gc) const
         GetBottomLeftHandleCenter(),
         GetRotationHandleCenter()};
 
+    const double screenHandleWidth = view.TransformDistance({handleWidth, 0}).GetVectorLength();
+
     for (auto center : handleCenters)
     {
-        DrawHandle(gc, center);
+        DrawHandle(gc, view.TransformPoint(center), screenHandleWidth);
     }
 
     gc.PopState();
 }
 
-void SelectionBox::DrawHandle(wxGraphicsContext &gc, wxPoint2DDouble center) const
+void SelectionBox::DrawHandle(wxGraphicsContext &gc, wxPoint2DDouble center, double width) const
 {
     gc.PushState();
 
@@ -61,11 +68,21 @@ void SelectionBox::DrawHandle(wxGraphicsContext &gc, wxPoint2DDouble center) con
 
     gc.SetPen(*wxRED_PEN);
     gc.SetBrush(*wxRED_BRUSH);
-    gc.DrawRectangle(-handleWidth / 2, -handleWidth / 2, handleWidth, handleWidth);
+    gc.DrawRectangle(-width / 2, -width / 2, width, width);
 
     gc.PopState();
 }
 
+void SelectionBox::SetHandleWidth(double width)
+{
+    handleWidth = width;
+}
+
+void SelectionBox::SetTranslationSnap(TranslationSnap snap)
+{
+    translationSnap = std::move(snap);
+}
+
 void SelectionBox::StartDragIfClicked(wxPoint2DDouble pt)
 {
     if (HandleHitTest(pt, GetRotationHandleCenter()))
@@ -98,6 +115,8 @@ void SelectionBox::StartDragIfClicked(wxPoint2DDouble pt)
     }
 
     lastDragPoint = pt;
+    dragStartPoint = pt;
+    dragStartTranslation = {object.get().transformation.translationX, object.get().transformation.translationY};
 }
 
 bool SelectionBox::IsDragging() const
@@ -130,7 +149,7 @@ void SelectionBox::Drag(wxPoint2DDouble pt)
         RotateUsingMovement(lastDragPoint, pt);
         break;
     case DraggableElement::FullBox:
-        TranslateUsingMovement(lastDragPoint, pt);
+        TranslateUsingMovement(dragStartPoint, pt);
         break;
     }
 
@@ -142,6 +161,17 @@ void SelectionBox::ScaleUsingHandleMovement(wxPoint2DDouble dragStart, wxPoint2D
     const auto directionFromCenter = ObjectSpace::ToObjectCoordinates(object.get(), handleCenter) - object.get().boundingBox.GetCentre();
     const auto dragInObjectSpace = ObjectSpace::ToObjectDistance(object.get(), dragEnd - dragStart);
 
+    if (uniformScaling)
+    {
+        // the drag projected on the handle's diagonal, relative to its length
+        const double diagonal = directionFromCenter.m_x * directionFromCenter.m_x + directionFromCenter.m_y * directionFromCenter.m_y;
+        const double factor = 1.0 + (directionFromCenter.m_x * dragInObjectSpace.m_x + directionFromCenter.m_y * dragInObjectSpace.m_y) / diagonal;
+
+        object.get().transformation.scaleX *= factor;
+        object.get().transformation.scaleY *= factor;
+        return;
+    }
+
     const auto [halfBoxWidth, halfBoxHeight] = object.get().boundingBox.GetSize() / 2;
     const auto halfWidthAdjustment = directionFromCenter.m_x > 0 ? dragInObjectSpace.m_x : -dragInObjectSpace.m_x;
     const auto halfHeightAdjustment = directionFromCenter.m_y > 0 ? dragInObjectSpace.m_y : -dragInObjectSpace.m_y;
@@ -164,11 +194,21 @@ void SelectionBox::RotateUsingMovement(wxPoint2DDouble dragStart, wxPoint2DDoubl
     object.get().transformation.rotationAngle += angle;
 }
 
+// Measured from where the drag started, so a snap offset never accumulates into the free movement
 void SelectionBox::TranslateUsingMovement(wxPoint2DDouble dragStart, wxPoint2DDouble dragEnd)
 {
+    auto &transformation = object.get().transformation;
     const auto dragVector = dragEnd - dragStart;
-    object.get().transformation.translationX += dragVector.m_x;
-    object.get().transformation.translationY += dragVector.m_y;
+
+    transformation.translationX = dragStartTranslation.m_x + dragVector.m_x;
+    transformation.translationY = dragStartTranslation.m_y + dragVector.m_y;
+
+    if (translationSnap)
+    {
+        const auto offset = translationSnap(ObjectSpace::GetWorldBounds(object.get()));
+        transformation.translationX += offset.m_x;
+        transformation.translationY += offset.m_y;
+    }
 }
 
 void SelectionBox::FinishDrag()
@@ -178,14 +218,20 @@ void SelectionBox::FinishDrag()
 
 bool SelectionBox::HandleHitTest(wxPoint2DDouble pt, wxPoint2DDouble handleCenter) const
 {
+    const auto handleRect = wxRect2DDouble(-handleWidth / 2, -handleWidth / 2, handleWidth, handleWidth);
+
+    if (object.get().transformation.rotationAngle == 0.0)
+    {
+        return handleRect.Contains(pt - handleCenter);
+    }
+
     wxAffineMatrix2D screenToHandleMatrix;
 
     screenToHandleMatrix.Translate(handleCenter.m_x, handleCenter.m_y);
     screenToHandleMatrix.Rotate(object.get().transformation.rotationAngle);
     screenToHandleMatrix.Invert();
 
-    return wxRect2DDouble(-handleWidth / 2, -handleWidth / 2, handleWidth, handleWidth)
-        .Contains(screenToHandleMatrix.TransformPoint(pt));
+    return handleRect.Contains(screenToHandleMatrix.TransformPoint(pt));
 }
 
 bool SelectionBox::FullBoxHitTest(wxPoint2DDouble pt) const
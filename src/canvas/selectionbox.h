@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <optional>
 
 #include <wx/wx.h>
@@ -9,11 +10,21 @@
 
 struct SelectionBox
 {
-    SelectionBox(CanvasObject &object, double handleW) : object{object}, handleWidth(handleW) {}
+    // With `uniformScaling` the corner handles keep the aspect ratio, so the scale stays a similarity
+    SelectionBox(CanvasObject &object, double handleW, bool uniformScaling = false)
+        : object{object}, handleWidth(handleW), uniformScaling(uniformScaling) {}
 
     std::reference_wrapper<CanvasObject> object;
 
-    void Draw(wxGraphicsContext &gc) const;
+    // Handles are computed in world coordinates and drawn through `view` at a constant size on screen
+    void Draw(wxGraphicsContext &gc, const wxAffineMatrix2D &view = {}) const;
+
+    // In world units, so handles keep their on-screen size when zoomed
+    void SetHandleWidth(double width);
+
+    // Consulted while the whole box is moved: given the box's world bounds, returns an offset to add
+    using TranslationSnap = std::function<wxPoint2DDouble(const wxRect2DDouble &)>;
+    void SetTranslationSnap(TranslationSnap snap);
 
     void StartDragIfClicked(wxPoint2DDouble pt);
     bool IsDragging() const;
@@ -29,7 +40,7 @@ private:
     wxPoint2DDouble GetBottomRightHandleCenter() const;
     wxPoint2DDouble GetBottomLeftHandleCenter() const;
 
-    void DrawHandle(wxGraphicsContext &gc, wxPoint2DDouble center) const;
+    void DrawHandle(wxGraphicsContext &gc, wxPoint2DDouble center, double width) const;
 
     bool HandleHitTest(wxPoint2DDouble pt, wxPoint2DDouble handleCenter) const;
     bool FullBoxHitTest(wxPoint2DDouble pt) const;
@@ -42,5 +53,9 @@ private:
 
     std::optional<DraggableElement> draggedElement{};
     wxPoint2DDouble lastDragPoint{};
+    wxPoint2DDouble dragStartPoint{};
+    wxPoint2DDouble dragStartTranslation{};
+    TranslationSnap translationSnap;
     double handleWidth;
+    bool uniformScaling;
 };
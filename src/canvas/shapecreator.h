@@ -1,6 +1,7 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 
 #include <wx/wx.h>
 
@@ -12,13 +13,13 @@
 
 struct ShapeCreator
 {
-    void Start(ToolSettings toolSettings, wxPoint pt)
+    void Start(ToolSettings toolSettings, wxPoint2DDouble pt)
     {
         shape.emplace(ShapeFactory::Create(toolSettings, pt));
         lastDragStart = pt;
     }
 
-    void Update(wxPoint pt)
+    void Update(wxPoint2DDouble pt)
     {
         if (!shape)
         {
@@ -31,10 +32,10 @@ struct ShapeCreator
                            },
                            [&](Rect &rect)
                            {
-                               auto left = std::min(lastDragStart.x, pt.x);
-                               auto top = std::min(lastDragStart.y, pt.y);
-                               auto right = std::max(lastDragStart.x, pt.x);
-                               auto bottom = std::max(lastDragStart.y, pt.y);
+                               auto left = std::min(lastDragStart.m_x, pt.m_x);
+                               auto top = std::min(lastDragStart.m_y, pt.m_y);
+                               auto right = std::max(lastDragStart.m_x, pt.m_x);
+                               auto bottom = std::max(lastDragStart.m_y, pt.m_y);
 
                                rect.rect.SetLeft(left);
                                rect.rect.SetTop(top);
@@ -43,11 +44,42 @@ struct ShapeCreator
                            },
                            [&](Circle &circle)
                            {
-                               circle.radius = std::sqrt(std::pow(pt.x - circle.center.m_x, 2) + std::pow(pt.y - circle.center.m_y, 2));
+                               circle.radius = std::sqrt(std::pow(pt.m_x - circle.center.m_x, 2) + std::pow(pt.m_y - circle.center.m_y, 2));
+                           },
+                           [&](FilledPolygon &)
+                           {
+                               // polygons only come from baking, never from a tool
+                           },
+                           [&](Group &)
+                           {
+                               // nor do groups
+                           },
+                           [&](RasterImage &)
+                           {
+                               // images are imported
                            }},
                    shape.value());
     }
 
+    // Applies a batch of coalesced input points in one go
+    void Update(const std::vector<wxPoint2DDouble> &points)
+    {
+        if (points.empty())
+        {
+            return;
+        }
+
+        if (auto path = shape ? std::get_if<Path>(&shape.value()) : nullptr)
+        {
+            path->points.insert(path->points.end(), points.begin(), points.end());
+        }
+        else
+        {
+            // only the latest point matters for the other shapes
+            Update(points.back());
+        }
+    }
+
     CanvasObject FinishAndGenerateObject()
     {
         if (!shape)
@@ -78,5 +110,5 @@ struct ShapeCreator
 
 private:
     std::optional<Shape> shape;
-    wxPoint lastDragStart;
+    wxPoint2DDouble lastDragStart;
 };
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "snapping.h"
+#include "spatialindex.h"
+
+namespace
+{
+    // start, centre and end of a box along one axis
+    using Features = std::array<double, 3>;
+
+    Features XFeatures(const wxRect2DDouble &box)
+    {
+        return {box.m_x, box.m_x + box.m_width / 2.0, box.m_x + box.m_width};
+    }
+
+    Features YFeatures(const wxRect2DDouble &box)
+    {
+        return {box.m_y, box.m_y + box.m_height / 2.0, box.m_y + box.m_height};
+    }
+
+    // the closest target within the tolerance along one axis, which `delta` starts at
+    struct AxisSnap
+    {
+        double delta;
+        bool snapped{false};
+
+        void Consider(double target, const Features &moving)
+        {
+            for (const auto feature : moving)
+            {
+                Consider(target, feature);
+            }
+        }
+
+        void ConsiderGrid(double spacing, const Features &moving)
+        {
+            for (const auto feature : moving)
+            {
+                Consider(std::round(feature / spacing) * spacing, feature);
+            }
+        }
+
+    private:
+        void Consider(double target, double feature)
+        {
+            if (std::fabs(target - feature) < std::fabs(delta))
+            {
+                delta = target - feature;
+                snapped = true;
+            }
+        }
+    };
+
+    bool Aligned(double a, double b)
+    {
+        return std::fabs(a - b) <= 1e-9 * std::max({1.0, std::fabs(a), std::fabs(b)});
+    }
+
+    void AddGuide(std::vector<Snapping::Guide> &guides, bool vertical, double position, double from, double to)
+    {
+        for (auto &guide : guides)
+        {
+            if (guide.vertical == vertical && Aligned(guide.position, position))
+            {
+                guide.from = std::min(guide.from, from);
+                guide.to = std::max(guide.to, to);
+                return;
+            }
+        }
+
+        guides.push_back({vertical, position, from, to});
+    }
+}
+
+namespace Snapping
+{
+    Result Snap(const wxRect2DDouble &moving, const SpatialIndex &index, const std::vector<std::size_t> &ignored, const Options &options)
+    {
+        std::vector<wxRect2DDouble> neighbours;
+
+        if (options.toObjects)
+        {
+            auto area = moving;
+            area.Inset(-options.reach, -options.reach);
+
+            std::vector<std::size_t> candidates;
+            index.Query(area, candidates);
+
+            neighbours.reserve(candidates.size());
+
+            for (const auto candidate : candidates)
+            {
+                if (!std::binary_search(ignored.begin(), ignored.end(), candidate))
+                {
+                    neighbours.push_back(index.GetBounds(candidate));
+                }
+            }
+        }
+
+        const auto movingX = XFeatures(moving);
+        const auto movingY = YFeatures(moving);
+
+        // objects win ties with the grid: they are considered first and only a strictly closer line replaces them
+        AxisSnap x{options.tolerance};
+        AxisSnap y{options.tolerance};
+
+        for (const auto &neighbour : neighbours)
+        {
+            for (const auto target : XFeatures(neighbour))
+            {
+                x.Consider(target, movingX);
+            }
+
+            for (const auto target : YFeatures(neighbour))
+            {
+                y.Consider(target, movingY);
+            }
+        }
+
+        if (options.gridSpacing > 0)
+        {
+            x.ConsiderGrid(options.gridSpacing, movingX);
+            y.ConsiderGrid(options.gridSpacing, movingY);
+        }
+
+        Result result;
+        result.offset = {x.snapped ? x.delta : 0.0, y.snapped ? y.delta : 0.0};
+
+        auto snapped = moving;
+        snapped.m_x += result.offset.m_x;
+        snapped.m_y += result.offset.m_y;
+
+        const auto snappedX = XFeatures(snapped);
+        const auto snappedY = YFeatures(snapped);
+
+        // every neighbour the snapped box now lines up with gets a guide, not only the one it snapped to
+        for (const auto &neighbour : neighbours)
+        {
+            for (const auto target : XFeatures(neighbour))
+            {
+                if (x.snapped && std::any_of(snappedX.begin(), snappedX.end(), [&](double feature)
+                                             { return Aligned(feature, target); }))
+                {
+                    AddGuide(result.guides, true, target, std::min(snapped.m_y, neighbour.m_y),
+                             std::max(snapped.m_y + snapped.m_height, neighbour.m_y + neighbour.m_height));
+                }
+            }
+
+            for (const auto target : YFeatures(neighbour))
+            {
+                if (y.snapped && std::any_of(snappedY.begin(), snappedY.end(), [&](double feature)
+                                             { return Aligned(feature, target); }))
+                {
+                    AddGuide(result.guides, false, target, std::min(snapped.m_x, neighbour.m_x),
+                             std::max(snapped.m_x + snapped.m_width, neighbour.m_x + neighbour.m_width));
+                }
+            }
+        }
+
+        // a grid line only has the box to span
+        if (options.gridSpacing > 0)
+        {
+            for (std::size_t i = 0; i < 3; i++)
+            {
+                const double gridX = std::round(snappedX[i] / options.gridSpacing) * options.gridSpacing;
+                const double gridY = std::round(snappedY[i] / options.gridSpacing) * options.gridSpacing;
+
+                if (x.snapped && Aligned(snappedX[i], gridX))
+                {
+                    AddGuide(result.guides, true, gridX, snapped.m_y, snapped.m_y + snapped.m_height);
+                }
+
+                if (y.snapped && Aligned(snappedY[i], gridY))
+                {
+                    AddGuide(result.guides, false, gridY, snapped.m_x, snapped.m_x + snapped.m_width);
+                }
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include <wx/geometry.h>
+
+class SpatialIndex;
+
+// Aligns a moving box with the world bounds of nearby objects (edges and centres) and with a grid.
+// Candidates come from a range query around the box, so the cost follows the neighbourhood, not the document.
+namespace Snapping
+{
+    struct Options
+    {
+        double tolerance;     // how close a feature must be to snap, in world units
+        double reach;         // how far around the box to look for objects, in world units
+        double gridSpacing;   // 0 for no grid
+        bool toObjects{true};
+    };
+
+    // A line the snapped box lines up with, for drawing; `from` and `to` span the aligned boxes
+    struct Guide
+    {
+        bool vertical;
+        double position;
+        double from;
+        double to;
+    };
+
+    struct Result
+    {
+        wxPoint2DDouble offset; // to add to the box
+        std::vector<Guide> guides;
+    };
+
+    // `ignored` (sorted) are objects that move with the box, typically the selection
+    Result Snap(const wxRect2DDouble &moving, const SpatialIndex &index, const std::vector<std::size_t> &ignored, const Options &options);
+}
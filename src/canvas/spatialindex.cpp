@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "spatialindex.h"
+#include "canvasobject.h"
+#include "objectspace.h"
+
+void SpatialIndex::Box::Union(const Box &other)
+{
+    minX = std::min(minX, other.minX);
+    minY = std::min(minY, other.minY);
+    maxX = std::max(maxX, other.maxX);
+    maxY = std::max(maxY, other.maxY);
+}
+
+void SpatialIndex::Synchronize(const std::vector<CanvasObject> &objects, std::uint64_t sceneVersion, std::uint64_t rewriteVersion)
+{
+    if (synchronized && sceneVersion == this->sceneVersion && rewriteVersion == this->rewriteVersion)
+    {
+        return;
+    }
+
+    // after an append only the new objects need bounds
+    const bool appendOnly = synchronized && rewriteVersion == this->rewriteVersion && objects.size() >= objectBounds.size();
+    const std::size_t first = appendOnly ? objectBounds.size() : 0;
+
+    objectBounds.resize(objects.size());
+
+    for (std::size_t i = first; i < objects.size(); i++)
+    {
+        const auto bounds = ObjectSpace::GetWorldBounds(objects[i]);
+        objectBounds[i] = Box{bounds.m_x, bounds.m_y, bounds.m_x + bounds.m_width, bounds.m_y + bounds.m_height};
+    }
+
+    const std::size_t tail = objectBounds.size() - indexedCount;
+
+    if (!appendOnly || tail > std::max(MinimumTailToRebuild, indexedCount / 4))
+    {
+        Build();
+    }
+
+    synchronized = true;
+    this->sceneVersion = sceneVersion;
+    this->rewriteVersion = rewriteVersion;
+}
+
+void SpatialIndex::Build()
+{
+    const std::size_t count = objectBounds.size();
+
+    entries.resize(count);
+    std::iota(entries.begin(), entries.end(), std::size_t{0});
+
+    const auto centreX = [this](std::size_t i)
+    { return objectBounds[i].minX + objectBounds[i].maxX; };
+    const auto centreY = [this](std::size_t i)
+    { return objectBounds[i].minY + objectBounds[i].maxY; };
+
+    // sort-tile-recursive: vertical slices by x, each sorted by y, then cut into leaves
+    const std::size_t leafCount = (count + NodeCapacity - 1) / NodeCapacity;
+    const std::size_t sliceCount = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(leafCount)))));
+    const std::size_t sliceSize = sliceCount * NodeCapacity;
+
+    std::sort(entries.begin(), entries.end(), [&](std::size_t a, std::size_t b)
+              { return centreX(a) < centreX(b); });
+
+    for (std::size_t begin = 0; begin < count; begin += sliceSize)
+    {
+        const auto end = entries.begin() + std::min(count, begin + sliceSize);
+        std::sort(entries.begin() + begin, end, [&](std::size_t a, std::size_t b)
+                  { return centreY(a) < centreY(b); });
+    }
+
+    levels.clear();
+    levels.emplace_back();
+    levels.back().reserve(count);
+
+    for (const auto index : entries)
+    {
+        levels.back().push_back(objectBounds[index]);
+    }
+
+    while (levels.back().size() > 1)
+    {
+        const auto &below = levels.back();
+        std::vector<Box> level;
+        level.reserve((below.size() + NodeCapacity - 1) / NodeCapacity);
+
+        for (std::size_t begin = 0; begin < below.size(); begin += NodeCapacity)
+        {
+            Box box = below[begin];
+
+            for (std::size_t i = begin + 1; i < std::min(below.size(), begin + NodeCapacity); i++)
+            {
+                box.Union(below[i]);
+            }
+
+            level.push_back(box);
+        }
+
+        levels.push_back(std::move(level));
+    }
+
+    indexedCount = count;
+}
+
+void SpatialIndex::Query(const wxRect2DDouble &area, std::vector<std::size_t> &result) const
+{
+    const Box box{area.m_x, area.m_y, area.m_x + area.m_width, area.m_y + area.m_height};
+
+    if (indexedCount > 0)
+    {
+        for (std::size_t node = 0; node < levels.back().size(); node++)
+        {
+            QueryNode(levels.size() - 1, node, box, result);
+        }
+    }
+
+    for (std::size_t i = indexedCount; i < objectBounds.size(); i++)
+    {
+        if (objectBounds[i].Intersects(box))
+        {
+            result.push_back(i);
+        }
+    }
+}
+
+wxRect2DDouble SpatialIndex::GetBounds(std::size_t index) const
+{
+    const auto &box = objectBounds[index];
+    return {box.minX, box.minY, box.maxX - box.minX, box.maxY - box.minY};
+}
+
+void SpatialIndex::QueryNode(std::size_t level, std::size_t node, const Box &area, std::vector<std::size_t> &result) const
+{
+    if (!levels[level][node].Intersects(area))
+    {
+        return;
+    }
+
+    if (level == 0)
+    {
+        result.push_back(entries[node]);
+        return;
+    }
+
+    const std::size_t first = node * NodeCapacity;
+    const std::size_t last = std::min(levels[level - 1].size(), first + NodeCapacity);
+
+    for (std::size_t child = first; child < last; child++)
+    {
+        QueryNode(level - 1, child, area, result);
+    }
+}
+
+void SpatialIndex::Clear()
+{
+    objectBounds.clear();
+    entries.clear();
+    levels.clear();
+    indexedCount = 0;
+    synchronized = false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <wx/geometry.h>
+
+struct CanvasObject;
+
+// Packed R-tree over the world bounds of the objects, for rectangle queries. It is bulk-loaded
+// (sort-tile-recursive) when the document is rewritten; objects appended since then are kept in a
+// short unindexed tail that queries scan linearly, until the tail grows big enough to rebuild.
+class SpatialIndex
+{
+public:
+    // Brings the index up to date with `objects`; cheap when the versions haven't changed
+    void Synchronize(const std::vector<CanvasObject> &objects, std::uint64_t sceneVersion, std::uint64_t rewriteVersion);
+
+    // Appends the indices of the objects whose world bounds intersect `area`, in no particular order
+    void Query(const wxRect2DDouble &area, std::vector<std::size_t> &result) const;
+
+    // World bounds of an object as of the last Synchronize
+    wxRect2DDouble GetBounds(std::size_t index) const;
+
+    void Clear();
+
+private:
+    static constexpr std::size_t NodeCapacity = 16;
+    static constexpr std::size_t MinimumTailToRebuild = 1024;
+
+    struct Box
+    {
+        double minX, minY, maxX, maxY;
+
+        bool Intersects(const Box &other) const
+        {
+            return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+        }
+
+        void Union(const Box &other);
+    };
+
+    void Build();
+    void QueryNode(std::size_t level, std::size_t node, const Box &area, std::vector<std::size_t> &result) const;
+
+    std::vector<Box> objectBounds; // per object, in document order
+
+    // levels[0] has a box per leaf entry, in `entries` order; each level above has a box per
+    // NodeCapacity consecutive boxes of the level below
+    std::vector<std::size_t> entries;
+    std::vector<std::vector<Box>> levels;
+    std::size_t indexedCount{0}; // objects [indexedCount, size) are the tail
+
+    bool synchronized{false};
+    std::uint64_t sceneVersion{0};
+    std::uint64_t rewriteVersion{0};
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include <wx/graphics.h>
+#include <wx/affinematrix2d.h>
+
+// Maps world (document) coordinates to window coordinates: window = world * zoom + pan
+struct Viewport
+{
+    static constexpr double MinZoom = 1.0 / 64.0;
+    static constexpr double MaxZoom = 64.0;
+
+    double zoom{1.0};
+    wxPoint2DDouble pan{0, 0};
+
+    wxAffineMatrix2D GetMatrix() const
+    {
+        wxAffineMatrix2D matrix;
+        matrix.Translate(pan.m_x, pan.m_y);
+        matrix.Scale(zoom, zoom);
+        return matrix;
+    }
+
+    wxPoint2DDouble ToWorld(wxPoint2DDouble window) const
+    {
+        return {(window.m_x - pan.m_x) / zoom, (window.m_y - pan.m_y) / zoom};
+    }
+
+    wxPoint2DDouble ToWindow(wxPoint2DDouble world) const
+    {
+        return {world.m_x * zoom + pan.m_x, world.m_y * zoom + pan.m_y};
+    }
+
+    wxRect2DDouble ToWorld(const wxRect2DDouble &window) const
+    {
+        const auto leftTop = ToWorld(window.GetLeftTop());
+        return wxRect2DDouble(leftTop.m_x, leftTop.m_y, window.m_width / zoom, window.m_height / zoom);
+    }
+
+    wxRect2DDouble ToWindow(const wxRect2DDouble &world) const
+    {
+        const auto leftTop = ToWindow(world.GetLeftTop());
+        return wxRect2DDouble(leftTop.m_x, leftTop.m_y, world.m_width * zoom, world.m_height * zoom);
+    }
+
+    // Keeps the world point under `anchor` (window coordinates) in place
+    void ZoomAt(wxPoint2DDouble anchor, double factor)
+    {
+        const auto worldAnchor = ToWorld(anchor);
+
+        zoom = std::clamp(zoom * factor, MinZoom, MaxZoom);
+        pan = {anchor.m_x - worldAnchor.m_x * zoom, anchor.m_y - worldAnchor.m_y * zoom};
+    }
+
+    void PanBy(wxPoint2DDouble windowDelta)
+    {
+        pan += windowDelta;
+    }
+
+    bool operator==(const Viewport &other) const
+    {
+        return zoom == other.zoom && pan == other.pan;
+    }
+
+    bool operator!=(const Viewport &other) const
+    {
+        return !(*this == other);
+    }
+};
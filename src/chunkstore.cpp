@@ -0,0 +1,817 @@
+#include <wx/filename.h>
+#include <wx/log.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+#include "chunkstore.h"
+#include "canvas/grouping.h"
+
+namespace
+{
+    const std::shared_ptr<const Shape> &Placeholder()
+    {
+        static const auto placeholder = std::make_shared<const Shape>(Group{});
+        return placeholder;
+    }
+
+    std::size_t GeometryBytes(const Shape &shape)
+    {
+        return sizeof(Shape) + ShapeUtils::CountPoints(shape) * sizeof(wxPoint2DDouble);
+    }
+
+    // Images stay resident: their pixels live in a shared source that blocks don't hold
+    bool ContainsImage(const Shape &shape)
+    {
+        if (std::holds_alternative<RasterImage>(shape))
+        {
+            return true;
+        }
+
+        const auto group = std::get_if<Group>(&shape);
+        return group && std::any_of(group->children.begin(), group->children.end(), [](const CanvasObject &child)
+                                    { return ContainsImage(*child.shape); });
+    }
+
+    int ChunkOf(double coordinate)
+    {
+        return static_cast<int>(std::floor(coordinate / ChunkStore::ChunkSize));
+    }
+
+    enum class ShapeTag : std::uint8_t
+    {
+        Path,
+        Rect,
+        Circle,
+        Polygon,
+        Group
+    };
+
+    // A block is a run of object ids, each followed by its shape. Blocks are only read back by the process
+    // that wrote them, so values are stored as they are in memory and points are copied as one array.
+    struct BlockEncoder
+    {
+        std::vector<char> &bytes;
+
+        template <typename T>
+        void Put(const T &value)
+        {
+            const auto at = bytes.size();
+            bytes.resize(at + sizeof(T));
+            std::memcpy(bytes.data() + at, &value, sizeof(T));
+        }
+
+        void PutColour(const wxColour &colour)
+        {
+            std::array<std::uint8_t, 5> channels{};
+
+            if (colour.IsOk())
+            {
+                channels = {1, colour.Red(), colour.Green(), colour.Blue(), colour.Alpha()};
+            }
+
+            Put(channels);
+        }
+
+        void PutPoints(const std::vector<wxPoint2DDouble> &points)
+        {
+            Put<std::uint64_t>(points.size());
+
+            const auto at = bytes.size();
+            bytes.resize(at + points.size() * sizeof(wxPoint2DDouble));
+            std::memcpy(bytes.data() + at, points.data(), points.size() * sizeof(wxPoint2DDouble));
+        }
+
+        void PutShape(const Shape &shape)
+        {
+            std::visit(*this, shape);
+        }
+
+        void operator()(const Path &path)
+        {
+            Put(ShapeTag::Path);
+            PutColour(path.color);
+            Put<std::int32_t>(path.width);
+            PutPoints(path.points);
+        }
+
+        void operator()(const Rect &rect)
+        {
+            Put(ShapeTag::Rect);
+            PutColour(rect.color);
+            Put(rect.rect.m_x);
+            Put(rect.rect.m_y);
+            Put(rect.rect.m_width);
+            Put(rect.rect.m_height);
+        }
+
+        void operator()(const Circle &circle)
+        {
+            Put(ShapeTag::Circle);
+            PutColour(circle.color);
+            Put(circle.radius);
+            Put(circle.center.m_x);
+            Put(circle.center.m_y);
+        }
+
+        void operator()(const FilledPolygon &polygon)
+        {
+            Put(ShapeTag::Polygon);
+            PutColour(polygon.color);
+            PutPoints(polygon.points);
+        }
+
+        void operator()(const Group &group)
+        {
+            Put(ShapeTag::Group);
+            Put<std::uint64_t>(group.children.size());
+
+            for (const auto &child : group.children)
+            {
+                Put(child.transformation);
+                PutShape(*child.shape);
+            }
+        }
+
+        // never spilled, see ContainsImage
+        void operator()(const RasterImage &)
+        {
+        }
+    };
+
+    // Reads what BlockEncoder wrote; running past the end, or anything it can't have written, fails the block
+    struct BlockDecoder
+    {
+        const char *at;
+        const char *end;
+        bool failed{false};
+
+        template <typename T>
+        T Get()
+        {
+            T value{};
+
+            if (static_cast<std::size_t>(end - at) < sizeof(T))
+            {
+                failed = true;
+                return value;
+            }
+
+            std::memcpy(&value, at, sizeof(T));
+            at += sizeof(T);
+
+            return value;
+        }
+
+        // each colour gets its own reference count, so a block read on one thread can be released on another
+        wxColour GetColour()
+        {
+            const auto channels = Get<std::array<std::uint8_t, 5>>();
+            return channels[0] ? wxColour(channels[1], channels[2], channels[3], channels[4]) : wxColour();
+        }
+
+        std::vector<wxPoint2DDouble> GetPoints()
+        {
+            const auto count = Get<std::uint64_t>();
+
+            if (failed || count > static_cast<std::size_t>(end - at) / sizeof(wxPoint2DDouble))
+            {
+                failed = true;
+                return {};
+            }
+
+            std::vector<wxPoint2DDouble> points(count);
+            std::memcpy(points.data(), at, count * sizeof(wxPoint2DDouble));
+            at += count * sizeof(wxPoint2DDouble);
+
+            return points;
+        }
+
+        Shape GetShape()
+        {
+            switch (Get<ShapeTag>())
+            {
+            case ShapeTag::Path:
+            {
+                Path path{};
+                path.color = GetColour();
+                path.width = Get<std::int32_t>();
+                path.points = GetPoints();
+                return path;
+            }
+            case ShapeTag::Rect:
+            {
+                Rect rect;
+                rect.color = GetColour();
+                rect.rect.m_x = Get<double>();
+                rect.rect.m_y = Get<double>();
+                rect.rect.m_width = Get<double>();
+                rect.rect.m_height = Get<double>();
+                return rect;
+            }
+            case ShapeTag::Circle:
+            {
+                Circle circle{};
+                circle.color = GetColour();
+                circle.radius = Get<double>();
+                circle.center.m_x = Get<double>();
+                circle.center.m_y = Get<double>();
+                return circle;
+            }
+            case ShapeTag::Polygon:
+            {
+                FilledPolygon polygon{};
+                polygon.color = GetColour();
+                polygon.points = GetPoints();
+                return polygon;
+            }
+            case ShapeTag::Group:
+            {
+                const auto count = Get<std::uint64_t>();
+                std::vector<CanvasObject> children;
+
+                for (std::uint64_t i = 0; i < count && !failed; i++)
+                {
+                    const auto transformation = Get<Transformation>();
+                    children.emplace_back(GetShape(), transformation);
+                }
+
+                if (failed || children.empty())
+                {
+                    break;
+                }
+
+                return Grouping::BuildGroup(std::move(children));
+            }
+            }
+
+            failed = true;
+            return Group{};
+        }
+    };
+}
+
+ChunkStore::~ChunkStore()
+{
+    if (worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        wakeUp.notify_one();
+        worker.join();
+    }
+
+    if (file.IsOpened())
+    {
+        file.Close();
+        wxRemoveFile(path);
+    }
+}
+
+bool ChunkStore::IsSpilled(const CanvasObject &object)
+{
+    return object.shape == Placeholder();
+}
+
+bool ChunkStore::Restore(std::vector<CanvasObject> &objects, const std::vector<std::size_t> &indices)
+{
+    Collect(objects);
+
+    std::vector<std::size_t> wanted;
+
+    for (const auto index : indices)
+    {
+        if (IsSpilled(objects[index]))
+        {
+            wanted.push_back(locationOfId.at(objects[index].id).block);
+        }
+    }
+
+    if (wanted.empty())
+    {
+        return true;
+    }
+
+    std::sort(wanted.begin(), wanted.end());
+    wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+    Shapes shapes;
+    bool complete = true;
+
+    for (const auto block : wanted)
+    {
+        complete = ReadBlock(block, blocks[block], shapes) && complete;
+    }
+
+    Install(objects, shapes);
+
+    return complete;
+}
+
+bool ChunkStore::RestoreIf(std::vector<CanvasObject> &objects, const std::function<bool(const CanvasObject &)> &wanted)
+{
+    Collect(objects);
+
+    Shapes shapes;
+    std::size_t next = 0;
+
+    const auto pick = [&](const CanvasObject &object)
+    {
+        if (IsSpilled(objects[next++]) && wanted(object))
+        {
+            shapes.emplace(object.id, object.shape);
+        }
+    };
+
+    const bool complete = ForEachObject(objects, pick);
+
+    Install(objects, shapes);
+
+    return complete;
+}
+
+void ChunkStore::Prefetch(std::vector<CanvasObject> &objects, const std::vector<std::size_t> &indices)
+{
+    Collect(objects);
+
+    for (const auto index : indices)
+    {
+        if (!IsSpilled(objects[index]))
+        {
+            continue;
+        }
+
+        const auto block = locationOfId.at(objects[index].id).block;
+
+        if (prefetching.insert(block).second)
+        {
+            Submit(Job{false, block, blocks[block], {}});
+        }
+    }
+}
+
+void ChunkStore::Spill(std::vector<CanvasObject> &objects, const SpatialIndex &index, const wxRect2DDouble &keepArea,
+                       const std::vector<std::size_t> &pinned, std::size_t budget, std::uint64_t sceneVersion)
+{
+    Collect(objects);
+
+    const SpillState state{sceneVersion, ChunkOf(keepArea.m_x), ChunkOf(keepArea.m_y),
+                           ChunkOf(keepArea.m_x + keepArea.m_width), ChunkOf(keepArea.m_y + keepArea.m_height), residentVersion};
+
+    if (lastSpill == state)
+    {
+        return;
+    }
+
+    lastSpill = state;
+
+    // counting instances once per object overestimates, but needs no lookups: most passes end here
+    std::size_t upperBound = 0;
+
+    for (const auto &object : objects)
+    {
+        upperBound += GeometryBytes(*object.shape);
+    }
+
+    if (upperBound <= budget)
+    {
+        return;
+    }
+
+    // shapes on their way to the file are as good as gone
+    std::size_t resident = 0;
+    std::unordered_map<const Shape *, std::size_t> holders;
+
+    for (const auto &object : objects)
+    {
+        if (!IsSpilled(object) && !IsBeingWritten(object) && holders[object.shape.get()]++ == 0)
+        {
+            resident += GeometryBytes(*object.shape);
+        }
+    }
+
+    if (resident <= budget)
+    {
+        return;
+    }
+
+    // a shape is only freed if every reference to it goes: one also held by an object near the view,
+    // an undo step, the clipboard or a renderer's snapshot stays where it is
+    std::vector<std::size_t> candidates;
+    std::unordered_map<const Shape *, std::size_t> candidateHolders;
+    auto nextPinned = pinned.begin();
+
+    for (std::size_t i = 0; i < objects.size(); i++)
+    {
+        nextPinned = std::lower_bound(nextPinned, pinned.end(), i);
+
+        const auto &object = objects[i];
+
+        if ((nextPinned != pinned.end() && *nextPinned == i) || IsSpilled(object) || IsBeingWritten(object) ||
+            index.GetBounds(i).Intersects(keepArea) || ContainsImage(*object.shape))
+        {
+            continue;
+        }
+
+        candidates.push_back(i);
+        candidateHolders[object.shape.get()]++;
+    }
+
+    struct Chunk
+    {
+        std::vector<std::size_t> indices;
+        std::size_t bytes{0};
+    };
+
+    std::map<std::pair<int, int>, Chunk> chunks;
+    const auto keepCentre = keepArea.GetCentre();
+
+    for (const auto i : candidates)
+    {
+        const auto &object = objects[i];
+        const auto count = candidateHolders[object.shape.get()];
+
+        if (static_cast<long>(count) != object.shape.use_count())
+        {
+            continue;
+        }
+
+        const auto centre = index.GetBounds(i).GetCentre();
+        auto &chunk = chunks[{ChunkOf(centre.m_x), ChunkOf(centre.m_y)}];
+
+        // instances split their shape's bytes, wherever they are
+        chunk.indices.push_back(i);
+        chunk.bytes += GeometryBytes(*object.shape) / count;
+    }
+
+    std::vector<std::pair<double, Chunk *>> farthestFirst;
+
+    for (auto &[key, chunk] : chunks)
+    {
+        const double x = (key.first + 0.5) * ChunkSize - keepCentre.m_x;
+        const double y = (key.second + 0.5) * ChunkSize - keepCentre.m_y;
+        farthestFirst.emplace_back(x * x + y * y, &chunk);
+    }
+
+    std::sort(farthestFirst.begin(), farthestFirst.end(), [](const auto &a, const auto &b)
+              { return a.first > b.first; });
+
+    // down to three quarters of the budget, so drawing a little more doesn't spill again right away
+    const std::size_t target = budget / 4 * 3;
+
+    for (const auto &[distance, chunk] : farthestFirst)
+    {
+        if (resident <= target)
+        {
+            break;
+        }
+
+        const std::size_t block = blocks.size();
+        blocks.emplace_back();
+
+        Job job{true, block, {}, {}};
+
+        for (const auto i : chunk->indices)
+        {
+            const auto &object = objects[i];
+
+            if (locationOfId.emplace(object.id, Location{block, ShapeUtils::CountPoints(*object.shape)}).second)
+            {
+                job.shapes.emplace(object.id, object.shape);
+                blocks[block].bytes += GeometryBytes(*object.shape);
+            }
+        }
+
+        // geometry already on disk goes right away, the rest once its block has landed
+        for (const auto i : chunk->indices)
+        {
+            if (blocks[locationOfId.at(objects[i].id).block].offset != wxInvalidOffset)
+            {
+                objects[i].shape = Placeholder();
+            }
+        }
+
+        if (job.shapes.empty())
+        {
+            blocks.pop_back();
+        }
+        else
+        {
+            writesInFlight++;
+            Submit(std::move(job));
+        }
+
+        resident -= std::min(resident, chunk->bytes);
+    }
+}
+
+bool ChunkStore::ForEachObject(const std::vector<CanvasObject> &objects, const std::function<void(const CanvasObject &)> &use)
+{
+    std::unordered_map<std::size_t, Shapes> loaded;
+    std::size_t first = 0;
+
+    while (first < objects.size())
+    {
+        // the objects from `first` on whose blocks fit in the budget together
+        std::unordered_set<std::size_t> wanted;
+        std::size_t bytes = 0;
+        std::size_t end = first;
+
+        for (; end < objects.size(); end++)
+        {
+            if (!IsSpilled(objects[end]))
+            {
+                continue;
+            }
+
+            const auto block = locationOfId.at(objects[end].id).block;
+
+            if (wanted.count(block) == 0)
+            {
+                if (!wanted.empty() && bytes + blocks[block].bytes > ReadBudget)
+                {
+                    break;
+                }
+
+                wanted.insert(block);
+                bytes += blocks[block].bytes;
+            }
+        }
+
+        // blocks this run shares with the previous one aren't read again
+        for (auto it = loaded.begin(); it != loaded.end();)
+        {
+            it = wanted.count(it->first) > 0 ? std::next(it) : loaded.erase(it);
+        }
+
+        for (const auto block : wanted)
+        {
+            if (loaded.count(block) == 0 && !ReadBlock(block, blocks[block], loaded[block]))
+            {
+                return false;
+            }
+        }
+
+        for (std::size_t i = first; i < end; i++)
+        {
+            if (!IsSpilled(objects[i]))
+            {
+                use(objects[i]);
+                continue;
+            }
+
+            auto copy = objects[i];
+            copy.shape = loaded.at(locationOfId.at(copy.id).block).at(copy.id);
+
+            use(copy);
+        }
+
+        first = end;
+    }
+
+    return true;
+}
+
+std::size_t ChunkStore::CountPoints(const CanvasObject &object) const
+{
+    if (IsSpilled(object))
+    {
+        const auto location = locationOfId.find(object.id);
+        return location != locationOfId.end() ? location->second.points : 0;
+    }
+
+    return ShapeUtils::CountPoints(*object.shape);
+}
+
+bool ChunkStore::IsBeingWritten(const CanvasObject &object) const
+{
+    if (writesInFlight == 0)
+    {
+        return false;
+    }
+
+    const auto location = locationOfId.find(object.id);
+    return location != locationOfId.end() && blocks[location->second.block].offset == wxInvalidOffset;
+}
+
+void ChunkStore::Collect(std::vector<CanvasObject> &objects)
+{
+    std::vector<Job> done;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.swap(finished);
+    }
+
+    for (auto &job : done)
+    {
+        if (!job.write)
+        {
+            prefetching.erase(job.block);
+
+            if (job.succeeded)
+            {
+                Install(objects, job.shapes);
+            }
+
+            continue;
+        }
+
+        writesInFlight--;
+
+        if (job.succeeded)
+        {
+            blocks[job.block].offset = job.location.offset;
+            blocks[job.block].length = job.location.length;
+            residentVersion++;
+        }
+        else
+        {
+            // the shapes stay where they are; the next pass that isn't skipped tries again
+            for (const auto &[id, shape] : job.shapes)
+            {
+                locationOfId.erase(id);
+            }
+        }
+    }
+
+    // `done` releases the written shapes here, on the UI thread
+}
+
+void ChunkStore::Install(std::vector<CanvasObject> &objects, const Shapes &shapes)
+{
+    if (shapes.empty())
+    {
+        return;
+    }
+
+    // instances of a geometry share the restored copy, as they shared the original
+    for (auto &object : objects)
+    {
+        if (IsSpilled(object))
+        {
+            if (auto shape = shapes.find(object.id); shape != shapes.end())
+            {
+                object.shape = shape->second;
+            }
+        }
+    }
+
+    residentVersion++;
+}
+
+void ChunkStore::Submit(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // reads go first: the view is about to need them, while writes only free memory
+        if (job.write)
+        {
+            queued.push_back(std::move(job));
+        }
+        else
+        {
+            queued.push_front(std::move(job));
+        }
+    }
+
+    if (!worker.joinable())
+    {
+        worker = std::thread([this]
+                             { WorkerLoop(); });
+    }
+
+    wakeUp.notify_one();
+}
+
+void ChunkStore::WorkerLoop()
+{
+    while (true)
+    {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this]
+                        { return stopping || !queued.empty(); });
+
+            if (stopping)
+            {
+                return;
+            }
+
+            job = std::move(queued.front());
+            queued.pop_front();
+        }
+
+        job.succeeded = job.write ? WriteBlock(job) : ReadBlock(job.block, job.location, job.shapes);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(std::move(job));
+    }
+}
+
+bool ChunkStore::OpenFile()
+{
+    if (file.IsOpened())
+    {
+        return true;
+    }
+
+    path = wxFileName::CreateTempFileName(wxFileName(wxFileName::GetTempDir(), "paintchunks").GetFullPath());
+
+    return !path.empty() && file.Open(path, wxFile::read_write);
+}
+
+bool ChunkStore::WriteBlock(Job &job)
+{
+    std::vector<char> bytes;
+    BlockEncoder encoder{bytes};
+
+    for (const auto &[id, shape] : job.shapes)
+    {
+        encoder.Put(id);
+        encoder.PutShape(*shape);
+    }
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+
+    if (!OpenFile())
+    {
+        return false;
+    }
+
+    const wxFileOffset offset = file.SeekEnd();
+
+    if (offset == wxInvalidOffset || file.Write(bytes.data(), bytes.size()) != bytes.size())
+    {
+        return false;
+    }
+
+    job.location.offset = offset;
+    job.location.length = bytes.size();
+
+    return true;
+}
+
+bool ChunkStore::ReadBlock(std::size_t block, const Block &location, Shapes &shapes)
+{
+    std::vector<char> bytes(location.length);
+
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+
+        if (unreadable.count(block) > 0)
+        {
+            return false;
+        }
+
+        if (file.Seek(location.offset) == wxInvalidOffset || file.Read(bytes.data(), bytes.size()) != static_cast<ssize_t>(bytes.size()))
+        {
+            MarkUnreadable(block);
+            return false;
+        }
+    }
+
+    BlockDecoder decoder{bytes.data(), bytes.data() + bytes.size()};
+    Shapes read;
+
+    while (!decoder.failed && decoder.at != decoder.end)
+    {
+        const auto id = decoder.Get<std::uint64_t>();
+        auto shape = decoder.GetShape();
+
+        if (!decoder.failed)
+        {
+            read.emplace(id, std::make_shared<const Shape>(std::move(shape)));
+        }
+    }
+
+    if (decoder.failed)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        MarkUnreadable(block);
+        return false;
+    }
+
+    shapes.merge(read);
+    return true;
+}
+
+void ChunkStore::MarkUnreadable(std::size_t block)
+{
+    // one message for a failing file, not one per block
+    if (unreadable.empty())
+    {
+        wxLogError("Could not read back part of the drawing from %s", path);
+    }
+
+    unreadable.insert(block);
+}
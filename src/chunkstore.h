@@ -0,0 +1,154 @@
+#pragma once
+
+#include <wx/file.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "canvas/canvasobject.h"
+#include "canvas/spatialindex.h"
+
+// Moves the geometry of objects far from the view out to a cache file, so memory follows what is near
+// the view rather than the document's size. The world is cut into ChunkSize squares and each object
+// belongs to the chunk under its bounds centre; a far chunk is spilled as one block of the file, and its
+// objects' shapes are swapped for a shared empty placeholder. The objects themselves stay, with their
+// bounds, transformation and id, so indices, the spatial index and the history never notice. Anything
+// that edits the geometry of arbitrary objects restores it first; saving reads it through ForEachObject.
+//
+// Geometry is immutable per object id, so an id is written to the file once and stays valid: spilling
+// it again later costs no I/O, and placeholders kept by undo steps can always be restored.
+//
+// Blocks are written, and prefetched, by a thread of the store's own; what it finishes is put in place
+// by the next call on the UI thread. Shapes handed to it come back to be released there, and shapes it
+// reads back own their colours, so no wxColour reference count is shared across threads.
+class ChunkStore
+{
+public:
+    static constexpr double ChunkSize = 4096; // world units
+
+    // Geometry read back at once by a pass over the whole document
+    static constexpr std::size_t ReadBudget = 32 * 1024 * 1024;
+
+    ChunkStore() = default;
+    ~ChunkStore();
+
+    ChunkStore(const ChunkStore &) = delete;
+    ChunkStore &operator=(const ChunkStore &) = delete;
+
+    static bool IsSpilled(const CanvasObject &object);
+
+    // Reads back the chunks of the spilled objects among `indices`, waiting for them. Returns false if part
+    // of the file can't be read; the error is reported once and those objects stay spilled.
+    bool Restore(std::vector<CanvasObject> &objects, const std::vector<std::size_t> &indices);
+
+    // Reads back the spilled objects whose geometry `wanted` picks, going through the whole file a few
+    // blocks at a time so only what is picked stays. Returns false like Restore.
+    bool RestoreIf(std::vector<CanvasObject> &objects, const std::function<bool(const CanvasObject &)> &wanted);
+
+    // Starts reading back the chunks of the spilled objects among `indices` in the background; a later
+    // call puts them in place
+    void Prefetch(std::vector<CanvasObject> &objects, const std::vector<std::size_t> &indices);
+
+    // While the resident geometry is over `budget` bytes, spills chunks outside `keepArea`, farthest first.
+    // `pinned` (sorted) objects are never spilled, and `index` must be up to date with `objects`. Does
+    // nothing unless the scene, the chunks under `keepArea` or what is resident changed since the last call.
+    // A chunk written for the first time keeps its shapes until its block is on disk.
+    void Spill(std::vector<CanvasObject> &objects, const SpatialIndex &index, const wxRect2DDouble &keepArea,
+               const std::vector<std::size_t> &pinned, std::size_t budget, std::uint64_t sceneVersion);
+
+    // Calls `use` with every object in order, spilled ones as copies carrying their geometry. It is read
+    // back a few blocks at a time, about ReadBudget bytes of it, and dropped again; the document keeps its
+    // placeholders. Returns false, after reporting the error, if part of the file can't be read; `use` has
+    // then not seen every object. Several may run on different threads, as long as nothing restores,
+    // prefetches or spills meanwhile.
+    bool ForEachObject(const std::vector<CanvasObject> &objects, const std::function<void(const CanvasObject &)> &use);
+
+    // Vertices of the object's paths and polygons, spilled or not
+    std::size_t CountPoints(const CanvasObject &object) const;
+
+private:
+    using Shapes = std::unordered_map<std::uint64_t, std::shared_ptr<const Shape>>;
+
+    struct Block
+    {
+        wxFileOffset offset{wxInvalidOffset}; // until it is on disk
+        std::size_t length{0};
+        std::size_t bytes{0}; // its geometry, once read back
+    };
+
+    struct Location
+    {
+        std::size_t block;
+        std::size_t points;
+    };
+
+    // A block to write, with its shapes, or to read back, into them
+    struct Job
+    {
+        bool write;
+        std::size_t block;
+        Block location;
+        Shapes shapes;
+        bool succeeded{false};
+    };
+
+    struct SpillState
+    {
+        std::uint64_t sceneVersion;
+        int firstX, firstY, lastX, lastY; // chunks under the keep area
+        std::size_t residentVersion;
+
+        bool operator==(const SpillState &other) const
+        {
+            return sceneVersion == other.sceneVersion && firstX == other.firstX && firstY == other.firstY &&
+                   lastX == other.lastX && lastY == other.lastY && residentVersion == other.residentVersion;
+        }
+    };
+
+    bool IsBeingWritten(const CanvasObject &object) const;
+
+    // Puts in place the blocks the worker finished and releases the shapes it wrote
+    void Collect(std::vector<CanvasObject> &objects);
+
+    // Gives the spilled objects whose ids are in `shapes` their geometry back; instances share one copy
+    void Install(std::vector<CanvasObject> &objects, const Shapes &shapes);
+
+    void Submit(Job job);
+    void WorkerLoop();
+
+    // Any thread. The file is only touched under fileMutex, which OpenFile expects held.
+    bool OpenFile();
+    bool WriteBlock(Job &job);
+    bool ReadBlock(std::size_t block, const Block &location, Shapes &shapes);
+    void MarkUnreadable(std::size_t block);
+
+    wxFile file;
+    wxString path;
+    std::mutex fileMutex;
+    std::unordered_set<std::size_t> unreadable; // under fileMutex
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::deque<Job> queued;
+    std::vector<Job> finished;
+    bool stopping{false};
+    std::thread worker;
+
+    // UI thread only
+    std::vector<Block> blocks;
+    std::unordered_map<std::uint64_t, Location> locationOfId;
+    std::unordered_set<std::size_t> prefetching;
+    std::size_t writesInFlight{0};
+
+    std::size_t residentVersion{0}; // bumped whenever geometry comes back or a block lands, so the next Spill looks again
+    std::optional<SpillState> lastSpill;
+};
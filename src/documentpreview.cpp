@@ -0,0 +1,228 @@
+#include <wx/mstream.h>
+#include <wx/wfstream.h>
+#include <wx/xml/xml.h>
+#include <wx/zipstrm.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "documentpreview.h"
+#include "chunkstore.h"
+#include "xmlserializer.h"
+#include "canvas/objectspace.h"
+#include "rendering/pngstreamwriter.h"
+#include "rendering/shaperasterizer.h"
+#include "rendering/tiledexporter.h"
+
+namespace
+{
+    constexpr auto MetadataNodeName = "PaintMetadata";
+    constexpr auto BoundsNodeName = "Bounds";
+    constexpr auto ObjectCountAttribute = "objects";
+    constexpr auto PointCountAttribute = "points";
+
+    TiledExportSettings GetThumbnailSettings(const wxRect2DDouble &bounds)
+    {
+        auto area = bounds;
+
+        if (area.m_width <= 0 || area.m_height <= 0)
+        {
+            area = wxRect2DDouble(area.m_x, area.m_y, std::max(area.m_width, 1.0), std::max(area.m_height, 1.0));
+        }
+
+        const double margin = std::max(area.m_width, area.m_height) / 32;
+        area.Inset(-margin, -margin);
+
+        TiledExportSettings settings;
+        settings.sourceArea = area;
+
+        if (area.m_width >= area.m_height)
+        {
+            settings.outputWidth = DocumentPreviews::ThumbnailSize;
+            settings.outputHeight = std::max(1, static_cast<int>(std::lround(DocumentPreviews::ThumbnailSize * area.m_height / area.m_width)));
+        }
+        else
+        {
+            settings.outputHeight = DocumentPreviews::ThumbnailSize;
+            settings.outputWidth = std::max(1, static_cast<int>(std::lround(DocumentPreviews::ThumbnailSize * area.m_width / area.m_height)));
+        }
+
+        return settings;
+    }
+
+    bool ReadMetadata(wxInputStream &in, DocumentPreview &preview)
+    {
+        wxXmlDocument doc;
+
+        if (!doc.Load(in) || !doc.GetRoot() || doc.GetRoot()->GetName() != MetadataNodeName)
+        {
+            return false;
+        }
+
+        const wxXmlNode *root = doc.GetRoot();
+        unsigned long count = 0;
+
+        preview.formatVersion = root->GetAttribute(XmlNodeKeys::VersionAttribute);
+
+        root->GetAttribute(ObjectCountAttribute).ToULong(&count);
+        preview.objectCount = count;
+
+        count = 0;
+        root->GetAttribute(PointCountAttribute).ToULong(&count);
+        preview.pointCount = count;
+
+        for (const wxXmlNode *node = root->GetChildren(); node; node = node->GetNext())
+        {
+            if (node->GetName() == BoundsNodeName)
+            {
+                preview.bounds = wxRect2DDouble(wxAtof(node->GetAttribute(XmlNodeKeys::XAttribute)),
+                                                wxAtof(node->GetAttribute(XmlNodeKeys::YAttribute)),
+                                                wxAtof(node->GetAttribute(XmlNodeKeys::WidthAttribute)),
+                                                wxAtof(node->GetAttribute(XmlNodeKeys::HeightAttribute)));
+            }
+        }
+
+        return true;
+    }
+
+    bool ReadThumbnail(wxInputStream &in, wxImage &thumbnail)
+    {
+        // decode from memory: image handlers may want to seek, which zip entries can't
+        wxMemoryOutputStream buffer;
+        in.Read(buffer);
+
+        wxMemoryInputStream png(buffer);
+        return thumbnail.LoadFile(png, wxBITMAP_TYPE_PNG);
+    }
+}
+
+namespace DocumentPreviews
+{
+    DocumentPreview Describe(const std::vector<CanvasObject> &objects, const ChunkStore &chunks)
+    {
+        DocumentPreview preview;
+        preview.formatVersion = XmlNodeKeys::VersionValue;
+        preview.objectCount = objects.size();
+        preview.bounds = ObjectSpace::GetWorldBounds(objects);
+
+        for (const auto &object : objects)
+        {
+            preview.pointCount += chunks.CountPoints(object);
+        }
+
+        return preview;
+    }
+
+    std::future<std::vector<unsigned char>> RenderThumbnailAsync(const std::vector<CanvasObject> &objects, ChunkStore &chunks,
+                                                                 const wxRect2DDouble &bounds)
+    {
+        const auto settings = GetThumbnailSettings(bounds);
+        const double scale = settings.outputWidth / settings.sourceArea.m_width;
+
+        wxAffineMatrix2D view;
+        view.Scale(scale, scale);
+        view.Translate(-settings.sourceArea.m_x, -settings.sourceArea.m_y);
+
+        // the worker gets plain values, so it never touches shared wx ref counts. It draws the objects in
+        // order onto a single tile, as they stream past with their geometry.
+        return std::async(std::launch::async, [&objects, &chunks, view, width = settings.outputWidth, height = settings.outputHeight,
+                                               background = ShapeRasterizer::ToRgba(settings.background)]
+                          {
+                              RgbaImage image(width, height, background);
+                              ScanlineRasterizer rasterizer(width, height);
+                              std::vector<unsigned char> png;
+
+                              const auto draw = [&](const CanvasObject &object)
+                              {
+                                  ShapeRasterizer::Draw(rasterizer, image, object, view);
+                              };
+
+                              if (!chunks.ForEachObject(objects, draw))
+                              {
+                                  return png;
+                              }
+
+                              std::vector<unsigned char> rgb(static_cast<std::size_t>(width) * height * 3);
+                              image.CopyRgb(rgb.data());
+
+                              wxMemoryOutputStream out;
+                              PngStreamWriter writer(out, width, height, PngStreamWriter::PixelFormat::RGB);
+
+                              if (writer.WriteRows(rgb.data(), height) && writer.Finish())
+                              {
+                                  png.resize(out.GetSize());
+                                  out.CopyTo(png.data(), png.size());
+                              }
+
+                              return png; });
+    }
+
+    void Write(wxZipOutputStream &zip, const DocumentPreview &preview, const std::vector<unsigned char> &thumbnailPng)
+    {
+        auto root = new wxXmlNode(wxXML_ELEMENT_NODE, MetadataNodeName);
+        root->AddAttribute(XmlNodeKeys::VersionAttribute, preview.formatVersion);
+        root->AddAttribute(ObjectCountAttribute, wxString::Format("%zu", preview.objectCount));
+        root->AddAttribute(PointCountAttribute, wxString::Format("%zu", preview.pointCount));
+
+        auto boundsNode = new wxXmlNode(root, wxXML_ELEMENT_NODE, BoundsNodeName);
+        boundsNode->AddAttribute(XmlNodeKeys::XAttribute, wxString::FromDouble(preview.bounds.m_x));
+        boundsNode->AddAttribute(XmlNodeKeys::YAttribute, wxString::FromDouble(preview.bounds.m_y));
+        boundsNode->AddAttribute(XmlNodeKeys::WidthAttribute, wxString::FromDouble(preview.bounds.m_width));
+        boundsNode->AddAttribute(XmlNodeKeys::HeightAttribute, wxString::FromDouble(preview.bounds.m_height));
+
+        wxXmlDocument metadata;
+        metadata.SetRoot(root);
+
+        zip.PutNextEntry(ArchiveEntries::MetadataEntryName);
+        metadata.Save(zip);
+        zip.CloseEntry();
+
+        if (!thumbnailPng.empty())
+        {
+            // already deflated by the PNG encoder
+            auto entry = new wxZipEntry(ArchiveEntries::ThumbnailEntryName);
+            entry->SetMethod(wxZIP_METHOD_STORE);
+
+            zip.PutNextEntry(entry);
+            zip.Write(thumbnailPng.data(), thumbnailPng.size());
+            zip.CloseEntry();
+        }
+    }
+
+    bool Read(wxInputStream &in, DocumentPreview &preview)
+    {
+        wxZipInputStream zip(in);
+        bool hasMetadata = false;
+
+        for (std::unique_ptr<wxZipEntry> entry(zip.GetNextEntry()); entry; entry.reset(zip.GetNextEntry()))
+        {
+            const auto name = entry->GetName();
+
+            if (name == ArchiveEntries::DocumentEntryName)
+            {
+                break;
+            }
+
+            if (name == ArchiveEntries::MetadataEntryName)
+            {
+                hasMetadata = ReadMetadata(zip, preview);
+            }
+            else if (name == ArchiveEntries::ThumbnailEntryName)
+            {
+                ReadThumbnail(zip, preview.thumbnail);
+            }
+
+            zip.CloseEntry();
+        }
+
+        return hasMetadata;
+    }
+
+    bool Read(const wxString &path, DocumentPreview &preview)
+    {
+        wxFileInputStream in(path);
+
+        return in.IsOk() && Read(in, preview);
+    }
+}
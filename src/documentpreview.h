@@ -0,0 +1,48 @@
+#pragma once
+
+#include <wx/image.h>
+#include <wx/geometry.h>
+
+#include <future>
+#include <vector>
+
+class wxInputStream;
+class wxZipOutputStream;
+class ChunkStore;
+struct CanvasObject;
+
+// What a file browser needs to show a drawing without loading it
+struct DocumentPreview
+{
+    wxString formatVersion;
+
+    std::size_t objectCount{0};
+    std::size_t pointCount{0}; // vertices of paths and polygons
+    wxRect2DDouble bounds;     // world coordinates; empty for an empty drawing
+
+    wxImage thumbnail; // invalid if the file has none
+};
+
+// Reads and writes the metadata and thumbnail entries that precede the document body in a .pxz
+namespace DocumentPreviews
+{
+    constexpr int ThumbnailSize = 256; // longest side, in pixels
+
+    // Everything except the thumbnail; cheap enough for the UI thread. Spilled objects are counted from
+    // what `chunks` noted when it wrote them.
+    DocumentPreview Describe(const std::vector<CanvasObject> &objects, const ChunkStore &chunks);
+
+    // Renders the PNG with the software rasterizer on another thread, reading spilled geometry back through
+    // `chunks` a few blocks at a time. The objects and the store must stay alive and unchanged until
+    // the future is ready; the PNG is empty if the geometry couldn't be read.
+    std::future<std::vector<unsigned char>> RenderThumbnailAsync(const std::vector<CanvasObject> &objects, ChunkStore &chunks,
+                                                                 const wxRect2DDouble &bounds);
+
+    // Call before the document body is written
+    void Write(wxZipOutputStream &zip, const DocumentPreview &preview, const std::vector<unsigned char> &thumbnailPng);
+
+    // Reads only the preview entries and stops at the document body, so the body is never inflated.
+    // Returns false for files saved without a preview.
+    bool Read(wxInputStream &in, DocumentPreview &preview);
+    bool Read(const wxString &path, DocumentPreview &preview);
+}
@@ -1,24 +1,96 @@
 #include "drawingdocument.h"
+#include "documentpreview.h"
+#include "canvas/baking.h"
 #include "utils/streamutils.h"
+#include "utils/trace.h"
+#include "history/documentcommands.h"
+#include "history/drawinghistory.h"
+#include "myapp.h"
 
 wxIMPLEMENT_DYNAMIC_CLASS(DrawingDocument, wxDocument);
 
+void DrawingDocument::MarkObjectsChanged()
+{
+    sceneVersion++;
+    rewriteVersion++;
+    Modify(true);
+}
+
+void DrawingDocument::MarkObjectsAppended()
+{
+    sceneVersion++;
+    Modify(true);
+}
+
 std::ostream &DrawingDocument::SaveObject(std::ostream &stream)
 {
-    auto doc = serializer.SerializeCanvasObjects(objects);
+    Trace::Scope scope("DrawingDocument::SaveObject");
+
+    if (MyApp::GetToolSettings().bakeTransformationsOnSave)
+    {
+        // only what gets baked is read back; the next paint spills it again
+        if (!chunks.RestoreIf(objects, Baking::NeedsBaking))
+        {
+            stream.setstate(std::ios::failbit);
+            return stream;
+        }
+
+        // through the history, so earlier transform steps still undo against the right geometry. Saving
+        // never changes the drawing's look, so scaled fills and strokes that would round to another
+        // width stay transformed.
+        if (auto bake = ReplaceObjectsCommand::BakeAll(*this, "Bake on Save", true))
+        {
+            GetCommandProcessor()->Submit(bake.release());
+        }
+    }
+
+    // the thumbnail renders while the document is serialized, both reading spilled chunks straight from
+    // the cache file. If part of it can't be read the save fails rather than writing placeholders.
+    const auto preview = DocumentPreviews::Describe(objects, chunks);
+    auto thumbnail = DocumentPreviews::RenderThumbnailAsync(objects, chunks, preview.bounds);
+
+    const auto source = [this](const std::function<void(const CanvasObject &)> &use)
+    {
+        return chunks.ForEachObject(objects, use);
+    };
+
+    ImageEntries images;
+    wxXmlDocument doc;
+
+    if (!serializer.SerializeCanvasObjects(objects, source, images, doc))
+    {
+        stream.setstate(std::ios::failbit);
+        return stream;
+    }
 
     auto wrapper = OStreamWrapper(stream);
-    serializer.CompressXml(doc, wrapper);
+    wxZipOutputStream zip(wrapper);
+
+    DocumentPreviews::Write(zip, preview, thumbnail.get());
+    serializer.WriteXmlEntry(doc, zip);
+    serializer.WriteImageEntries(images, zip);
+
+    zip.Close();
 
     return stream;
 }
 
+wxCommandProcessor *DrawingDocument::OnCreateCommandProcessor()
+{
+    return new DrawingHistory(MyApp::GetToolSettings().historyMemoryBudget);
+}
+
 std::istream &DrawingDocument::LoadObject(std::istream &stream)
 {
+    Trace::Scope scope("DrawingDocument::LoadObject");
+
     auto wrapper = IStreamWrapper(stream);
-    auto doc = serializer.DecompressXml(wrapper);
+    EncodedImages images;
+    auto doc = serializer.DecompressXml(wrapper, images);
 
-    objects = serializer.DeserializeCanvasObjects(doc);
+    objects = serializer.DeserializeCanvasObjects(doc, images);
+    sceneVersion++;
+    rewriteVersion++;
 
     // workaround for wxWidgets problem: https://github.com/wxWidgets/wxWidgets/issues/23479
     stream.clear();
@@ -4,9 +4,11 @@
 #include <wx/stdstream.h>
 
 #include "xmlserializer.h"
+#include "chunkstore.h"
 #include "canvas/canvasobject.h"
 
 #include <iostream>
+#include <cstdint>
 
 class DrawingDocument : public wxDocument
 {
@@ -14,8 +16,28 @@ public:
     std::ostream &SaveObject(std::ostream &stream) override;
     std::istream &LoadObject(std::istream &stream) override;
 
+    wxCommandProcessor *OnCreateCommandProcessor() override;
+
+    // Bumped whenever the committed objects change, so renderers and caches can tell their data is stale.
+    // Transforming the selection only counts once the drag ends.
+    std::uint64_t GetSceneVersion() const { return sceneVersion; }
+
+    // Like the scene version, but not bumped by appending objects: while it is unchanged,
+    // objects seen earlier are still where they were and only new ones were added after them.
+    std::uint64_t GetRewriteVersion() const { return rewriteVersion; }
+
+    void MarkObjectsChanged();
+    void MarkObjectsAppended();
+
     std::vector<CanvasObject> objects;
     XmlSerializer serializer;
 
+    // Holds the geometry of far objects while the view is elsewhere; see ChunkStore
+    ChunkStore chunks;
+
     wxDECLARE_DYNAMIC_CLASS(DrawingDocument);
+
+private:
+    std::uint64_t sceneVersion{0};
+    std::uint64_t rewriteVersion{0};
 };
\ No newline at end of file
@@ -1,8 +1,16 @@
 #include <wx/graphics.h>
 
+#include <algorithm>
+#include <numeric>
+
 #include "drawingview.h"
 #include "myapp.h"
 #include "canvas/drawingcanvas.h"
+#include "canvas/baking.h"
+#include "canvas/erasing.h"
+#include "rendering/imagesource.h"
+#include "history/documentcommands.h"
+#include "utils/trace.h"
 
 wxIMPLEMENT_DYNAMIC_CLASS(DrawingView, wxView);
 
@@ -15,6 +23,9 @@ bool DrawingView::OnCreate(wxDocument *doc, long flags)
 
     MyApp::SetupCanvasForView(this);
 
+    // makes this the view the document manager sends Undo and Redo to
+    Activate(true);
+
     return true;
 }
 
@@ -22,11 +33,54 @@ bool DrawingView::OnClose(bool deleteWindow)
 {
     if (deleteWindow)
     {
+        canvas = nullptr;
         MyApp::SetupCanvasForView(nullptr);
     }
     return wxView::OnClose(deleteWindow);
 }
 
+void DrawingView::OnUpdate(wxView *, wxObject *)
+{
+    auto &objects = GetDocument()->objects;
+
+    // edits, undo and redo can move or remove the selected objects, or bring back spilled copies of them
+    if (selection.has_value())
+    {
+        const bool inRange = selection->GetIndices().back() < objects.size();
+
+        if (!inRange || !GetDocument()->chunks.Restore(objects, selection->GetIndices()) || !selection->Rebind(objects))
+        {
+            selection = {};
+        }
+    }
+
+    if (marquee.has_value())
+    {
+        UpdateMarqueeHits();
+    }
+
+    // the erased indices may point at other objects now; the rest of the stroke starts over
+    if (eraserStroke.has_value())
+    {
+        eraserStroke->erased.clear();
+    }
+
+    if (canvas)
+    {
+        canvas->Refresh();
+    }
+}
+
+void DrawingView::SetCanvas(wxWindow *window)
+{
+    canvas = window;
+}
+
+bool DrawingView::Submit(wxCommand *command)
+{
+    return GetDocument()->GetCommandProcessor()->Submit(command);
+}
+
 void DrawingView::OnChangeFilename()
 {
     wxString appName = wxTheApp->GetAppDisplayName();
@@ -40,33 +94,295 @@ void DrawingView::OnChangeFilename()
 
 void DrawingView::OnDraw(wxDC *dc)
 {
-    dc->SetBackground(*wxWHITE_BRUSH);
-    dc->Clear();
+    Trace::Scope scope("DrawingView::OnDraw");
+
+    {
+        Trace::Scope clearScope("OnDraw clear");
+
+        dc->SetBackground(*wxWHITE_BRUSH);
+        dc->Clear();
+    }
 
     std::unique_ptr<wxGraphicsContext> gc{wxGraphicsContext::CreateFromUnknownDC(*dc)};
 
     if (gc)
     {
-        for (const auto &obj : GetDocument()->objects)
         {
-            obj.Draw(*gc);
+            Trace::Scope objectsScope("OnDraw objects");
+
+            const auto size = dc->GetSize();
+            renderList.Build(GetDocument()->objects, viewport.ToWorld(wxRect2DDouble(0, 0, size.GetWidth(), size.GetHeight())), GetErasedIndices());
+
+            spriteCache.SetPolicy(MyApp::GetToolSettings().spriteCachePolicy);
+            spriteCache.BeginFrame(viewport.GetMatrix(), dc->GetContentScaleFactor());
+
+            gc->PushState();
+            gc->ConcatTransform(gc->CreateMatrix(viewport.GetMatrix()));
+            renderList.Execute(*gc, ApplyRenderQuality(*gc), &spriteCache);
+            gc->PopState();
         }
 
-        if (selection)
+        DrawOverlays(*gc);
+    }
+}
+
+void DrawingView::UpdateResidentChunks(wxSize windowSize)
+{
+    auto &document = *GetDocument();
+
+    // only the tiles overlapping the window are waited for; a window further out is read back in the
+    // background, and spilling starts a window beyond that, so panning back and forth doesn't thrash the file
+    const auto window = viewport.ToWorld(wxRect2DDouble(0, 0, windowSize.GetWidth(), windowSize.GetHeight()));
+    const double margin = std::max({windowSize.GetWidth(), windowSize.GetHeight(), 2 * TileCache::TileSize}) / viewport.zoom;
+
+    auto visibleArea = window;
+    visibleArea.Inset(-TileCache::TileSize / viewport.zoom, -TileCache::TileSize / viewport.zoom);
+
+    std::vector<std::size_t> nearby;
+    GetSpatialIndex().Query(visibleArea, nearby);
+    document.chunks.Restore(document.objects, nearby);
+
+    auto restoreArea = window;
+    restoreArea.Inset(-margin, -margin);
+
+    nearby.clear();
+    GetSpatialIndex().Query(restoreArea, nearby);
+    document.chunks.Prefetch(document.objects, nearby);
+
+    auto keepArea = restoreArea;
+    keepArea.Inset(-margin, -margin);
+
+    document.chunks.Spill(document.objects, GetSpatialIndex(), keepArea, GetSelectedIndices(),
+                          MyApp::GetToolSettings().residentGeometryBudget, document.GetSceneVersion());
+}
+
+void DrawingView::DrawObjects(wxGraphicsContext &gc, const std::vector<const CanvasObject *> &objects, double contentScale)
+{
+    GraphicsStyleCache styles(gc);
+
+    auto options = ApplyRenderQuality(gc);
+    options.styles = &styles;
+
+    spriteCache.SetPolicy(MyApp::GetToolSettings().spriteCachePolicy);
+    spriteCache.BeginFrame(viewport.GetMatrix(), contentScale);
+
+    gc.PushState();
+    gc.ConcatTransform(gc.CreateMatrix(viewport.GetMatrix()));
+
+    for (const auto *obj : objects)
+    {
+        if (!spriteCache.Draw(gc, *obj, ObjectSpace::GetTransformationMatrix(*obj)))
         {
-            selection->Draw(*gc);
+            obj->Draw(gc, options);
         }
+    }
+
+    gc.PopState();
+}
+
+DrawingOptions DrawingView::ApplyRenderQuality(wxGraphicsContext &gc) const
+{
+    const auto &policy = MyApp::GetToolSettings().renderQualityPolicy;
+    const bool interactive = renderQuality == RenderQuality::Interactive && policy.enabled;
+
+    gc.SetAntialiasMode(interactive && policy.disableAntialiasing ? wxANTIALIAS_NONE : wxANTIALIAS_DEFAULT);
+
+    DrawingOptions options;
+    options.pathPointBudget = interactive ? policy.pathPointBudget : 0;
+
+    return options;
+}
+
+void DrawingView::DrawOverlays(wxGraphicsContext &gc)
+{
+    // overlays are cheap, keep them crisp
+    gc.SetAntialiasMode(wxANTIALIAS_DEFAULT);
 
-        shapeCreator.Draw(*gc);
+    {
+        Trace::Scope scope("DrawOverlays creator");
+
+        gc.PushState();
+        gc.ConcatTransform(gc.CreateMatrix(viewport.GetMatrix()));
+        shapeCreator.Draw(gc);
+        gc.PopState();
+    }
+
+    if (selection)
+    {
+        Trace::Scope scope("DrawOverlays selection");
+        selection->Draw(gc, viewport.GetMatrix());
+    }
+
+    if (marquee)
+    {
+        DrawMarquee(gc);
+    }
+
+    if (eraserStroke)
+    {
+        DrawEraser(gc);
+    }
+
+    if (!snapGuides.empty())
+    {
+        DrawSnapGuides(gc);
     }
 }
 
-void DrawingView::OnMouseDown(wxPoint pt)
+// The covered objects are outlined here rather than excluded from the cached layers like the
+// selection, so growing the marquee never invalidates the tiles or the background frame
+void DrawingView::DrawMarquee(wxGraphicsContext &gc) const
 {
+    // past this many outlines the highlight costs more than it tells; one box around them will do
+    constexpr std::size_t MaxOutlinedHits = 4096;
+
+    const auto &objects = GetDocument()->objects;
+    const auto &matrix = viewport.GetMatrix();
+    const wxColour highlight(0, 120, 215);
+
+    gc.PushState();
+    gc.SetPen(wxPen(highlight, 1));
+    gc.SetBrush(*wxTRANSPARENT_BRUSH);
+
+    auto outlines = gc.CreatePath();
+
+    if (marquee->hits.size() <= MaxOutlinedHits)
+    {
+        for (const auto index : marquee->hits)
+        {
+            const auto &box = objects[index].boundingBox;
+            wxPoint2DDouble corners[] = {box.GetLeftTop(), box.GetRightTop(), box.GetRightBottom(), box.GetLeftBottom()};
+
+            ObjectSpace::ToScreenCoordinates(objects[index], corners, corners, 4);
+
+            outlines.MoveToPoint(matrix.TransformPoint(corners[0]));
+
+            for (int i = 1; i < 4; i++)
+            {
+                outlines.AddLineToPoint(matrix.TransformPoint(corners[i]));
+            }
+
+            outlines.CloseSubpath();
+        }
+    }
+    else
+    {
+        auto bounds = ObjectSpace::GetWorldBounds(objects[marquee->hits.front()]);
+
+        for (const auto index : marquee->hits)
+        {
+            bounds.Union(ObjectSpace::GetWorldBounds(objects[index]));
+        }
+
+        const auto leftTop = matrix.TransformPoint(bounds.GetLeftTop());
+        const auto rightBottom = matrix.TransformPoint(bounds.GetRightBottom());
+        outlines.AddRectangle(leftTop.m_x, leftTop.m_y, rightBottom.m_x - leftTop.m_x, rightBottom.m_y - leftTop.m_y);
+    }
+
+    gc.StrokePath(outlines);
+
+    const auto start = matrix.TransformPoint(marquee->start);
+    const auto end = matrix.TransformPoint(marquee->end);
+
+    gc.SetPen(wxPen(highlight, 1, wxPENSTYLE_SHORT_DASH));
+    gc.SetBrush(wxBrush(wxColour(0, 120, 215, 32)));
+    gc.DrawRectangle(std::min(start.m_x, end.m_x), std::min(start.m_y, end.m_y), std::abs(end.m_x - start.m_x), std::abs(end.m_y - start.m_y));
+
+    gc.PopState();
+}
+
+const SpriteCache &DrawingView::GetSpriteCache() const
+{
+    return spriteCache;
+}
+
+std::vector<const CanvasObject *> DrawingView::GetSelectedObjects() const
+{
+    std::vector<const CanvasObject *> selected;
+
+    if (selection.has_value())
+    {
+        selected.reserve(selection->GetIndices().size());
+
+        for (const auto index : selection->GetIndices())
+        {
+            selected.push_back(&GetDocument()->objects[index]);
+        }
+    }
+
+    return selected;
+}
+
+const std::vector<std::size_t> &DrawingView::GetSelectedIndices() const
+{
+    static const std::vector<std::size_t> none;
+    return selection.has_value() ? selection->GetIndices() : none;
+}
+
+const std::vector<std::size_t> &DrawingView::GetErasedIndices() const
+{
+    static const std::vector<std::size_t> none;
+    return eraserStroke.has_value() ? eraserStroke->erased : none;
+}
+
+const std::vector<std::size_t> &DrawingView::GetExcludedIndices() const
+{
+    return eraserStroke.has_value() ? eraserStroke->erased : GetSelectedIndices();
+}
+
+void DrawingView::SetRenderQuality(RenderQuality quality)
+{
+    renderQuality = quality;
+}
+
+RenderQuality DrawingView::GetRenderQuality() const
+{
+    return renderQuality;
+}
+
+const Viewport &DrawingView::GetViewport() const
+{
+    return viewport;
+}
+
+void DrawingView::ZoomAt(wxPoint anchor, double factor)
+{
+    viewport.ZoomAt(anchor, factor);
+
+    if (selection)
+    {
+        selection->SetHandleWidth(GetHandleWidth());
+    }
+}
+
+void DrawingView::PanBy(wxPoint delta)
+{
+    viewport.PanBy(delta);
+}
+
+void DrawingView::ResetViewport()
+{
+    viewport = {};
+
+    if (selection)
+    {
+        selection->SetHandleWidth(GetHandleWidth());
+    }
+}
+
+double DrawingView::GetHandleWidth() const
+{
+    return MyApp::GetToolSettings().selectionHandleWidth / viewport.zoom;
+}
+
+void DrawingView::OnMouseDown(wxPoint windowPt, bool extendSelection)
+{
+    const auto pt = viewport.ToWorld(windowPt);
+
     if (MyApp::GetToolSettings().currentTool == ToolType::Transform)
     {
         // prioritize current selection handles hit test
-        if (selection.has_value())
+        if (selection.has_value() && !extendSelection)
         {
             selection->StartDragIfClicked(pt);
         }
@@ -75,19 +391,48 @@ void DrawingView::OnMouseDown(wxPoint pt)
 
         if (!clickedOnCurrentSelection)
         {
-            // set selection to clicked object or clear selection if clicked on empty space
-            auto iterator = std::find_if(GetDocument()->objects.rbegin(), GetDocument()->objects.rend(), [&](auto &object)
-                                         { return object.boundingBox.Contains(ObjectSpace::ToObjectCoordinates(object, pt)); });
+            const auto hit = HitTest(pt);
 
-            selection = iterator != GetDocument()->objects.rend() ? std::make_optional(SelectionBox{*iterator, MyApp::GetToolSettings().selectionHandleWidth}) : std::nullopt;
+            if (!hit.has_value())
+            {
+                // a plain marquee replaces the selection, so drop it now rather than outline both
+                if (!extendSelection)
+                {
+                    selection = {};
+                }
 
-            // immediately start dragging if clicked on object
-            if (selection.has_value())
+                marquee = Marquee{pt, pt, extendSelection, {}};
+            }
+            else if (extendSelection)
             {
+                // toggle the clicked object, keeping the rest of the selection
+                auto indices = selection.has_value() ? selection->GetIndices() : std::vector<std::size_t>{};
+
+                if (auto found = std::find(indices.begin(), indices.end(), *hit); found != indices.end())
+                {
+                    indices.erase(found);
+                }
+                else
+                {
+                    indices.push_back(*hit);
+                }
+
+                Select(std::move(indices));
+            }
+            else
+            {
+                // select the clicked object and immediately start dragging it
+                Select({*hit});
                 selection->StartDragIfClicked(pt);
             }
         }
     }
+    else if (MyApp::GetToolSettings().currentTool == ToolType::Eraser)
+    {
+        selection = {};
+        eraserStroke = EraserStroke{pt, {}};
+        EraseAlong(pt);
+    }
     else
     {
         selection = {};
@@ -95,19 +440,43 @@ void DrawingView::OnMouseDown(wxPoint pt)
     }
 }
 
-void DrawingView::OnMouseDrag(wxPoint pt)
+void DrawingView::OnMouseDrag(const std::vector<wxPoint> &windowPoints)
 {
+    std::vector<wxPoint2DDouble> points;
+    points.reserve(windowPoints.size());
+
+    for (const auto &pt : windowPoints)
+    {
+        points.push_back(viewport.ToWorld(pt));
+    }
+
     if (MyApp::GetToolSettings().currentTool == ToolType::Transform)
     {
         if (selection.has_value() && selection->IsDragging())
         {
-            selection->Drag(pt);
+            // the whole batch moves every member once
+            selection->Drag(points);
             GetDocument()->Modify(true);
         }
+        else if (marquee.has_value() && !points.empty())
+        {
+            marquee->end = points.back();
+            UpdateMarqueeHits();
+        }
+    }
+    else if (MyApp::GetToolSettings().currentTool == ToolType::Eraser)
+    {
+        if (eraserStroke.has_value())
+        {
+            for (const auto &pt : points)
+            {
+                EraseAlong(pt);
+            }
+        }
     }
     else
     {
-        shapeCreator.Update(pt);
+        shapeCreator.Update(points);
     }
 }
 
@@ -115,24 +484,460 @@ void DrawingView::OnMouseDragEnd()
 {
     if (MyApp::GetToolSettings().currentTool == ToolType::Transform)
     {
-        if (selection.has_value())
+        if (marquee.has_value())
+        {
+            auto indices = std::move(marquee->hits);
+
+            if (marquee->extendSelection && selection.has_value())
+            {
+                indices.insert(indices.end(), selection->GetIndices().begin(), selection->GetIndices().end());
+            }
+
+            // an empty plain marquee, i.e. a click on empty space, leaves nothing selected
+            marquee = {};
+            Select(std::move(indices));
+        }
+        else if (selection.has_value())
+        {
+            if (selection->IsDragging())
+            {
+                // the whole drag becomes one undo step
+                const auto &objects = GetDocument()->objects;
+                const auto &indices = selection->GetIndices();
+                const auto &before = selection->GetDragStartTransformations();
+
+                std::vector<TransformObjectsCommand::Change> changes;
+
+                for (std::size_t i = 0; i < indices.size(); i++)
+                {
+                    if (objects[indices[i]].transformation != before[i])
+                    {
+                        changes.push_back({indices[i], before[i], objects[indices[i]].transformation});
+                    }
+                }
+
+                if (!changes.empty())
+                {
+                    Submit(new TransformObjectsCommand(*GetDocument(), std::move(changes)));
+                }
+            }
+
+            // the update above may have dropped the selection
+            if (selection.has_value())
+            {
+                selection->FinishDrag();
+            }
+
+            snapGuides.clear();
+        }
+    }
+    else if (MyApp::GetToolSettings().currentTool == ToolType::Eraser)
+    {
+        if (eraserStroke.has_value())
         {
-            selection->FinishDrag();
+            // the stroke ends before the command runs, so the update it causes paints the result
+            auto erased = std::move(eraserStroke->erased);
+            eraserStroke = {};
+
+            if (!erased.empty())
+            {
+                Submit(new RestructureCommand(*GetDocument(), "Erase", std::move(erased), {}));
+            }
         }
     }
     else
     {
         selection = {};
-        GetDocument()->objects.push_back(shapeCreator.FinishAndGenerateObject());
-        GetDocument()->Modify(true);
+        Submit(new AddObjectsCommand(*GetDocument(), shapeCreator.FinishAndGenerateObject()));
+    }
+}
+
+void DrawingView::Select(std::vector<std::size_t> indices)
+{
+    if (indices.empty())
+    {
+        selection = {};
+    }
+    else
+    {
+        // selected objects are drawn live and edited, so their geometry has to be in memory
+        if (!GetDocument()->chunks.Restore(GetDocument()->objects, indices))
+        {
+            selection = {};
+            return;
+        }
+
+        selection.emplace(GetDocument()->objects, std::move(indices), GetHandleWidth());
+        selection->SetTranslationSnap([this](const wxRect2DDouble &bounds)
+                                      { return SnapSelection(bounds); });
+    }
+}
+
+const SpatialIndex &DrawingView::GetSpatialIndex()
+{
+    const auto &document = *GetDocument();
+    spatialIndex.Synchronize(document.objects, document.GetSceneVersion(), document.GetRewriteVersion());
+
+    return spatialIndex;
+}
+
+std::optional<std::size_t> DrawingView::HitTest(wxPoint2DDouble pt)
+{
+    const auto &objects = GetDocument()->objects;
+
+    std::vector<std::size_t> candidates;
+    GetSpatialIndex().Query(wxRect2DDouble(pt.m_x, pt.m_y, 0, 0), candidates);
+
+    std::optional<std::size_t> topmost;
+
+    for (const auto index : candidates)
+    {
+        if ((!topmost.has_value() || index > *topmost) &&
+            ObjectSpace::HitTest(objects[index], pt))
+        {
+            topmost = index;
+        }
     }
+
+    return topmost;
+}
+
+// The index narrows the marquee down to the objects whose world bounds it touches; rotated
+// ones among them are then checked against their actual box
+void DrawingView::UpdateMarqueeHits()
+{
+    const auto &objects = GetDocument()->objects;
+
+    const wxRect2DDouble area(std::min(marquee->start.m_x, marquee->end.m_x), std::min(marquee->start.m_y, marquee->end.m_y),
+                              std::abs(marquee->end.m_x - marquee->start.m_x), std::abs(marquee->end.m_y - marquee->start.m_y));
+
+    auto &hits = marquee->hits;
+    hits.clear();
+    GetSpatialIndex().Query(area, hits);
+
+    hits.erase(std::remove_if(hits.begin(), hits.end(), [&](std::size_t index)
+                              { return !ObjectSpace::OverlapsWorldRect(objects[index], area); }),
+               hits.end());
+
+    std::sort(hits.begin(), hits.end());
+}
+
+// The members are left out of the candidates; their entries in the index are stale mid-drag anyway,
+// since moving doesn't change the scene version until the drag is committed
+wxPoint2DDouble DrawingView::SnapSelection(const wxRect2DDouble &bounds)
+{
+    // objects within this many snap distances of the box are candidates, a few hundred pixels
+    constexpr double ReachInSnapDistances = 64.0;
+
+    const auto &settings = MyApp::GetToolSettings();
+
+    snapGuides.clear();
+
+    if (!settings.snapToObjects && !settings.snapToGrid)
+    {
+        return {0, 0};
+    }
+
+    Snapping::Options options;
+    options.tolerance = settings.snapDistance / viewport.zoom;
+    options.reach = options.tolerance * ReachInSnapDistances;
+    options.gridSpacing = settings.snapToGrid ? settings.gridSpacing : 0.0;
+    options.toObjects = settings.snapToObjects;
+
+    auto result = Snapping::Snap(bounds, GetSpatialIndex(), GetSelectedIndices(), options);
+    snapGuides = std::move(result.guides);
+
+    return result.offset;
+}
+
+void DrawingView::DrawSnapGuides(wxGraphicsContext &gc) const
+{
+    const auto &matrix = viewport.GetMatrix();
+
+    gc.PushState();
+    gc.SetPen(wxPen(wxColour(230, 40, 140), 1));
+
+    for (const auto &guide : snapGuides)
+    {
+        const auto from = matrix.TransformPoint(guide.vertical ? wxPoint2DDouble{guide.position, guide.from} : wxPoint2DDouble{guide.from, guide.position});
+        const auto to = matrix.TransformPoint(guide.vertical ? wxPoint2DDouble{guide.position, guide.to} : wxPoint2DDouble{guide.to, guide.position});
+
+        gc.StrokeLine(from.m_x, from.m_y, to.m_x, to.m_y);
+    }
+
+    gc.PopState();
+}
+
+double DrawingView::GetEraserRadius() const
+{
+    constexpr int MinimumWidth = 8;
+
+    return std::max(MyApp::GetToolSettings().currentWidth, MinimumWidth) / 2.0 / viewport.zoom;
+}
+
+// The index narrows each stroke segment down to the objects whose world bounds its capsule touches;
+// only those are tested against their geometry, so a stroke costs the same in any size of scene
+void DrawingView::EraseAlong(wxPoint2DDouble to)
+{
+    const auto &objects = GetDocument()->objects;
+    const double radius = GetEraserRadius();
+    const auto from = eraserStroke->last;
+
+    const wxRect2DDouble area(std::min(from.m_x, to.m_x) - radius, std::min(from.m_y, to.m_y) - radius,
+                              std::abs(to.m_x - from.m_x) + 2 * radius, std::abs(to.m_y - from.m_y) + 2 * radius);
+
+    std::vector<std::size_t> candidates;
+    GetSpatialIndex().Query(area, candidates);
+
+    auto &erased = eraserStroke->erased;
+    const auto previousCount = static_cast<std::ptrdiff_t>(erased.size());
+
+    for (const auto index : candidates)
+    {
+        if (!std::binary_search(erased.begin(), erased.begin() + previousCount, index) &&
+            Erasing::Touches(objects[index], from, to, radius))
+        {
+            erased.push_back(index);
+        }
+    }
+
+    std::sort(erased.begin() + previousCount, erased.end());
+    std::inplace_merge(erased.begin(), erased.begin() + previousCount, erased.end());
+
+    eraserStroke->last = to;
+}
+
+void DrawingView::DrawEraser(wxGraphicsContext &gc) const
+{
+    const auto centre = viewport.GetMatrix().TransformPoint(eraserStroke->last);
+    const double radius = GetEraserRadius() * viewport.zoom;
+
+    gc.PushState();
+    gc.SetPen(wxPen(wxColour(80, 80, 80), 1));
+    gc.SetBrush(wxBrush(wxColour(255, 255, 255, 96)));
+    gc.DrawEllipse(centre.m_x - radius, centre.m_y - radius, 2 * radius, 2 * radius);
+    gc.PopState();
+}
+
+void DrawingView::OnSelectAll()
+{
+    std::vector<std::size_t> indices(GetDocument()->objects.size());
+    std::iota(indices.begin(), indices.end(), std::size_t{0});
+
+    Select(std::move(indices));
+
+    if (canvas)
+    {
+        canvas->Refresh();
+    }
+}
+
+void DrawingView::OnCopy()
+{
+    auto &clipboard = MyApp::GetClipboard();
+    clipboard.clear();
+
+    for (const auto *object : GetSelectedObjects())
+    {
+        clipboard.push_back(*object);
+    }
+}
+
+void DrawingView::OnPaste()
+{
+    auto &clipboard = MyApp::GetClipboard();
+
+    if (clipboard.empty())
+    {
+        return;
+    }
+
+    // every paste lands one offset further, so repeated pastes don't pile up
+    const auto offset = GetCopyOffset();
+
+    for (auto &object : clipboard)
+    {
+        object.transformation.translationX += offset.m_x;
+        object.transformation.translationY += offset.m_y;
+    }
+
+    AddAndSelect("Paste", clipboard);
+}
+
+void DrawingView::OnDuplicate()
+{
+    std::vector<CanvasObject> copies;
+    const auto offset = GetCopyOffset();
+
+    for (const auto *object : GetSelectedObjects())
+    {
+        copies.push_back(*object);
+        copies.back().transformation.translationX += offset.m_x;
+        copies.back().transformation.translationY += offset.m_y;
+    }
+
+    AddAndSelect("Duplicate", std::move(copies));
+}
+
+void DrawingView::OnDuplicateInArray(std::size_t count)
+{
+    const auto selected = GetSelectedObjects();
+
+    if (selected.empty())
+    {
+        return;
+    }
+
+    auto bounds = ObjectSpace::GetWorldBounds(*selected.front());
+
+    for (const auto *object : selected)
+    {
+        bounds.Union(ObjectSpace::GetWorldBounds(*object));
+    }
+
+    const double step = bounds.m_width + GetCopyOffset().m_x;
+
+    std::vector<CanvasObject> copies;
+    copies.reserve(count * selected.size());
+
+    for (std::size_t i = 1; i <= count; i++)
+    {
+        for (const auto *object : selected)
+        {
+            copies.push_back(*object);
+            copies.back().transformation.translationX += step * i;
+        }
+    }
+
+    AddAndSelect("Duplicate in Array", std::move(copies));
+}
+
+bool DrawingView::OnImportImage(std::vector<unsigned char> encoded, const std::string &extension)
+{
+    auto source = ImageSource::Import(std::move(encoded), extension);
+
+    if (!source)
+    {
+        return false;
+    }
+
+    const auto windowSize = canvas ? canvas->GetClientSize() : wxSize(source->GetWidth(), source->GetHeight());
+    const auto visibleArea = viewport.ToWorld(wxRect2DDouble(0, 0, windowSize.GetWidth(), windowSize.GetHeight()));
+
+    // one image pixel per window pixel unless that overflows three quarters of the window
+    const double fit = 0.75 * std::min(visibleArea.m_width / source->GetWidth(), visibleArea.m_height / source->GetHeight());
+    const double scale = std::min(1.0 / viewport.zoom, fit);
+
+    const double width = source->GetWidth() * scale;
+    const double height = source->GetHeight() * scale;
+    const auto centre = visibleArea.GetCentre();
+
+    std::vector<CanvasObject> imported;
+    imported.emplace_back(RasterImage{std::move(source), {centre.m_x - width / 2, centre.m_y - height / 2, width, height}});
+
+    AddAndSelect("Import Image", std::move(imported));
+    return true;
+}
+
+void DrawingView::AddAndSelect(const wxString &commandName, std::vector<CanvasObject> copies)
+{
+    if (copies.empty())
+    {
+        return;
+    }
+
+    const std::size_t first = GetDocument()->objects.size();
+
+    std::vector<std::size_t> indices(copies.size());
+    std::iota(indices.begin(), indices.end(), first);
+
+    if (Submit(new AddObjectsCommand(*GetDocument(), commandName, std::move(copies))))
+    {
+        Select(std::move(indices));
+    }
+
+    if (canvas)
+    {
+        canvas->Refresh();
+    }
+}
+
+void DrawingView::OnGroup()
+{
+    if (selection.has_value())
+    {
+        RestructureAndSelect(RestructureCommand::GroupObjects(*GetDocument(), selection->GetIndices()));
+    }
+}
+
+void DrawingView::OnUngroup()
+{
+    if (selection.has_value())
+    {
+        RestructureAndSelect(RestructureCommand::UngroupObjects(*GetDocument(), selection->GetIndices()));
+    }
+}
+
+void DrawingView::RestructureAndSelect(std::unique_ptr<RestructureCommand> command)
+{
+    if (!command)
+    {
+        return;
+    }
+
+    auto indices = command->GetInsertedIndices();
+
+    if (Submit(command.release()))
+    {
+        Select(std::move(indices));
+    }
+
+    if (canvas)
+    {
+        canvas->Refresh();
+    }
+}
+
+wxPoint2DDouble DrawingView::GetCopyOffset() const
+{
+    constexpr double CopyOffsetInPixels = 16;
+    return {CopyOffsetInPixels / viewport.zoom, CopyOffsetInPixels / viewport.zoom};
 }
 
 void DrawingView::OnClear()
 {
     selection = {};
-    GetDocument()->objects.clear();
-    GetDocument()->Modify(true);
+
+    if (!GetDocument()->objects.empty())
+    {
+        Submit(new ClearCommand(*GetDocument()));
+    }
+}
+
+void DrawingView::OnBakeSelection()
+{
+    if (!selection.has_value())
+    {
+        return;
+    }
+
+    if (auto bake = ReplaceObjectsCommand::Bake(*GetDocument(), "Bake Selection", selection->GetIndices()))
+    {
+        Submit(bake.release());
+    }
+}
+
+void DrawingView::OnBakeAll()
+{
+    if (!GetDocument()->chunks.RestoreIf(GetDocument()->objects, Baking::NeedsBaking))
+    {
+        return;
+    }
+
+    if (auto bake = ReplaceObjectsCommand::BakeAll(*GetDocument(), "Bake All"))
+    {
+        Submit(bake.release());
+    }
 }
 
 DrawingDocument *DrawingView::GetDocument() const
@@ -1,13 +1,21 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 
 #include <wx/docview.h>
 
 #include "drawingdocument.h"
 #include "canvas/canvasobject.h"
 #include "canvas/shapecreator.h"
-#include "canvas/selectionbox.h"
+#include "canvas/selection.h"
+#include "canvas/snapping.h"
+#include "canvas/spatialindex.h"
+#include "canvas/viewport.h"
+#include "rendering/renderquality.h"
+#include "rendering/renderlist.h"
+
+class RestructureCommand;
 
 class DrawingView : public wxView
 {
@@ -16,11 +24,73 @@ public:
 
     void OnDraw(wxDC *dc) override;
 
-    void OnMouseDown(wxPoint);
-    void OnMouseDrag(wxPoint);
+    // Called after every document command, including undo and redo
+    void OnUpdate(wxView *sender, wxObject *hint = nullptr) override;
+
+    // The window that displays this view, refreshed on updates
+    void SetCanvas(wxWindow *window);
+
+    // Restores the geometry a window of `windowSize` shows, prefetches what is around it and spills far
+    // chunks while the document is over its memory budget. Called before each paint, whichever way it draws.
+    void UpdateResidentChunks(wxSize windowSize);
+
+    // The two phases of OnDraw, for canvases that supply most of the objects from elsewhere.
+    // Both take a context in window coordinates and apply the viewport themselves.
+    void DrawObjects(wxGraphicsContext &gc, const std::vector<const CanvasObject *> &objects, double contentScale);
+    void DrawOverlays(wxGraphicsContext &gc);
+
+    // Selected objects in z-order, and their indices (sorted)
+    std::vector<const CanvasObject *> GetSelectedObjects() const;
+    const std::vector<std::size_t> &GetSelectedIndices() const;
+
+    // Objects the current eraser stroke has taken (sorted); they stay in the document until the stroke ends
+    const std::vector<std::size_t> &GetErasedIndices() const;
+
+    // What cached layers leave out (sorted): the erased objects during a stroke, otherwise the selection
+    const std::vector<std::size_t> &GetExcludedIndices() const;
+
+    const SpriteCache &GetSpriteCache() const;
+
+    // Index over the document's current objects, brought up to date on use
+    const SpatialIndex &GetSpatialIndex();
+
+    // `extendSelection` toggles the clicked object in the selection instead of replacing it.
+    // Pressing on empty space with the Transform tool starts a marquee (rubber-band) selection.
+    // With the Eraser tool a drag removes every object it touches, as one undo step.
+    void OnMouseDown(wxPoint, bool extendSelection = false);
+    void OnMouseDrag(const std::vector<wxPoint> &);
     void OnMouseDragEnd();
 
+    void SetRenderQuality(RenderQuality quality);
+    RenderQuality GetRenderQuality() const;
+
+    // Mouse input arrives in window coordinates and is mapped to the world through the viewport
+    const Viewport &GetViewport() const;
+    void ZoomAt(wxPoint anchor, double factor);
+    void PanBy(wxPoint delta);
+    void ResetViewport();
+
+    void OnSelectAll();
+
+    // Copies share their geometry with the originals, so copying, pasting and duplicating cost one
+    // CanvasObject per object however heavy the shapes are. The pasted or duplicated objects become the selection.
+    void OnCopy();
+    void OnPaste();
+    void OnDuplicate();
+    // `count` copies of the selection in a row to its right
+    void OnDuplicateInArray(std::size_t count);
+
+    // Places the image centred in view, shrunk to fit if it's bigger than the window, and selects it.
+    // False if the bytes aren't an image wx can read.
+    bool OnImportImage(std::vector<unsigned char> encoded, const std::string &extension);
+
+    // Grouping the selection replaces it with one object; ungrouping selects the groups' children
+    void OnGroup();
+    void OnUngroup();
+
     void OnClear();
+    void OnBakeSelection();
+    void OnBakeAll();
     bool OnClose(bool deleteWindow = true) override;
 
     // Setting the Frame title
@@ -29,7 +99,66 @@ public:
     DrawingDocument *GetDocument() const;
 
     ShapeCreator shapeCreator;
-    std::optional<SelectionBox> selection;
+    std::optional<Selection> selection;
 
     wxDECLARE_DYNAMIC_CLASS(DrawingView);
+
+private:
+    // Sets up `gc` for the current render quality and returns the matching drawing options
+    DrawingOptions ApplyRenderQuality(wxGraphicsContext &gc) const;
+
+    // Selection handle size in world units for the current zoom
+    double GetHandleWidth() const;
+
+    // False if the command failed, in which case the history has deleted it
+    bool Submit(wxCommand *command);
+    void Select(std::vector<std::size_t> indices);
+
+    // Appends `copies` as one undo step and selects them
+    void AddAndSelect(const wxString &commandName, std::vector<CanvasObject> copies);
+    void RestructureAndSelect(std::unique_ptr<RestructureCommand> command);
+
+    // Offset between an object and its pasted or duplicated copy, in world units
+    wxPoint2DDouble GetCopyOffset() const;
+
+    // Topmost object whose box contains `pt`
+    std::optional<std::size_t> HitTest(wxPoint2DDouble pt);
+
+    void UpdateMarqueeHits();
+    void DrawMarquee(wxGraphicsContext &gc) const;
+
+    // The selection's translation snap: aligns `bounds` with nearby objects and the grid, and keeps the guides to draw
+    wxPoint2DDouble SnapSelection(const wxRect2DDouble &bounds);
+    void DrawSnapGuides(wxGraphicsContext &gc) const;
+
+    // Eraser radius in world units; the width setting is taken in pixels so the eraser feels the same at any zoom
+    double GetEraserRadius() const;
+    void EraseAlong(wxPoint2DDouble to);
+    void DrawEraser(wxGraphicsContext &gc) const;
+
+    struct Marquee
+    {
+        wxPoint2DDouble start;
+        wxPoint2DDouble end;
+        bool extendSelection;
+        std::vector<std::size_t> hits; // sorted
+    };
+
+    struct EraserStroke
+    {
+        wxPoint2DDouble last;
+        std::vector<std::size_t> erased; // sorted
+    };
+
+    RenderQuality renderQuality{RenderQuality::Full};
+    RenderList renderList;
+    SpriteCache spriteCache;
+    Viewport viewport;
+
+    SpatialIndex spatialIndex;
+    std::optional<Marquee> marquee;
+    std::optional<EraserStroke> eraserStroke;
+    std::vector<Snapping::Guide> snapGuides; // while the selection is moved
+
+    wxWindow *canvas{nullptr};
 };
\ No newline at end of file
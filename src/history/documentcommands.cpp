@@ -0,0 +1,431 @@
+#include <algorithm>
+
+#include "documentcommands.h"
+#include "../drawingdocument.h"
+#include "../canvas/baking.h"
+#include "../canvas/grouping.h"
+#include "../rendering/imagesource.h"
+
+namespace
+{
+    // Encoded bytes of the images in a shape, each split between the shapes sharing its source
+    std::size_t EstimateImageBytes(const Shape &shape)
+    {
+        if (const auto image = std::get_if<RasterImage>(&shape))
+        {
+            return image->source->GetEncoded().size() / std::max<long>(image->source.use_count(), 1);
+        }
+
+        std::size_t bytes = 0;
+
+        if (const auto group = std::get_if<Group>(&shape))
+        {
+            for (const auto &child : group->children)
+            {
+                bytes += EstimateImageBytes(*child.shape);
+            }
+        }
+
+        return bytes;
+    }
+}
+
+std::size_t DocumentCommand::EstimateMemoryUsage(const CanvasObject &object)
+{
+    // shared geometry is split between its owners, so a thousand instances don't count it a thousand times
+    const std::size_t owners = std::max<long>(object.shape.use_count(), 1);
+    const std::size_t shapeBytes = ShapeUtils::CountPoints(*object.shape) * sizeof(wxPoint2DDouble) + EstimateImageBytes(*object.shape);
+
+    return sizeof(CanvasObject) + shapeBytes / owners;
+}
+
+void DocumentCommand::NotifyChanged(bool appendedOnly)
+{
+    if (appendedOnly)
+    {
+        document.MarkObjectsAppended();
+    }
+    else
+    {
+        document.MarkObjectsChanged();
+    }
+
+    document.UpdateAllViews();
+}
+
+AddObjectsCommand::AddObjectsCommand(DrawingDocument &document, CanvasObject object)
+    : AddObjectsCommand(document, "Add Shape", std::vector<CanvasObject>{std::move(object)})
+{
+}
+
+AddObjectsCommand::AddObjectsCommand(DrawingDocument &document, const wxString &name, std::vector<CanvasObject> objects)
+    : DocumentCommand(document, name), objects(std::move(objects)), count(this->objects.size()),
+      lastId(count > 0 ? this->objects.back().id : 0)
+{
+}
+
+bool AddObjectsCommand::Do()
+{
+    if (objects.size() != count)
+    {
+        return false;
+    }
+
+    auto &target = document.objects;
+    target.insert(target.end(), std::make_move_iterator(objects.begin()), std::make_move_iterator(objects.end()));
+    objects.clear();
+
+    NotifyChanged(true);
+    return true;
+}
+
+bool AddObjectsCommand::Undo()
+{
+    auto &source = document.objects;
+
+    if (source.size() < count || (count > 0 && source.back().id != lastId))
+    {
+        return false;
+    }
+
+    const auto first = source.end() - count;
+    objects.assign(std::make_move_iterator(first), std::make_move_iterator(source.end()));
+    source.erase(first, source.end());
+
+    NotifyChanged(false);
+    return true;
+}
+
+std::size_t AddObjectsCommand::GetMemoryUsage() const
+{
+    std::size_t bytes = sizeof(*this);
+
+    for (const auto &object : objects)
+    {
+        bytes += EstimateMemoryUsage(object);
+    }
+
+    return bytes;
+}
+
+TransformObjectsCommand::TransformObjectsCommand(DrawingDocument &document, std::vector<Change> changes)
+    : DocumentCommand(document, "Transform"), changes(std::move(changes))
+{
+}
+
+bool TransformObjectsCommand::Do()
+{
+    return Apply(true);
+}
+
+bool TransformObjectsCommand::Undo()
+{
+    return Apply(false);
+}
+
+bool TransformObjectsCommand::Apply(bool forward)
+{
+    auto &objects = document.objects;
+
+    if (std::any_of(changes.begin(), changes.end(), [&](const Change &change)
+                    { return change.index >= objects.size(); }))
+    {
+        return false;
+    }
+
+    for (const auto &change : changes)
+    {
+        objects[change.index].transformation = forward ? change.after : change.before;
+    }
+
+    NotifyChanged(false);
+    return true;
+}
+
+std::size_t TransformObjectsCommand::GetMemoryUsage() const
+{
+    return sizeof(*this) + changes.capacity() * sizeof(Change);
+}
+
+ClearCommand::ClearCommand(DrawingDocument &document)
+    : DocumentCommand(document, "Clear")
+{
+}
+
+bool ClearCommand::Do()
+{
+    removed = std::move(document.objects);
+    document.objects.clear();
+
+    removedBytes = 0;
+
+    for (const auto &object : removed)
+    {
+        removedBytes += EstimateMemoryUsage(object);
+    }
+
+    NotifyChanged(false);
+    return true;
+}
+
+bool ClearCommand::Undo()
+{
+    if (!document.objects.empty())
+    {
+        return false;
+    }
+
+    document.objects = std::move(removed);
+    removed.clear();
+    removedBytes = 0;
+
+    NotifyChanged(false);
+    return true;
+}
+
+std::size_t ClearCommand::GetMemoryUsage() const
+{
+    return sizeof(*this) + removedBytes;
+}
+
+ReplaceObjectsCommand::ReplaceObjectsCommand(DrawingDocument &document, const wxString &name, std::vector<Replacement> replacements)
+    : DocumentCommand(document, name), replacements(std::move(replacements))
+{
+    CountReplacementBytes();
+}
+
+void ReplaceObjectsCommand::AddBaked(const DrawingDocument &document, std::size_t index, std::vector<Replacement> &replacements, bool exactOnly)
+{
+    if (index < document.objects.size() && Baking::NeedsBaking(document.objects[index]) &&
+        (!exactOnly || Baking::BakesExactly(document.objects[index])))
+    {
+        replacements.emplace_back(index, Baking::Bake(document.objects[index]));
+    }
+}
+
+std::unique_ptr<ReplaceObjectsCommand> ReplaceObjectsCommand::Bake(DrawingDocument &document, const wxString &name, const std::vector<std::size_t> &indices)
+{
+    std::vector<Replacement> baked;
+
+    for (const auto index : indices)
+    {
+        AddBaked(document, index, baked);
+    }
+
+    return baked.empty() ? nullptr : std::make_unique<ReplaceObjectsCommand>(document, name, std::move(baked));
+}
+
+std::unique_ptr<ReplaceObjectsCommand> ReplaceObjectsCommand::BakeAll(DrawingDocument &document, const wxString &name, bool exactOnly)
+{
+    std::vector<Replacement> baked;
+
+    for (std::size_t i = 0; i < document.objects.size(); i++)
+    {
+        AddBaked(document, i, baked, exactOnly);
+    }
+
+    return baked.empty() ? nullptr : std::make_unique<ReplaceObjectsCommand>(document, name, std::move(baked));
+}
+
+bool ReplaceObjectsCommand::Do()
+{
+    Swap();
+    return true;
+}
+
+bool ReplaceObjectsCommand::Undo()
+{
+    Swap();
+    return true;
+}
+
+void ReplaceObjectsCommand::Swap()
+{
+    for (auto &[index, object] : replacements)
+    {
+        if (index < document.objects.size())
+        {
+            std::swap(document.objects[index], object);
+        }
+    }
+
+    CountReplacementBytes();
+    NotifyChanged(false);
+}
+
+void ReplaceObjectsCommand::CountReplacementBytes()
+{
+    replacementBytes = 0;
+
+    for (const auto &replacement : replacements)
+    {
+        replacementBytes += sizeof(Replacement) + EstimateMemoryUsage(replacement.second);
+    }
+}
+
+std::size_t ReplaceObjectsCommand::GetMemoryUsage() const
+{
+    return sizeof(*this) + replacementBytes;
+}
+
+RestructureCommand::RestructureCommand(DrawingDocument &document, const wxString &name, std::vector<std::size_t> removed, std::vector<Placement> inserted)
+    : DocumentCommand(document, name), removed(std::move(removed)), inserted(std::move(inserted))
+{
+    CountInsertedBytes();
+}
+
+std::unique_ptr<RestructureCommand> RestructureCommand::GroupObjects(DrawingDocument &document, const std::vector<std::size_t> &indices)
+{
+    if (indices.size() < 2)
+    {
+        return nullptr;
+    }
+
+    std::vector<CanvasObject> members;
+    members.reserve(indices.size());
+
+    for (const auto index : indices)
+    {
+        members.push_back(document.objects[index]);
+    }
+
+    std::vector<Placement> group;
+    group.emplace_back(indices.back() + 1 - indices.size(), Grouping::MakeGroup(std::move(members)));
+
+    return std::make_unique<RestructureCommand>(document, "Group", indices, std::move(group));
+}
+
+std::unique_ptr<RestructureCommand> RestructureCommand::UngroupObjects(DrawingDocument &document, const std::vector<std::size_t> &indices)
+{
+    std::vector<std::size_t> groups;
+    std::vector<Placement> children;
+
+    // each earlier group shifts the later ones by its extra children
+    std::size_t shift = 0;
+
+    for (const auto index : indices)
+    {
+        if (!Grouping::IsGroup(document.objects[index]))
+        {
+            continue;
+        }
+
+        auto ungrouped = Grouping::Ungroup(document.objects[index]);
+
+        for (std::size_t i = 0; i < ungrouped.size(); i++)
+        {
+            children.emplace_back(index + shift + i, std::move(ungrouped[i]));
+        }
+
+        groups.push_back(index);
+        shift += ungrouped.size() - 1;
+    }
+
+    return groups.empty() ? nullptr : std::make_unique<RestructureCommand>(document, "Ungroup", std::move(groups), std::move(children));
+}
+
+std::vector<std::size_t> RestructureCommand::GetInsertedIndices() const
+{
+    std::vector<std::size_t> indices;
+    indices.reserve(inserted.size());
+
+    for (const auto &placement : inserted)
+    {
+        indices.push_back(placement.first);
+    }
+
+    return indices;
+}
+
+bool RestructureCommand::Do()
+{
+    return Splice();
+}
+
+bool RestructureCommand::Undo()
+{
+    return Splice();
+}
+
+// Both passes work on the document's own vector: removals close their gaps moving forwards, insertions
+// open theirs moving backwards, so nothing before the first change is touched and nothing is copied
+bool RestructureCommand::Splice()
+{
+    auto &objects = document.objects;
+
+    if (!removed.empty() && removed.back() >= objects.size())
+    {
+        return false;
+    }
+
+    const std::size_t size = objects.size() - removed.size() + inserted.size();
+
+    if (!inserted.empty() && inserted.back().first >= size)
+    {
+        return false;
+    }
+
+    // the insertions below can't fail halfway once the capacity is there
+    objects.reserve(std::max(size, objects.size()));
+
+    std::vector<Placement> taken;
+    taken.reserve(removed.size());
+
+    if (!removed.empty())
+    {
+        auto target = objects.begin() + removed.front();
+
+        for (auto next = removed.begin(); next != removed.end(); ++next)
+        {
+            const auto source = objects.begin() + *next;
+            const auto runEnd = next + 1 != removed.end() ? objects.begin() + *(next + 1) : objects.end();
+
+            taken.emplace_back(*next, std::move(*source));
+            target = std::move(source + 1, runEnd, target);
+        }
+
+        objects.erase(target, objects.end());
+    }
+
+    if (!inserted.empty())
+    {
+        const std::size_t kept = objects.size();
+        objects.insert(objects.end(), inserted.size(), inserted.front().second);
+
+        auto sourceEnd = objects.begin() + kept;
+        auto targetEnd = objects.end();
+
+        for (auto next = inserted.rbegin(); next != inserted.rend(); ++next)
+        {
+            const auto slot = objects.begin() + next->first;
+            const auto run = targetEnd - (slot + 1);
+
+            std::move_backward(sourceEnd - run, sourceEnd, targetEnd);
+            sourceEnd -= run;
+            *slot = std::move(next->second);
+            targetEnd = slot;
+        }
+    }
+
+    removed = GetInsertedIndices();
+    inserted = std::move(taken);
+
+    CountInsertedBytes();
+    NotifyChanged(false);
+    return true;
+}
+
+void RestructureCommand::CountInsertedBytes()
+{
+    insertedBytes = 0;
+
+    for (const auto &placement : inserted)
+    {
+        insertedBytes += sizeof(Placement) + EstimateMemoryUsage(placement.second);
+    }
+}
+
+std::size_t RestructureCommand::GetMemoryUsage() const
+{
+    return sizeof(*this) + insertedBytes;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <wx/cmdproc.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "../canvas/canvasobject.h"
+#include "../transforms/transformation.h"
+
+class DrawingDocument;
+
+// Undoable edits of a DrawingDocument. Each command keeps only what its change needs: objects move
+// between the document and the command instead of being copied, so Do and Undo cost O(change).
+// Commands rely on the history being linear: when one runs, the document is exactly as it left it.
+class DocumentCommand : public wxCommand
+{
+public:
+    DocumentCommand(DrawingDocument &document, const wxString &name) : wxCommand(true, name), document(document) {}
+
+    // Bytes kept alive by this command in its current (done or undone) state
+    virtual std::size_t GetMemoryUsage() const = 0;
+
+    static std::size_t EstimateMemoryUsage(const CanvasObject &object);
+
+protected:
+    void NotifyChanged(bool appendedOnly);
+
+    DrawingDocument &document;
+};
+
+// New objects at the end of the list: a drawn shape, or pasted and duplicated instances. The command
+// holds the objects only while it is undone.
+class AddObjectsCommand : public DocumentCommand
+{
+public:
+    AddObjectsCommand(DrawingDocument &document, CanvasObject object);
+    AddObjectsCommand(DrawingDocument &document, const wxString &name, std::vector<CanvasObject> objects);
+
+    bool Do() override;
+    bool Undo() override;
+
+    std::size_t GetMemoryUsage() const override;
+
+private:
+    std::vector<CanvasObject> objects;
+    std::size_t count;
+    std::uint64_t lastId;
+};
+
+// One finished drag of the selection, however many steps it took and however many objects it moved
+class TransformObjectsCommand : public DocumentCommand
+{
+public:
+    struct Change
+    {
+        std::size_t index;
+        Transformation before;
+        Transformation after;
+    };
+
+    TransformObjectsCommand(DrawingDocument &document, std::vector<Change> changes);
+
+    bool Do() override;
+    bool Undo() override;
+
+    std::size_t GetMemoryUsage() const override;
+
+private:
+    bool Apply(bool forward);
+
+    std::vector<Change> changes;
+};
+
+// Owns the removed objects while done; undoing moves the whole list back in one go
+class ClearCommand : public DocumentCommand
+{
+public:
+    explicit ClearCommand(DrawingDocument &document);
+
+    bool Do() override;
+    bool Undo() override;
+
+    std::size_t GetMemoryUsage() const override;
+
+private:
+    std::vector<CanvasObject> removed;
+    std::size_t removedBytes{0};
+};
+
+// Swaps objects in place, keeping whichever versions are not in the document. Used for baking.
+class ReplaceObjectsCommand : public DocumentCommand
+{
+public:
+    using Replacement = std::pair<std::size_t, CanvasObject>;
+
+    ReplaceObjectsCommand(DrawingDocument &document, const wxString &name, std::vector<Replacement> replacements);
+
+    // Bakes the listed objects (or all of them) that need it; null if none do. With `exactOnly`, objects
+    // whose look baking would change are left transformed.
+    static std::unique_ptr<ReplaceObjectsCommand> Bake(DrawingDocument &document, const wxString &name, const std::vector<std::size_t> &indices);
+    static std::unique_ptr<ReplaceObjectsCommand> BakeAll(DrawingDocument &document, const wxString &name, bool exactOnly = false);
+
+    bool Do() override;
+    bool Undo() override;
+
+    std::size_t GetMemoryUsage() const override;
+
+private:
+    static void AddBaked(const DrawingDocument &document, std::size_t index, std::vector<Replacement> &replacements, bool exactOnly = false);
+
+    void Swap();
+    void CountReplacementBytes();
+
+    std::vector<Replacement> replacements;
+    std::size_t replacementBytes{0};
+};
+
+// Takes objects out of the list and puts others in, e.g. the members of a new group and the group.
+// Undoing takes out what went in and puts back what came out, so both directions are the same splice.
+class RestructureCommand : public DocumentCommand
+{
+public:
+    // An object and its index in the list it belongs to
+    using Placement = std::pair<std::size_t, CanvasObject>;
+
+    // `removed` are indices into the list before the change and `inserted` into the list after it, both ascending
+    RestructureCommand(DrawingDocument &document, const wxString &name, std::vector<std::size_t> removed, std::vector<Placement> inserted);
+
+    // Replaces the objects with one group where the topmost of them was; null for fewer than two objects
+    static std::unique_ptr<RestructureCommand> GroupObjects(DrawingDocument &document, const std::vector<std::size_t> &indices);
+
+    // Replaces each listed group with its children; null if none of them is a group
+    static std::unique_ptr<RestructureCommand> UngroupObjects(DrawingDocument &document, const std::vector<std::size_t> &indices);
+
+    // Where the inserted objects are once the command is done
+    std::vector<std::size_t> GetInsertedIndices() const;
+
+    bool Do() override;
+    bool Undo() override;
+
+    std::size_t GetMemoryUsage() const override;
+
+private:
+    bool Splice();
+    void CountInsertedBytes();
+
+    std::vector<std::size_t> removed;
+    std::vector<Placement> inserted;
+    std::size_t insertedBytes{0};
+};
@@ -0,0 +1,76 @@
+#include "drawinghistory.h"
+#include "documentcommands.h"
+
+DrawingHistory::DrawingHistory(std::size_t memoryBudget)
+    : memoryBudget(memoryBudget)
+{
+}
+
+void DrawingHistory::SetMemoryBudget(std::size_t budget)
+{
+    memoryBudget = budget;
+    EnforceBudget();
+}
+
+std::size_t DrawingHistory::GetMemoryUsage() const
+{
+    std::size_t bytes = 0;
+
+    for (auto node = m_commands.GetFirst(); node; node = node->GetNext())
+    {
+        if (auto command = dynamic_cast<DocumentCommand *>(node->GetData()))
+        {
+            bytes += command->GetMemoryUsage();
+        }
+    }
+
+    return bytes;
+}
+
+void DrawingHistory::Store(wxCommand *command)
+{
+    wxCommandProcessor::Store(command);
+    EnforceBudget();
+}
+
+// Undone commands can hold more than done ones (a removed object, say), so both directions re-check
+bool DrawingHistory::Undo()
+{
+    const bool undone = wxCommandProcessor::Undo();
+    EnforceBudget();
+
+    return undone;
+}
+
+bool DrawingHistory::Redo()
+{
+    const bool redone = wxCommandProcessor::Redo();
+    EnforceBudget();
+
+    return redone;
+}
+
+void DrawingHistory::EnforceBudget()
+{
+    std::size_t usage = GetMemoryUsage();
+
+    // only steps before the current one go: evicting a redo step would break the chain after it
+    while (usage > memoryBudget && m_currentCommand && m_commands.GetFirst() != m_currentCommand)
+    {
+        auto oldest = m_commands.GetFirst();
+        auto command = static_cast<wxCommand *>(oldest->GetData());
+
+        if (auto documentCommand = dynamic_cast<DocumentCommand *>(command))
+        {
+            usage -= documentCommand->GetMemoryUsage();
+        }
+
+        if (m_lastSavedCommand == oldest)
+        {
+            m_lastSavedCommand = wxList::compatibility_iterator();
+        }
+
+        delete command;
+        m_commands.Erase(oldest);
+    }
+}
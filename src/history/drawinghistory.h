@@ -0,0 +1,25 @@
+#pragma once
+
+#include <wx/cmdproc.h>
+
+#include <cstddef>
+
+// wxCommandProcessor with a memory budget instead of a command count: once the commands hold more
+// than the budget, the oldest undo steps are dropped. The latest undo step is always kept.
+class DrawingHistory : public wxCommandProcessor
+{
+public:
+    explicit DrawingHistory(std::size_t memoryBudget);
+
+    void SetMemoryBudget(std::size_t budget);
+    std::size_t GetMemoryUsage() const;
+
+    void Store(wxCommand *command) override;
+    bool Undo() override;
+    bool Redo() override;
+
+private:
+    void EnforceBudget();
+
+    std::size_t memoryBudget;
+};
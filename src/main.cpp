@@ -4,12 +4,16 @@
 
 #include <wx/config.h>
 #include <wx/filehistory.h>
+#include <wx/numdlg.h>
+#include <wx/file.h>
+#include <wx/filename.h>
 
 #include <string>
 #include <vector>
 #include <tuple>
 
 #include "myapp.h"
+#include "utils/trace.h"
 
 #include "panes/colorpane.h"
 #include "panes/pensizepane.h"
@@ -48,6 +52,7 @@ private:
 
     wxPanel *docPanel;
     wxScrolled<wxPanel> *controlsPanel;
+    wxMenu *editMenu;
 
     // For hiding/showing pen width controls.
     // Can't use a single sizer because it will mess up the layout: https://github.com/wxWidgets/wxWidgets/issues/23352
@@ -67,6 +72,8 @@ private:
 
 bool MyApp::OnInit()
 {
+    Trace::Initialize();
+
     wxInitAllImageHandlers();
 
     SetAppName("PaintAppWx");
@@ -84,12 +91,19 @@ bool MyApp::OnInit()
     frame->Show(true);
 
     toolSettings.selectionHandleWidth = frame->FromDIP(10);
+    toolSettings.snapDistance = frame->FromDIP(6);
     return true;
 }
 
 int MyApp::OnExit()
 {
     docManager->FileHistorySave(*wxConfig::Get());
+
+    if (!Trace::Flush())
+    {
+        wxLogError("Could not write the trace to %s", wxGetenv(Trace::EnvironmentVariable));
+    }
+
     return wxApp::OnExit();
 }
 
@@ -98,6 +112,11 @@ ToolSettings &MyApp::GetToolSettings()
     return wxGetApp().toolSettings;
 }
 
+std::vector<CanvasObject> &MyApp::GetClipboard()
+{
+    return wxGetApp().clipboard;
+}
+
 void MyApp::SetupCanvasForView(DrawingView *view)
 {
     wxGetApp().frame->SetupCanvasForView(view);
@@ -116,6 +135,10 @@ void MyFrame::SetupCanvasForView(DrawingView *view)
         docPanel->GetSizer()->Add(canvas, 1, wxEXPAND);
 
         view->SetFrame(this);
+        view->SetCanvas(canvas);
+
+        // lets the history label Undo and Redo with the command names
+        view->GetDocument()->GetCommandProcessor()->SetEditMenu(editMenu);
     }
     else
     {
@@ -155,7 +178,7 @@ void MyFrame::SetupPenPanes(wxWindow *parent, wxSizer *sizer)
 
 void MyFrame::SetupToolPanes(wxWindow *parent, wxSizer *sizer)
 {
-    for (const auto toolType : {ToolType::Pen, ToolType::Rect, ToolType::Circle, ToolType::Transform})
+    for (const auto toolType : {ToolType::Pen, ToolType::Rect, ToolType::Circle, ToolType::Transform, ToolType::Eraser})
     {
         auto toolPane = new ToolSelectionPane(parent, wxID_ANY, toolType);
 
@@ -256,7 +279,7 @@ void MyFrame::SelectToolPane(ToolSelectionPane *pane)
 
     MyApp::GetToolSettings().currentTool = pane->toolType;
 
-    if (pane->toolType == ToolType::Pen)
+    if (pane->toolType == ToolType::Pen || pane->toolType == ToolType::Eraser)
     {
         controlsPanel->GetSizer()->Show(penWidthLabel);
         controlsPanel->GetSizer()->Show(penWidthPanesSizer);
@@ -273,6 +296,10 @@ void MyFrame::SelectToolPane(ToolSelectionPane *pane)
 void MyFrame::BuildMenuBar()
 {
     constexpr int ClearHistoryMenuId = 10001;
+    constexpr int DuplicateInArrayMenuId = 10002;
+    constexpr int GroupMenuId = 10003;
+    constexpr int UngroupMenuId = 10004;
+    constexpr int ImportImageMenuId = 10005;
 
     auto menuBar = new wxMenuBar;
 
@@ -288,6 +315,9 @@ void MyFrame::BuildMenuBar()
 
     fileMenu->Append(wxID_SAVE);
     fileMenu->Append(wxID_SAVEAS);
+    fileMenu->AppendSeparator();
+    fileMenu->Append(ImportImageMenuId, "&Import Image...");
+    fileMenu->AppendSeparator();
     fileMenu->Append(wxID_CLOSE);
     fileMenu->Append(wxID_EXIT);
 
@@ -305,18 +335,74 @@ void MyFrame::BuildMenuBar()
             } },
         ClearHistoryMenuId);
 
-    auto editMenu = new wxMenu;
+    editMenu = new wxMenu;
     editMenu->Append(wxID_UNDO);
     editMenu->Append(wxID_REDO);
     editMenu->AppendSeparator();
     editMenu->Append(wxID_CUT);
     editMenu->Append(wxID_COPY);
     editMenu->Append(wxID_PASTE);
+    editMenu->Append(wxID_DUPLICATE, "&Duplicate\tCtrl+D");
+    editMenu->Append(DuplicateInArrayMenuId, "Duplicate in &Array...");
     editMenu->Append(wxID_DELETE);
     editMenu->AppendSeparator();
     editMenu->Append(wxID_SELECTALL);
+    editMenu->AppendSeparator();
+    editMenu->Append(GroupMenuId, "&Group\tCtrl+G");
+    editMenu->Append(UngroupMenuId, "U&ngroup\tCtrl+Shift+G");
 
     menuBar->Append(editMenu, "&Edit");
 
+    auto bindToView = [this](int id, auto action)
+    {
+        this->Bind(
+            wxEVT_MENU, [this, action](wxCommandEvent &)
+            {
+                if (auto view = wxDynamicCast(GetDocumentManager()->GetCurrentView(), DrawingView))
+                {
+                    action(*view);
+                } },
+            id);
+    };
+
+    bindToView(wxID_SELECTALL, [](DrawingView &view)
+               { view.OnSelectAll(); });
+    bindToView(wxID_COPY, [](DrawingView &view)
+               { view.OnCopy(); });
+    bindToView(wxID_PASTE, [](DrawingView &view)
+               { view.OnPaste(); });
+    bindToView(wxID_DUPLICATE, [](DrawingView &view)
+               { view.OnDuplicate(); });
+    bindToView(GroupMenuId, [](DrawingView &view)
+               { view.OnGroup(); });
+    bindToView(UngroupMenuId, [](DrawingView &view)
+               { view.OnUngroup(); });
+    bindToView(DuplicateInArrayMenuId, [this](DrawingView &view)
+               {
+                   const long count = wxGetNumberFromUser("Copies to place in a row beside the selection:", "Copies:",
+                                                          "Duplicate in Array", 10, 1, 10000, this);
+                   if (count > 0)
+                   {
+                       view.OnDuplicateInArray(count);
+                   } });
+    bindToView(ImportImageMenuId, [this](DrawingView &view)
+               {
+                   wxFileDialog importFileDialog(this, _("Import image"), "", "",
+                                                 "Image files (*.png;*.jpg;*.jpeg;*.bmp;*.gif)|*.png;*.jpg;*.jpeg;*.bmp;*.gif",
+                                                 wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+
+                   if (importFileDialog.ShowModal() == wxID_CANCEL)
+                       return;
+
+                   // the file's bytes are kept as they are and saved into the document
+                   wxFile file(importFileDialog.GetPath());
+                   std::vector<unsigned char> encoded(file.IsOpened() ? static_cast<std::size_t>(file.Length()) : 0);
+
+                   if (encoded.empty() || file.Read(encoded.data(), encoded.size()) != static_cast<ssize_t>(encoded.size()) ||
+                       !view.OnImportImage(std::move(encoded), wxFileName(importFileDialog.GetPath()).GetExt().Lower().ToStdString()))
+                   {
+                       wxMessageBox(_("Could not import the image."), _("Import image"), wxOK | wxICON_ERROR, this);
+                   } });
+
     SetMenuBar(menuBar);
 }
\ No newline at end of file
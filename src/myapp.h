@@ -16,9 +16,13 @@ public:
     static void SetupCanvasForView(DrawingView *view);
     static ToolSettings &GetToolSettings();
 
+    // Copied objects, shared by all documents
+    static std::vector<CanvasObject> &GetClipboard();
+
 private:
     std::unique_ptr<wxDocManager> docManager;
     MyFrame *frame;
 
     ToolSettings toolSettings;
+    std::vector<CanvasObject> clipboard;
 };
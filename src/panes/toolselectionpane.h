@@ -80,6 +80,12 @@ void ToolSelectionPane::DrawContent(wxGraphicsContext *gc, const wxRect &rect, i
         gc->StrokeLines(points.size(), points.data());
         break;
     }
+    case ToolType::Eraser:
+        gc->Rotate(-M_PI / 4.0);
+        gc->SetBrush(*wxTRANSPARENT_BRUSH);
+        gc->DrawRoundedRectangle(-itemWidth / 2, -itemWidth / 4, itemWidth, itemWidth / 2, itemWidth / 8);
+        gc->StrokeLine(-itemWidth / 8, -itemWidth / 4, -itemWidth / 8, itemWidth / 4);
+        break;
     }
 
     gc->PopState();
@@ -0,0 +1,146 @@
+#include <algorithm>
+
+#include "backgroundrenderer.h"
+#include "rasterizer.h"
+#include "shaperasterizer.h"
+
+BackgroundRenderer::BackgroundRenderer(std::function<void()> frameReady)
+    : frameReady(std::move(frameReady)), worker([this]
+                                                { WorkerLoop(); })
+{
+}
+
+BackgroundRenderer::~BackgroundRenderer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        superseded = true;
+    }
+
+    wakeUp.notify_one();
+    worker.join();
+}
+
+void BackgroundRenderer::Submit(const SceneKey &key, const std::vector<CanvasObject> &objects)
+{
+    // the shapes are immutable and shared as they are: the worker only reads them
+    std::vector<CanvasObject> snapshot;
+    snapshot.reserve(objects.size() - std::min(objects.size(), key.excludedIndices.size()));
+
+    auto nextExcluded = key.excludedIndices.begin();
+
+    for (std::size_t i = 0; i < objects.size(); i++)
+    {
+        if (nextExcluded != key.excludedIndices.end() && *nextExcluded == i)
+        {
+            ++nextExcluded;
+            continue;
+        }
+
+        snapshot.push_back(objects[i]);
+    }
+
+    std::optional<Request> replaced;
+    std::vector<std::vector<CanvasObject>> released;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        replaced = std::move(pending);
+        released.swap(retired);
+        pending = Request{key, std::move(snapshot)};
+        superseded = true;
+    }
+
+    submittedKey = key;
+    wakeUp.notify_one();
+}
+
+bool BackgroundRenderer::AcquireLatestFrame()
+{
+    std::vector<std::vector<CanvasObject>> released;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    released.swap(retired);
+
+    if (!latest)
+    {
+        return false;
+    }
+
+    front = std::move(latest);
+    latest.reset();
+
+    return true;
+}
+
+void BackgroundRenderer::WorkerLoop()
+{
+    Frame back;
+
+    while (true)
+    {
+        Request request;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this]
+                        { return stopping || pending.has_value(); });
+
+            if (stopping)
+            {
+                return;
+            }
+
+            request = std::move(pending.value());
+            pending.reset();
+            superseded = false;
+        }
+
+        const bool finished = Render(request, back);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            retired.push_back(std::move(request.objects));
+
+            if (finished)
+            {
+                latest = std::move(back);
+                back = Frame{};
+            }
+        }
+
+        if (finished)
+        {
+            frameReady();
+        }
+    }
+}
+
+bool BackgroundRenderer::Render(const Request &request, Frame &target)
+{
+    const auto &key = request.key;
+
+    RgbaImage image(key.width, key.height, {255, 255, 255, 255});
+    ScanlineRasterizer rasterizer(key.width, key.height);
+
+    wxAffineMatrix2D view;
+    view.Scale(key.scale, key.scale);
+    view.Concat(key.viewport.GetMatrix());
+
+    for (const auto &object : request.objects)
+    {
+        if (superseded)
+        {
+            return false;
+        }
+
+        ShapeRasterizer::Draw(rasterizer, image, object, view);
+    }
+
+    target.key = key;
+    target.rgb.resize(static_cast<std::size_t>(key.width) * key.height * 3);
+    image.CopyRgb(target.rgb.data());
+
+    return !superseded;
+}
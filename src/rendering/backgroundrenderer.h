@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "../canvas/canvasobject.h"
+#include "../canvas/viewport.h"
+
+// Renders snapshots of the committed objects into an offscreen image on a worker thread.
+// The UI thread submits a snapshot and later picks up the newest finished frame to blit;
+// it never waits for rasterization, however big the scene is.
+//
+// A snapshot shares the objects' shapes. The worker only reads their colours, and hands each snapshot
+// back to be released on the UI thread, so the shapes' wxColours (whose reference counts aren't
+// thread safe) are never copied or destroyed off it.
+class BackgroundRenderer
+{
+public:
+    // Identifies what a frame shows, so the canvas can tell which objects it still has to draw itself
+    struct SceneKey
+    {
+        std::uint64_t sceneVersion{0};
+        std::uint64_t rewriteVersion{0};
+        std::size_t objectCount{0};
+        std::vector<std::size_t> excludedIndices; // sorted; left out of the snapshot (drawn live by the canvas)
+        int width{0};
+        int height{0};
+        double scale{1.0};
+        Viewport viewport;
+
+        bool operator==(const SceneKey &other) const
+        {
+            return sceneVersion == other.sceneVersion && rewriteVersion == other.rewriteVersion &&
+                   objectCount == other.objectCount && excludedIndices == other.excludedIndices &&
+                   width == other.width && height == other.height && scale == other.scale &&
+                   viewport == other.viewport;
+        }
+
+        bool operator!=(const SceneKey &other) const { return !(*this == other); }
+    };
+
+    struct Frame
+    {
+        SceneKey key;
+        std::vector<unsigned char> rgb; // opaque, tightly packed rows of key.width pixels
+    };
+
+    // `frameReady` is called on the worker thread after each finished frame
+    explicit BackgroundRenderer(std::function<void()> frameReady);
+    ~BackgroundRenderer();
+
+    BackgroundRenderer(const BackgroundRenderer &) = delete;
+    BackgroundRenderer &operator=(const BackgroundRenderer &) = delete;
+
+    // Snapshots `objects` (minus key.excludedIndices), replacing any pending request and abandoning
+    // a render that is still in progress
+    void Submit(const SceneKey &key, const std::vector<CanvasObject> &objects);
+
+    // Key of the most recent submission, if any
+    const std::optional<SceneKey> &GetSubmittedKey() const { return submittedKey; }
+
+    // Swaps the newest finished frame to the front. Returns true if the front frame changed.
+    bool AcquireLatestFrame();
+    const std::optional<Frame> &GetFrontFrame() const { return front; }
+
+private:
+    struct Request
+    {
+        SceneKey key;
+        std::vector<CanvasObject> objects;
+    };
+
+    void WorkerLoop();
+    bool Render(const Request &request, Frame &target);
+
+    std::function<void()> frameReady;
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::optional<Request> pending;
+    std::optional<Frame> latest;
+    std::vector<std::vector<CanvasObject>> retired; // snapshots the worker is done with
+    bool stopping{false};
+    std::atomic<bool> superseded{false};
+
+    // UI thread only
+    std::optional<Frame> front;
+    std::optional<SceneKey> submittedKey;
+
+    std::thread worker;
+};
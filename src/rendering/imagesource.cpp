@@ -0,0 +1,200 @@
+#include <wx/mstream.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include "imagesource.h"
+
+namespace
+{
+    std::size_t LevelCountFor(int width, int height)
+    {
+        std::size_t count = 1;
+
+        for (int size = std::max(width, height); size > 1; size /= 2)
+        {
+            count++;
+        }
+
+        return count;
+    }
+
+    bool Decode(const std::vector<unsigned char> &encoded, wxImage &image)
+    {
+        wxMemoryInputStream in(encoded.data(), encoded.size());
+        return image.LoadFile(in, wxBITMAP_TYPE_ANY) && image.IsOk();
+    }
+
+    RgbaImage ToPremultiplied(const wxImage &image)
+    {
+        RgbaImage result(image.GetWidth(), image.GetHeight());
+
+        const unsigned char *rgb = image.GetData();
+        const unsigned char *alpha = image.HasAlpha() ? image.GetAlpha() : nullptr;
+        const std::size_t count = static_cast<std::size_t>(result.width) * result.height;
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            const unsigned a = alpha ? alpha[i] : 255;
+
+            result.pixels[4 * i] = static_cast<std::uint8_t>((rgb[3 * i] * a + 127) / 255);
+            result.pixels[4 * i + 1] = static_cast<std::uint8_t>((rgb[3 * i + 1] * a + 127) / 255);
+            result.pixels[4 * i + 2] = static_cast<std::uint8_t>((rgb[3 * i + 2] * a + 127) / 255);
+            result.pixels[4 * i + 3] = static_cast<std::uint8_t>(a);
+        }
+
+        return result;
+    }
+
+    // 2x2 box filter; an odd last row or column is averaged with itself
+    RgbaImage HalfSize(const RgbaImage &source)
+    {
+        RgbaImage result(std::max(1, source.width / 2), std::max(1, source.height / 2));
+
+        for (int y = 0; y < result.height; y++)
+        {
+            const auto *row0 = source.Row(std::min(2 * y, source.height - 1));
+            const auto *row1 = source.Row(std::min(2 * y + 1, source.height - 1));
+            auto *out = result.Row(y);
+
+            for (int x = 0; x < result.width; x++)
+            {
+                const int x0 = 4 * std::min(2 * x, source.width - 1);
+                const int x1 = 4 * std::min(2 * x + 1, source.width - 1);
+
+                for (int c = 0; c < 4; c++)
+                {
+                    out[4 * x + c] = static_cast<std::uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+
+        return result;
+    }
+}
+
+ImageSource::ImageSource(std::vector<unsigned char> encoded, std::string extension, int width, int height)
+    : encoded(std::move(encoded)), extension(std::move(extension)), width(std::max(1, width)), height(std::max(1, height))
+{
+}
+
+std::shared_ptr<const ImageSource> ImageSource::Import(std::vector<unsigned char> encoded, std::string extension)
+{
+    wxImage image;
+
+    if (!Decode(encoded, image))
+    {
+        return nullptr;
+    }
+
+    auto source = std::make_shared<ImageSource>(std::move(encoded), std::move(extension), image.GetWidth(), image.GetHeight());
+    std::call_once(source->decodeOnce, [&]
+                   { source->BuildLevels(image); });
+
+    return source;
+}
+
+std::string ImageSource::GetMimeType() const
+{
+    auto lower = extension;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+
+    if (lower == "jpg" || lower == "jpeg")
+    {
+        return "image/jpeg";
+    }
+
+    return "image/" + lower;
+}
+
+std::size_t ImageSource::GetLevelCount() const
+{
+    return LevelCountFor(width, height);
+}
+
+std::size_t ImageSource::ChooseLevel(double scale) const
+{
+    if (!(scale > 0.0))
+    {
+        return GetLevelCount() - 1;
+    }
+
+    const double level = std::floor(-std::log2(scale));
+    return static_cast<std::size_t>(std::clamp(level, 0.0, static_cast<double>(GetLevelCount() - 1)));
+}
+
+const RgbaImage &ImageSource::GetLevel(std::size_t level) const
+{
+    std::call_once(decodeOnce, [this]
+                   {
+                       wxImage image;
+
+                       if (Decode(encoded, image))
+                       {
+                           BuildLevels(image);
+                       }
+                       else
+                       {
+                           // unreadable bytes draw as nothing rather than failing every paint
+                           levels.assign(GetLevelCount(), RgbaImage(1, 1, {0, 0, 0, 0}));
+                       } });
+
+    return levels[std::min(level, levels.size() - 1)];
+}
+
+void ImageSource::BuildLevels(const wxImage &image) const
+{
+    levels.clear();
+    levels.reserve(LevelCountFor(image.GetWidth(), image.GetHeight()));
+    levels.push_back(ToPremultiplied(image));
+
+    while (levels.back().width > 1 || levels.back().height > 1)
+    {
+        levels.push_back(HalfSize(levels.back()));
+    }
+}
+
+wxImage ImageSource::ToImage(std::size_t level) const
+{
+    const auto &pixels = GetLevel(level);
+
+    wxImage image(pixels.width, pixels.height, false);
+    image.InitAlpha();
+
+    unsigned char *rgb = image.GetData();
+    unsigned char *alpha = image.GetAlpha();
+    const std::size_t count = static_cast<std::size_t>(pixels.width) * pixels.height;
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const unsigned a = pixels.pixels[4 * i + 3];
+
+        for (int c = 0; c < 3; c++)
+        {
+            rgb[3 * i + c] = a > 0 ? static_cast<unsigned char>(std::min(255u, (pixels.pixels[4 * i + c] * 255u + a / 2) / a)) : 0;
+        }
+
+        alpha[i] = static_cast<unsigned char>(a);
+    }
+
+    return image;
+}
+
+const wxBitmap &ImageSource::GetBitmap(std::size_t level) const
+{
+    level = std::min(level, GetLevelCount() - 1);
+
+    if (bitmaps.empty())
+    {
+        bitmaps.resize(GetLevelCount());
+    }
+
+    if (!bitmaps[level].IsOk())
+    {
+        bitmaps[level] = wxBitmap(ToImage(level));
+    }
+
+    return bitmaps[level];
+}
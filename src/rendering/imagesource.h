@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <wx/wx.h>
+
+#include "rasterizer.h"
+
+// An imported bitmap: its encoded bytes as imported (PNG, JPEG...) and a mip chain decoded from them.
+// Level 0 is the full image and each level after it halves both sides, down to a single pixel.
+// The chain is built on first use, once, from any thread, so opening a document decodes nothing until
+// an image is actually drawn.
+class ImageSource
+{
+public:
+    // Defers decoding; `width` and `height` are the image's size as recorded when it was saved
+    ImageSource(std::vector<unsigned char> encoded, std::string extension, int width, int height);
+
+    // Decodes right away and builds the mip chain. Null if wx can't read the bytes as an image.
+    static std::shared_ptr<const ImageSource> Import(std::vector<unsigned char> encoded, std::string extension);
+
+    const std::vector<unsigned char> &GetEncoded() const { return encoded; }
+    const std::string &GetExtension() const { return extension; }
+    std::string GetMimeType() const;
+
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+
+    std::size_t GetLevelCount() const;
+
+    // The smallest level that still has a pixel for every device pixel when level 0 is drawn at
+    // `scale` device pixels per image pixel
+    std::size_t ChooseLevel(double scale) const;
+
+    // Premultiplied pixels of a level, decoding the image if this is the first use
+    const RgbaImage &GetLevel(std::size_t level) const;
+
+    // A level as a wxImage with straight alpha, made on each call
+    wxImage ToImage(std::size_t level) const;
+
+    // A level as a bitmap, made once. Main thread only: bitmaps can't be shared with workers.
+    const wxBitmap &GetBitmap(std::size_t level) const;
+
+private:
+    void BuildLevels(const wxImage &image) const;
+
+    std::vector<unsigned char> encoded;
+    std::string extension;
+    int width;
+    int height;
+
+    mutable std::once_flag decodeOnce;
+    mutable std::vector<RgbaImage> levels;
+    mutable std::vector<wxBitmap> bitmaps;
+};
@@ -0,0 +1,180 @@
+#include <wx/stream.h>
+#include <wx/zstream.h>
+
+#include <array>
+#include <cstring>
+
+#include "pngstreamwriter.h"
+
+namespace
+{
+    constexpr std::size_t IdatChunkSize = 1 << 16;
+
+    const std::array<std::uint32_t, 256> &CrcTable()
+    {
+        static const auto table = []
+        {
+            std::array<std::uint32_t, 256> t{};
+            for (std::uint32_t n = 0; n < 256; n++)
+            {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[n] = c;
+            }
+            return t;
+        }();
+
+        return table;
+    }
+
+    std::uint32_t UpdateCrc(std::uint32_t crc, const unsigned char *data, std::size_t size)
+    {
+        const auto &table = CrcTable();
+        for (std::size_t i = 0; i < size; i++)
+        {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    void PutBigEndian(unsigned char *dst, std::uint32_t value)
+    {
+        dst[0] = static_cast<unsigned char>(value >> 24);
+        dst[1] = static_cast<unsigned char>(value >> 16);
+        dst[2] = static_cast<unsigned char>(value >> 8);
+        dst[3] = static_cast<unsigned char>(value);
+    }
+}
+
+// Collects compressed bytes and emits them as IDAT chunks of a bounded size
+class PngStreamWriter::IdatStream : public wxOutputStream
+{
+public:
+    explicit IdatStream(PngStreamWriter &writer) : writer(writer)
+    {
+        buffer.reserve(IdatChunkSize);
+    }
+
+    void FlushChunk()
+    {
+        if (!buffer.empty())
+        {
+            writer.WriteChunk("IDAT", buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+
+protected:
+    size_t OnSysWrite(const void *data, size_t size) override
+    {
+        auto bytes = static_cast<const unsigned char *>(data);
+        size_t remaining = size;
+
+        while (remaining > 0)
+        {
+            const auto n = std::min(remaining, IdatChunkSize - buffer.size());
+            buffer.insert(buffer.end(), bytes, bytes + n);
+            bytes += n;
+            remaining -= n;
+
+            if (buffer.size() == IdatChunkSize)
+            {
+                FlushChunk();
+            }
+        }
+
+        return size;
+    }
+
+private:
+    PngStreamWriter &writer;
+    std::vector<unsigned char> buffer;
+};
+
+PngStreamWriter::PngStreamWriter(wxOutputStream &out, int width, int height, PixelFormat format)
+    : out(out), width(width), height(height), bytesPerPixel(format == PixelFormat::RGBA ? 4 : 3)
+{
+    static const unsigned char signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.Write(signature, sizeof(signature));
+
+    unsigned char header[13];
+    PutBigEndian(header, static_cast<std::uint32_t>(width));
+    PutBigEndian(header + 4, static_cast<std::uint32_t>(height));
+    header[8] = 8;                                      // bit depth
+    header[9] = format == PixelFormat::RGBA ? 6 : 2;    // colour type
+    header[10] = 0;                                     // compression
+    header[11] = 0;                                     // filter method
+    header[12] = 0;                                     // no interlace
+    WriteChunk("IHDR", header, sizeof(header));
+
+    idat = std::make_unique<IdatStream>(*this);
+    zlib = std::make_unique<wxZlibOutputStream>(*idat, -1, wxZLIB_ZLIB);
+}
+
+PngStreamWriter::~PngStreamWriter()
+{
+    // the compressor must go before the chunk stream it writes to
+    zlib.reset();
+}
+
+bool PngStreamWriter::WriteRows(const unsigned char *pixels, int rowCount)
+{
+    if (finished || rowsWritten + rowCount > height)
+    {
+        return false;
+    }
+
+    const std::size_t rowBytes = static_cast<std::size_t>(width) * bytesPerPixel;
+    const unsigned char filterNone = 0;
+
+    for (int row = 0; row < rowCount; row++)
+    {
+        zlib->Write(&filterNone, 1);
+        zlib->Write(pixels + row * rowBytes, rowBytes);
+    }
+
+    rowsWritten += rowCount;
+
+    return zlib->IsOk() && out.IsOk();
+}
+
+bool PngStreamWriter::Finish()
+{
+    if (finished)
+    {
+        return true;
+    }
+
+    finished = true;
+
+    zlib->Close();
+    idat->FlushChunk();
+    WriteChunk("IEND", nullptr, 0);
+
+    return rowsWritten == height && out.IsOk();
+}
+
+void PngStreamWriter::WriteChunk(const char type[4], const unsigned char *data, std::size_t size)
+{
+    unsigned char length[4];
+    PutBigEndian(length, static_cast<std::uint32_t>(size));
+    out.Write(length, 4);
+
+    auto typeBytes = reinterpret_cast<const unsigned char *>(type);
+    out.Write(typeBytes, 4);
+
+    std::uint32_t crc = UpdateCrc(0xFFFFFFFFu, typeBytes, 4);
+
+    if (size > 0)
+    {
+        out.Write(data, size);
+        crc = UpdateCrc(crc, data, size);
+    }
+
+    unsigned char crcBytes[4];
+    PutBigEndian(crcBytes, crc ^ 0xFFFFFFFFu);
+    out.Write(crcBytes, 4);
+}
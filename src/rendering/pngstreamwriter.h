@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class wxOutputStream;
+class wxZlibOutputStream;
+
+// Writes a PNG incrementally, a band of rows at a time, so the full image never has to exist in memory.
+// Rows are stored unfiltered; the compressed stream is split into IDAT chunks as it is produced.
+class PngStreamWriter
+{
+public:
+    enum class PixelFormat
+    {
+        RGB,
+        RGBA
+    };
+
+    PngStreamWriter(wxOutputStream &out, int width, int height, PixelFormat format);
+    ~PngStreamWriter();
+
+    // `pixels` holds `rowCount` tightly packed rows in the writer's pixel format
+    bool WriteRows(const unsigned char *pixels, int rowCount);
+    bool Finish();
+
+    int GetRowsWritten() const { return rowsWritten; }
+
+private:
+    class IdatStream;
+
+    void WriteChunk(const char type[4], const unsigned char *data, std::size_t size);
+
+    wxOutputStream &out;
+    int width;
+    int height;
+    int bytesPerPixel;
+    int rowsWritten{0};
+    bool finished{false};
+
+    std::unique_ptr<IdatStream> idat;
+    std::unique_ptr<wxZlibOutputStream> zlib;
+};
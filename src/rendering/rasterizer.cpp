@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "rasterizer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTERIZER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+RgbaImage::RgbaImage(int width, int height, Rgba fill)
+    : width(width), height(height), pixels(static_cast<std::size_t>(width) * height * 4)
+{
+    Fill(fill);
+}
+
+void RgbaImage::Fill(Rgba colour)
+{
+    const std::uint8_t premultiplied[4] = {
+        static_cast<std::uint8_t>((colour.r * colour.a + 127) / 255),
+        static_cast<std::uint8_t>((colour.g * colour.a + 127) / 255),
+        static_cast<std::uint8_t>((colour.b * colour.a + 127) / 255),
+        colour.a};
+
+    for (std::size_t i = 0; i < pixels.size(); i += 4)
+    {
+        std::memcpy(&pixels[i], premultiplied, 4);
+    }
+}
+
+void RgbaImage::CopyRgb(std::uint8_t *out) const
+{
+    for (std::size_t i = 0, pixelCount = pixels.size() / 4; i < pixelCount; i++)
+    {
+        out[i * 3] = pixels[i * 4];
+        out[i * 3 + 1] = pixels[i * 4 + 1];
+        out[i * 3 + 2] = pixels[i * 4 + 2];
+    }
+}
+
+ScanlineRasterizer::ScanlineRasterizer(int width, int height)
+    : width(std::max(0, width)), height(std::max(0, height)),
+      stride(static_cast<std::size_t>(this->width) + 2),
+      accumulation(stride * this->height, 0.0f),
+      dirtyMinX(this->width), dirtyMaxX(-1), dirtyMinY(this->height), dirtyMaxY(-1),
+      coverageRow(this->width)
+{
+}
+
+void ScanlineRasterizer::AddPolygon(const double *xy, std::size_t pointCount, bool fixOrientation)
+{
+    if (pointCount < 3)
+    {
+        return;
+    }
+
+    double signedArea = 0.0;
+    if (fixOrientation)
+    {
+        for (std::size_t i = 0, j = pointCount - 1; i < pointCount; j = i++)
+        {
+            signedArea += xy[2 * j] * xy[2 * i + 1] - xy[2 * i] * xy[2 * j + 1];
+        }
+    }
+
+    const bool reverse = signedArea < 0.0;
+
+    for (std::size_t i = 0; i < pointCount; i++)
+    {
+        const std::size_t a = reverse ? pointCount - 1 - i : i;
+        const std::size_t b = reverse ? (a + pointCount - 1) % pointCount : (a + 1) % pointCount;
+
+        AddLine(xy[2 * a], xy[2 * a + 1], xy[2 * b], xy[2 * b + 1]);
+    }
+}
+
+void ScanlineRasterizer::AddLine(double x0, double y0, double x1, double y1)
+{
+    if (y0 == y1 || !std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1))
+    {
+        return;
+    }
+
+    if (std::max(y0, y1) <= 0.0 || std::min(y0, y1) >= height)
+    {
+        return;
+    }
+
+    // Split at the left and right edges; the parts outside are flattened onto the edge,
+    // which keeps their effect on the running sum without writing outside the row.
+    const double right = width;
+    double xs[4] = {x0, 0, 0, x1};
+    double ys[4] = {y0, 0, 0, y1};
+    int count = 1;
+
+    auto addSplit = [&](double edge)
+    {
+        const double t = (edge - x0) / (x1 - x0);
+        if (t > 0.0 && t < 1.0)
+        {
+            xs[count] = edge;
+            ys[count] = y0 + (y1 - y0) * t;
+            count++;
+        }
+    };
+
+    if (x0 != x1)
+    {
+        if (x0 < x1)
+        {
+            addSplit(0.0);
+            addSplit(right);
+        }
+        else
+        {
+            addSplit(right);
+            addSplit(0.0);
+        }
+    }
+
+    xs[count] = x1;
+    ys[count] = y1;
+
+    for (int i = 0; i < count; i++)
+    {
+        AccumulateLine(std::clamp(xs[i], 0.0, right), ys[i], std::clamp(xs[i + 1], 0.0, right), ys[i + 1]);
+    }
+}
+
+void ScanlineRasterizer::AccumulateLine(double px0, double py0, double px1, double py1)
+{
+    if (py0 == py1)
+    {
+        return;
+    }
+
+    const float direction = py0 < py1 ? 1.0f : -1.0f;
+    if (py0 > py1)
+    {
+        std::swap(px0, px1);
+        std::swap(py0, py1);
+    }
+
+    const double dxdy = (px1 - px0) / (py1 - py0);
+    double x = px0;
+
+    if (py0 < 0.0)
+    {
+        x -= py0 * dxdy;
+    }
+
+    const int yStart = std::max(0, static_cast<int>(std::floor(py0)));
+    const int yEnd = std::min(height, static_cast<int>(std::ceil(py1)));
+
+    dirtyMinY = std::min(dirtyMinY, yStart);
+    dirtyMaxY = std::max(dirtyMaxY, yEnd - 1);
+    dirtyMinX = std::min(dirtyMinX, static_cast<int>(std::floor(std::min(px0, px1))));
+    dirtyMaxX = std::max(dirtyMaxX, static_cast<int>(std::ceil(std::max(px0, px1))));
+
+    for (int y = yStart; y < yEnd; y++)
+    {
+        float *row = accumulation.data() + y * stride;
+
+        const double dy = std::min(static_cast<double>(y + 1), py1) - std::max(static_cast<double>(y), py0);
+        const double xNext = x + dxdy * dy;
+        const float d = static_cast<float>(dy) * direction;
+
+        const double xLeft = std::min(x, xNext);
+        const double xRight = std::max(x, xNext);
+        const double xLeftFloor = std::floor(xLeft);
+        const int xLeftIndex = static_cast<int>(xLeftFloor);
+        const int xRightIndex = static_cast<int>(std::ceil(xRight));
+
+        if (xRightIndex <= xLeftIndex + 1)
+        {
+            // the edge stays within one pixel column on this row
+            const float xMid = static_cast<float>(0.5 * (x + xNext) - xLeftFloor);
+            row[xLeftIndex] += d - d * xMid;
+            row[xLeftIndex + 1] += d * xMid;
+        }
+        else
+        {
+            const double s = 1.0 / (xRight - xLeft);
+            const double xLeftFraction = xLeft - xLeftFloor;
+            const double a0 = 0.5 * s * (1.0 - xLeftFraction) * (1.0 - xLeftFraction);
+            const double xRightFraction = xRight - xRightIndex + 1.0;
+            const double aEnd = 0.5 * s * xRightFraction * xRightFraction;
+
+            row[xLeftIndex] += static_cast<float>(d * a0);
+
+            if (xRightIndex == xLeftIndex + 2)
+            {
+                row[xLeftIndex + 1] += static_cast<float>(d * (1.0 - a0 - aEnd));
+            }
+            else
+            {
+                const double a1 = s * (1.5 - xLeftFraction);
+                row[xLeftIndex + 1] += static_cast<float>(d * (a1 - a0));
+
+                for (int xi = xLeftIndex + 2; xi < xRightIndex - 1; xi++)
+                {
+                    row[xi] += static_cast<float>(d * s);
+                }
+
+                const double a2 = a1 + (xRightIndex - xLeftIndex - 3) * s;
+                row[xRightIndex - 1] += static_cast<float>(d * (1.0 - a2 - aEnd));
+            }
+
+            row[xRightIndex] += static_cast<float>(d * aEnd);
+        }
+
+        x = xNext;
+    }
+}
+
+namespace
+{
+    inline void BlendPixel(std::uint8_t *dst, float coverage, const float premultiplied[4])
+    {
+        const float inverse = 1.0f - premultiplied[3] * coverage / 255.0f;
+
+        for (int c = 0; c < 4; c++)
+        {
+            dst[c] = static_cast<std::uint8_t>(premultiplied[c] * coverage + dst[c] * inverse + 0.5f);
+        }
+    }
+
+    // Composites a run of coverage values; fully covered opaque pixels are stored four at a time
+    void BlendSpan(std::uint8_t *dst, const float *coverage, int count, const float premultiplied[4], std::uint32_t opaquePixel, bool opaque)
+    {
+        int i = 0;
+
+#ifdef RASTERIZER_SSE2
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128i solid = _mm_set1_epi32(static_cast<int>(opaquePixel));
+        const __m128 colour = _mm_setr_ps(premultiplied[0], premultiplied[1], premultiplied[2], premultiplied[3]);
+        const __m128 alphaScale = _mm_set1_ps(premultiplied[3] / 255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128i zero = _mm_setzero_si128();
+
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 c = _mm_min_ps(_mm_andnot_ps(signMask, _mm_loadu_ps(coverage + i)), one);
+            const int full = _mm_movemask_ps(_mm_cmpeq_ps(c, one));
+            const int empty = _mm_movemask_ps(_mm_cmpeq_ps(c, _mm_setzero_ps()));
+
+            if (empty == 0xF)
+            {
+                continue;
+            }
+
+            if (opaque && full == 0xF)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), solid);
+                continue;
+            }
+
+            // widen four RGBA8 pixels to one float vector each
+            const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + 4 * i));
+            const __m128i lo16 = _mm_unpacklo_epi8(packed, zero);
+            const __m128i hi16 = _mm_unpackhi_epi8(packed, zero);
+
+            __m128 pixels[4] = {
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo16, zero)),
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo16, zero)),
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi16, zero)),
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi16, zero))};
+
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, c);
+
+            __m128i results[4];
+            for (int p = 0; p < 4; p++)
+            {
+                const __m128 cov = _mm_set1_ps(lanes[p]);
+                const __m128 inverse = _mm_sub_ps(one, _mm_mul_ps(alphaScale, cov));
+                const __m128 blended = _mm_add_ps(_mm_add_ps(_mm_mul_ps(colour, cov), _mm_mul_ps(pixels[p], inverse)), half);
+                results[p] = _mm_cvttps_epi32(blended);
+            }
+
+            const __m128i packedLo = _mm_packs_epi32(results[0], results[1]);
+            const __m128i packedHi = _mm_packs_epi32(results[2], results[3]);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), _mm_packus_epi16(packedLo, packedHi));
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            const float c = std::min(std::fabs(coverage[i]), 1.0f);
+
+            if (c == 0.0f)
+            {
+                continue;
+            }
+
+            if (opaque && c == 1.0f)
+            {
+                std::memcpy(dst + 4 * i, &opaquePixel, 4);
+            }
+            else
+            {
+                BlendPixel(dst + 4 * i, c, premultiplied);
+            }
+        }
+    }
+}
+
+void ScanlineRasterizer::Fill(RgbaImage &target, Rgba colour)
+{
+    if (dirtyMaxY < dirtyMinY)
+    {
+        return;
+    }
+
+    const int minX = std::clamp(dirtyMinX, 0, width);
+    const int minY = std::max(0, dirtyMinY);
+    const int maxY = std::min(std::min(height, target.height) - 1, dirtyMaxY);
+    const int spanEnd = std::min(width, target.width);
+
+    const float premultiplied[4] = {colour.r * colour.a / 255.0f, colour.g * colour.a / 255.0f,
+                                    colour.b * colour.a / 255.0f, static_cast<float>(colour.a)};
+    const std::uint8_t opaqueBytes[4] = {colour.r, colour.g, colour.b, 255};
+    std::uint32_t opaquePixel;
+    std::memcpy(&opaquePixel, opaqueBytes, 4);
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        float *row = accumulation.data() + y * stride;
+
+        // the running sum is only non-zero between the polygon edges, so the span ends
+        // at the dirty region's right side (anything accumulated further right is off-canvas)
+        const int spanStart = minX;
+        const int spanStop = std::min(spanEnd, dirtyMaxX + 1);
+
+        float sum = 0.0f;
+        for (int x = spanStart; x < spanStop; x++)
+        {
+            sum += row[x];
+            coverageRow[x] = sum;
+        }
+
+        if (spanStop > spanStart)
+        {
+            BlendSpan(target.Row(y) + 4 * spanStart, coverageRow.data() + spanStart, spanStop - spanStart,
+                      premultiplied, opaquePixel, colour.a == 255);
+        }
+    }
+
+    // clear everything that was touched, including the guard columns
+    for (int y = std::max(0, dirtyMinY); y <= std::min(height - 1, dirtyMaxY); y++)
+    {
+        float *row = accumulation.data() + y * stride;
+        std::fill(row + minX, row + stride, 0.0f);
+    }
+
+    dirtyMinX = width;
+    dirtyMaxX = -1;
+    dirtyMinY = height;
+    dirtyMaxY = -1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Rgba
+{
+    std::uint8_t r{0}, g{0}, b{0}, a{255};
+};
+
+// Premultiplied RGBA8 pixels, rows tightly packed
+struct RgbaImage
+{
+    RgbaImage() = default;
+    RgbaImage(int width, int height, Rgba fill = {0, 0, 0, 0});
+
+    void Fill(Rgba colour);
+
+    // Packs the colour channels into `out` (width * height * 3 bytes). Only meaningful for opaque images.
+    void CopyRgb(std::uint8_t *out) const;
+
+    std::uint8_t *Row(int y) { return pixels.data() + static_cast<std::size_t>(y) * width * 4; }
+    const std::uint8_t *Row(int y) const { return pixels.data() + static_cast<std::size_t>(y) * width * 4; }
+
+    int width{0};
+    int height{0};
+    std::vector<std::uint8_t> pixels;
+};
+
+// Scanline polygon rasterizer with analytic (exact area) coverage anti-aliasing.
+// Edges are accumulated as signed areas and resolved with a running sum per row, so any number of
+// polygons added before a Fill() are unioned. Polygons must all wind the same way; use
+// AddPolygon's orientation fix-up when that isn't guaranteed.
+// An instance holds no global state, so separate instances can be used on separate threads.
+class ScanlineRasterizer
+{
+public:
+    ScanlineRasterizer(int width, int height);
+
+    // Closed polygon of interleaved x, y device coordinates
+    void AddPolygon(const double *xy, std::size_t pointCount, bool fixOrientation = true);
+
+    // Composites the accumulated coverage over `target` in `colour` (straight alpha) and clears it
+    void Fill(RgbaImage &target, Rgba colour);
+
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+
+private:
+    void AddLine(double x0, double y0, double x1, double y1);
+    void AccumulateLine(double x0, double y0, double x1, double y1);
+
+    int width;
+    int height;
+    std::size_t stride;
+    std::vector<float> accumulation;
+
+    // region touched since the last Fill()
+    int dirtyMinX, dirtyMaxX, dirtyMinY, dirtyMaxY;
+
+    std::vector<float> coverageRow;
+};
@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "renderlist.h"
+#include "../utils/threadpool.h"
+
+namespace
+{
+    void Prepare(const std::vector<CanvasObject> &objects, std::size_t begin, std::size_t end,
+                 const wxRect2DDouble &visibleArea, const std::vector<std::size_t> &excluded, std::vector<RenderCommand> &out)
+    {
+        auto nextExcluded = std::lower_bound(excluded.begin(), excluded.end(), begin);
+
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const auto &object = objects[i];
+
+            if (nextExcluded != excluded.end() && *nextExcluded == i)
+            {
+                ++nextExcluded;
+                continue;
+            }
+
+            if (!ObjectSpace::GetWorldBounds(object).Intersects(visibleArea))
+            {
+                continue;
+            }
+
+            const auto kind = TransformationKinds::Classify(object.transformation);
+            out.push_back({&object, kind, kind == TransformationKind::Identity ? wxAffineMatrix2D{} : ObjectSpace::GetTransformationMatrix(object)});
+        }
+    }
+}
+
+void RenderList::Build(const std::vector<CanvasObject> &objects, const wxRect2DDouble &visibleArea, const std::vector<std::size_t> &excluded)
+{
+    commands.clear();
+
+    // anti-aliasing reaches a pixel past the geometry
+    auto area = visibleArea;
+    area.Inset(-1.0, -1.0);
+
+    if (objects.size() < ParallelThreshold)
+    {
+        Prepare(objects, 0, objects.size(), area, excluded, commands);
+        return;
+    }
+
+    chunkCommands.resize((objects.size() + ChunkSize - 1) / ChunkSize);
+
+    ThreadPool::Shared().ParallelFor(objects.size(), ChunkSize, [&](std::size_t begin, std::size_t end)
+                                     {
+                                         auto &out = chunkCommands[begin / ChunkSize];
+                                         out.clear();
+                                         Prepare(objects, begin, end, area, excluded, out); });
+
+    std::size_t total = 0;
+
+    for (const auto &chunk : chunkCommands)
+    {
+        total += chunk.size();
+    }
+
+    commands.reserve(total);
+
+    for (const auto &chunk : chunkCommands)
+    {
+        commands.insert(commands.end(), chunk.begin(), chunk.end());
+    }
+}
+
+void RenderList::Execute(wxGraphicsContext &gc, const DrawingOptions &options, SpriteCache *sprites) const
+{
+    // one pen and brush per style for the whole list
+    GraphicsStyleCache styles(gc);
+    auto styledOptions = options;
+
+    if (!styledOptions.styles)
+    {
+        styledOptions.styles = &styles;
+    }
+
+    for (const auto &command : commands)
+    {
+        if (sprites && sprites->Draw(gc, *command.object, command.matrix))
+        {
+            continue;
+        }
+
+        gc.PushState();
+
+        if (command.kind == TransformationKind::Translation)
+        {
+            const auto translation = command.matrix.TransformPoint({0, 0});
+            gc.Translate(translation.m_x, translation.m_y);
+        }
+        else if (command.kind != TransformationKind::Identity)
+        {
+            gc.ConcatTransform(gc.CreateMatrix(command.matrix));
+        }
+
+        std::visit(DrawingVisitor{gc, styledOptions}, *command.object->shape);
+
+        gc.PopState();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <wx/graphics.h>
+#include <wx/affinematrix2d.h>
+
+#include "../canvas/canvasobject.h"
+#include "spritecache.h"
+
+struct RenderCommand
+{
+    const CanvasObject *object;
+    TransformationKind kind;
+    wxAffineMatrix2D matrix; // object to world, unused for Identity
+};
+
+// Per-frame preparation of the objects to draw: transformation kind and matrix, and culling against
+// the visible area. Large scenes are prepared in parallel; the commands stay in z-order, so executing
+// them draws exactly what drawing every object in turn would.
+class RenderList
+{
+public:
+    // Below this many objects a frame is prepared on the calling thread
+    static constexpr std::size_t ParallelThreshold = 4096;
+    static constexpr std::size_t ChunkSize = 1024;
+
+    // `visibleArea` is in world coordinates; `excluded` (sorted) are left out. The commands point into
+    // `objects`, so they are valid until it changes.
+    void Build(const std::vector<CanvasObject> &objects, const wxRect2DDouble &visibleArea, const std::vector<std::size_t> &excluded = {});
+
+    // Objects the sprite cache takes are blitted from it, the rest are drawn as vectors
+    void Execute(wxGraphicsContext &gc, const DrawingOptions &options = {}, SpriteCache *sprites = nullptr) const;
+
+    const std::vector<RenderCommand> &GetCommands() const { return commands; }
+
+private:
+    std::vector<RenderCommand> commands;
+
+    // kept between frames so steady-state preparation doesn't allocate
+    std::vector<std::vector<RenderCommand>> chunkCommands;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+enum class RenderQuality
+{
+    Full,
+    Interactive
+};
+
+// Controls what gets traded away while the user is dragging, and how soon full quality comes back.
+struct RenderQualityPolicy
+{
+    bool enabled{true};
+
+    bool disableAntialiasing{true};
+
+    // Paths with more points than this are drawn decimated (0 disables decimation)
+    std::size_t pathPointBudget{256};
+
+    int refineDelayMs{150};
+};
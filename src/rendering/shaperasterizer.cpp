@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <cmath>
+
+#include "shaperasterizer.h"
+#include "../canvas/canvasobject.h"
+#include "../canvas/objectspace.h"
+#include "imagesource.h"
+#include "../transforms/batchtransform.h"
+#include "../utils/visitor.h"
+
+namespace
+{
+    constexpr double CurveTolerance = 0.35; // max deviation of a flattened arc, in pixels
+    constexpr int MinArcSegments = 6;
+    constexpr int MaxArcSegments = 1024;
+
+    BatchTransform::AffineCoefficients ToCoefficients(const wxAffineMatrix2D &matrix)
+    {
+        wxMatrix2D linear;
+        wxPoint2DDouble translation;
+        matrix.Get(&linear, &translation);
+
+        return {linear.m_11, linear.m_12, linear.m_21, linear.m_22, translation.m_x, translation.m_y};
+    }
+
+    double DeviceScale(const BatchTransform::AffineCoefficients &m)
+    {
+        return std::sqrt(std::fabs(m.m11 * m.m22 - m.m12 * m.m21));
+    }
+
+    int ArcSegments(double deviceRadius)
+    {
+        if (deviceRadius <= CurveTolerance)
+        {
+            return MinArcSegments;
+        }
+
+        const double step = 2.0 * std::acos(1.0 - CurveTolerance / deviceRadius);
+        return std::clamp(static_cast<int>(std::ceil(2.0 * M_PI / step)), MinArcSegments, MaxArcSegments);
+    }
+
+    // Collects polygons in shape coordinates and transforms them all in one batch before rasterizing
+    struct PolygonBatch
+    {
+        std::vector<double> xy;
+        std::vector<std::size_t> starts;
+
+        void Begin()
+        {
+            starts.push_back(xy.size() / 2);
+        }
+
+        void Add(double x, double y)
+        {
+            xy.push_back(x);
+            xy.push_back(y);
+        }
+
+        void AddCircle(double cx, double cy, double radius, int segments)
+        {
+            Begin();
+            for (int i = 0; i < segments; i++)
+            {
+                const double angle = 2.0 * M_PI * i / segments;
+                Add(cx + radius * std::cos(angle), cy + radius * std::sin(angle));
+            }
+        }
+
+        void Rasterize(ScanlineRasterizer &rasterizer, const BatchTransform::AffineCoefficients &m)
+        {
+            const std::size_t pointCount = xy.size() / 2;
+            BatchTransform::TransformPoints(m, xy.data(), xy.data(), pointCount);
+
+            for (std::size_t i = 0; i < starts.size(); i++)
+            {
+                const std::size_t end = i + 1 < starts.size() ? starts[i + 1] : pointCount;
+                rasterizer.AddPolygon(xy.data() + 2 * starts[i], end - starts[i]);
+            }
+        }
+    };
+
+    // Consecutive repeats make zero-length segments, which have no direction to offset along
+    std::vector<wxPoint2DDouble> DistinctPoints(const std::vector<wxPoint2DDouble> &points, bool closed)
+    {
+        std::vector<wxPoint2DDouble> distinct;
+        distinct.reserve(points.size());
+
+        for (const auto &point : points)
+        {
+            if (distinct.empty() || point != distinct.back())
+            {
+                distinct.push_back(point);
+            }
+        }
+
+        while (closed && distinct.size() > 1 && distinct.back() == distinct.front())
+        {
+            distinct.pop_back();
+        }
+
+        return distinct;
+    }
+
+    // The points strictly between the ends of an arc of `sweep` radians, starting at angle `from`
+    void AddArc(PolygonBatch &batch, const wxPoint2DDouble &centre, double radius, double from, double sweep, int segments)
+    {
+        const int steps = static_cast<int>(std::ceil(std::fabs(sweep) / (2.0 * M_PI) * segments));
+
+        for (int i = 1; i < steps; i++)
+        {
+            const double angle = from + sweep * i / steps;
+            batch.Add(centre.m_x + radius * std::cos(angle), centre.m_y + radius * std::sin(angle));
+        }
+    }
+
+    // Walks the left side of `points`, `halfWidth` away. Outer joins, and the end cap of an open line, are
+    // rounded with `segments` per full turn (0 bevels them and leaves the end flat); inner joins go through
+    // the vertex. Every part of the stroke then winds the same way, and the pieces meet without overlapping
+    // along the outside edge, where coverage adding up would show as a seam.
+    void AddOffsetSide(PolygonBatch &batch, const std::vector<wxPoint2DDouble> &points, double halfWidth, int segments, bool closed)
+    {
+        const std::size_t count = points.size();
+        const std::size_t segmentCount = closed ? count : count - 1;
+
+        auto normalOf = [&](std::size_t i)
+        {
+            const auto d = points[(i + 1) % count] - points[i];
+            return wxPoint2DDouble(-d.m_y, d.m_x) * (halfWidth / std::hypot(d.m_x, d.m_y));
+        };
+
+        for (std::size_t i = 0; i < segmentCount; i++)
+        {
+            const auto &a = points[i];
+            const auto &b = points[(i + 1) % count];
+            const auto normal = normalOf(i);
+
+            batch.Add(a.m_x + normal.m_x, a.m_y + normal.m_y);
+            batch.Add(b.m_x + normal.m_x, b.m_y + normal.m_y);
+
+            const double from = std::atan2(normal.m_y, normal.m_x);
+
+            if (!closed && i + 1 == segmentCount)
+            {
+                AddArc(batch, b, halfWidth, from, -M_PI, segments);
+                continue;
+            }
+
+            const auto next = normalOf((i + 1) % count);
+            const double cross = normal.m_x * next.m_y - normal.m_y * next.m_x;
+            const double dot = normal.m_x * next.m_x + normal.m_y * next.m_y;
+
+            // a line doubling back on itself is rounded on both sides
+            const double turn = cross == 0.0 && dot < 0.0 ? -M_PI : std::atan2(cross, dot);
+
+            if (turn < 0.0)
+            {
+                AddArc(batch, b, halfWidth, from, turn, segments);
+            }
+            else if (turn > 0.0)
+            {
+                batch.Add(b.m_x, b.m_y);
+            }
+        }
+    }
+
+    // One polygon around the whole line, down one side and back up the other
+    void BuildStroke(PolygonBatch &batch, const std::vector<wxPoint2DDouble> &points, double width, double deviceScale)
+    {
+        const double halfWidth = std::max(width, 1.0 / deviceScale) / 2.0;
+        const int segments = halfWidth * deviceScale > 0.75 ? ArcSegments(halfWidth * deviceScale) : 0;
+
+        auto distinct = DistinctPoints(points, false);
+
+        if (distinct.size() == 1)
+        {
+            // a dot, as a round cap on either end of a zero-length line
+            if (segments > 0)
+            {
+                batch.AddCircle(distinct[0].m_x, distinct[0].m_y, halfWidth, segments);
+            }
+            return;
+        }
+
+        batch.Begin();
+        AddOffsetSide(batch, distinct, halfWidth, segments, false);
+        std::reverse(distinct.begin(), distinct.end());
+        AddOffsetSide(batch, distinct, halfWidth, segments, false);
+    }
+
+    // The fill and its 1px outline in the same colour, as DrawingVisitor draws them: the polygon grown
+    // by half the pen width, with round corners
+    void BuildOutlinedFill(PolygonBatch &batch, const std::vector<wxPoint2DDouble> &points, double deviceScale)
+    {
+        const double halfWidth = std::max(1.0, 1.0 / deviceScale) / 2.0;
+        const int segments = halfWidth * deviceScale > 0.75 ? ArcSegments(halfWidth * deviceScale) : 0;
+
+        auto distinct = DistinctPoints(points, true);
+
+        if (distinct.size() < 2)
+        {
+            BuildStroke(batch, distinct, 1.0, deviceScale);
+            return;
+        }
+
+        // the left side has to be the outside
+        double signedArea = 0.0;
+
+        for (std::size_t i = 0, j = distinct.size() - 1; i < distinct.size(); j = i++)
+        {
+            signedArea += distinct[j].m_x * distinct[i].m_y - distinct[i].m_x * distinct[j].m_y;
+        }
+
+        if (signedArea > 0.0)
+        {
+            std::reverse(distinct.begin(), distinct.end());
+        }
+
+        batch.Begin();
+        AddOffsetSide(batch, distinct, halfWidth, segments, true);
+    }
+
+    // Bilinear sample of premultiplied pixels at continuous coordinates, clamped to the edges
+    void Sample(const RgbaImage &image, double u, double v, float out[4])
+    {
+        u = std::clamp(u, 0.0, image.width - 1.0);
+        v = std::clamp(v, 0.0, image.height - 1.0);
+
+        const int x0 = static_cast<int>(u), y0 = static_cast<int>(v);
+        const int x1 = std::min(x0 + 1, image.width - 1), y1 = std::min(y0 + 1, image.height - 1);
+        const float fx = static_cast<float>(u - x0), fy = static_cast<float>(v - y0);
+
+        const auto *row0 = image.Row(y0);
+        const auto *row1 = image.Row(y1);
+
+        for (int c = 0; c < 4; c++)
+        {
+            const float top = row0[4 * x0 + c] + (row0[4 * x1 + c] - row0[4 * x0 + c]) * fx;
+            const float bottom = row1[4 * x0 + c] + (row1[4 * x1 + c] - row1[4 * x0 + c]) * fx;
+            out[c] = top + (bottom - top) * fy;
+        }
+    }
+
+    // Maps every covered target pixel back into the mip level that matches the scale. The image's
+    // edges are hard: at worst half a pixel off, which the software paths accept for images.
+    void DrawImage(RgbaImage &target, const RasterImage &image, const BatchTransform::AffineCoefficients &m)
+    {
+        const auto &rect = image.rect;
+        const auto &source = *image.source;
+
+        if (rect.m_width <= 0 || rect.m_height <= 0)
+        {
+            return;
+        }
+
+        const double imageScale = std::sqrt(rect.m_width * rect.m_height / (static_cast<double>(source.GetWidth()) * source.GetHeight()));
+        const auto &level = source.GetLevel(source.ChooseLevel(DeviceScale(m) * imageScale));
+
+        // level pixels to device: device = (u * a + v * c + tx, u * b + v * d + ty)
+        const double sx = rect.m_width / level.width, sy = rect.m_height / level.height;
+        const double a = m.m11 * sx, b = m.m12 * sx, c = m.m21 * sy, d = m.m22 * sy;
+        const double tx = m.m11 * rect.m_x + m.m21 * rect.m_y + m.tx;
+        const double ty = m.m12 * rect.m_x + m.m22 * rect.m_y + m.ty;
+        const double det = a * d - b * c;
+
+        if (std::fabs(det) < 1e-12)
+        {
+            return;
+        }
+
+        double minX = tx, maxX = tx, minY = ty, maxY = ty;
+
+        for (const auto &[u, v] : {std::pair{level.width, 0}, std::pair{0, level.height}, std::pair{level.width, level.height}})
+        {
+            minX = std::min(minX, u * a + v * c + tx);
+            maxX = std::max(maxX, u * a + v * c + tx);
+            minY = std::min(minY, u * b + v * d + ty);
+            maxY = std::max(maxY, u * b + v * d + ty);
+        }
+
+        const int left = std::max(0, static_cast<int>(std::floor(minX)));
+        const int right = std::min(target.width, static_cast<int>(std::ceil(maxX)));
+        const int top = std::max(0, static_cast<int>(std::floor(minY)));
+        const int bottom = std::min(target.height, static_cast<int>(std::ceil(maxY)));
+
+        for (int y = top; y < bottom; y++)
+        {
+            auto *row = target.Row(y);
+            const double dy = y + 0.5 - ty;
+
+            for (int x = left; x < right; x++)
+            {
+                const double dx = x + 0.5 - tx;
+                const double u = (d * dx - c * dy) / det;
+                const double v = (a * dy - b * dx) / det;
+
+                if (u < 0 || v < 0 || u >= level.width || v >= level.height)
+                {
+                    continue;
+                }
+
+                float colour[4];
+                Sample(level, u - 0.5, v - 0.5, colour);
+
+                auto *dst = row + 4 * x;
+                const float inverse = 1.0f - colour[3] / 255.0f;
+
+                for (int i = 0; i < 4; i++)
+                {
+                    dst[i] = static_cast<std::uint8_t>(colour[i] + dst[i] * inverse + 0.5f);
+                }
+            }
+        }
+    }
+}
+
+namespace ShapeRasterizer
+{
+    Rgba ToRgba(const wxColour &colour)
+    {
+        return {colour.Red(), colour.Green(), colour.Blue(), colour.Alpha()};
+    }
+
+    void Draw(ScanlineRasterizer &rasterizer, RgbaImage &target, const Shape &shape, const wxAffineMatrix2D &matrix)
+    {
+        const auto m = ToCoefficients(matrix);
+        const double deviceScale = DeviceScale(m);
+
+        PolygonBatch batch;
+
+        const wxColour &colour = std::visit(visitor{[&](const Path &path) -> const wxColour &
+                                                    {
+                                                        if (path.points.size() > 1)
+                                                        {
+                                                            BuildStroke(batch, path.points, path.width, deviceScale);
+                                                        }
+                                                        return path.color;
+                                                    },
+                                                    [&](const Rect &rect) -> const wxColour &
+                                                    {
+                                                        const auto &r = rect.rect;
+                                                        BuildOutlinedFill(batch, {{r.m_x, r.m_y}, {r.m_x + r.m_width, r.m_y},
+                                                                                  {r.m_x + r.m_width, r.m_y + r.m_height}, {r.m_x, r.m_y + r.m_height}},
+                                                                          deviceScale);
+                                                        return rect.color;
+                                                    },
+                                                    [&](const Circle &circle) -> const wxColour &
+                                                    {
+                                                        // grown by half the outline's width
+                                                        const double radius = circle.radius + std::max(1.0, 1.0 / deviceScale) / 2.0;
+                                                        batch.AddCircle(circle.center.m_x, circle.center.m_y, radius,
+                                                                        ArcSegments(radius * deviceScale));
+                                                        return circle.color;
+                                                    },
+                                                    [&](const FilledPolygon &polygon) -> const wxColour &
+                                                    {
+                                                        if (polygon.points.size() > 2)
+                                                        {
+                                                            BuildOutlinedFill(batch, polygon.points, deviceScale);
+                                                        }
+                                                        return polygon.color;
+                                                    },
+                                                    [&](const Group &group) -> const wxColour &
+                                                    {
+                                                        // the children fill with their own colours, leaving the batch empty
+                                                        for (const auto &child : group.children)
+                                                        {
+                                                            Draw(rasterizer, target, child, matrix);
+                                                        }
+                                                        return wxNullColour;
+                                                    },
+                                                    [&](const RasterImage &image) -> const wxColour &
+                                                    {
+                                                        // composited directly, leaving the batch empty
+                                                        DrawImage(target, image, m);
+                                                        return wxNullColour;
+                                                    }},
+                                            shape);
+
+        if (batch.starts.empty())
+        {
+            return;
+        }
+
+        batch.Rasterize(rasterizer, m);
+        rasterizer.Fill(target, ToRgba(colour));
+    }
+
+    void Draw(ScanlineRasterizer &rasterizer, RgbaImage &target, const CanvasObject &object, const wxAffineMatrix2D &view)
+    {
+        wxAffineMatrix2D matrix = view;
+        matrix.Concat(ObjectSpace::GetTransformationMatrix(object));
+
+        Draw(rasterizer, target, *object.shape, matrix);
+    }
+}
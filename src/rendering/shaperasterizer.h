@@ -0,0 +1,23 @@
+#pragma once
+
+#include <wx/affinematrix2d.h>
+
+#include "rasterizer.h"
+#include "../shapes/shape.h"
+
+struct CanvasObject;
+
+// Draws shapes with the software rasterizer, matching what DrawingVisitor draws through wxGraphicsContext:
+// filled Rects, Circles and FilledPolygons with their 1px outline, Paths stroked with round joins and caps,
+// and images sampled from the mip level that matches the scale. Each stroke or outlined fill is a single
+// polygon, so its pieces don't add up to extra coverage where they meet.
+namespace ShapeRasterizer
+{
+    Rgba ToRgba(const wxColour &colour);
+
+    // `matrix` maps the shape's coordinates to target pixels
+    void Draw(ScanlineRasterizer &rasterizer, RgbaImage &target, const Shape &shape, const wxAffineMatrix2D &matrix);
+
+    // Draws the object under its own Transformation, then `view`
+    void Draw(ScanlineRasterizer &rasterizer, RgbaImage &target, const CanvasObject &object, const wxAffineMatrix2D &view);
+}
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include "spritecache.h"
+#include "rasterizer.h"
+#include "shaperasterizer.h"
+#include "../utils/visitor.h"
+
+namespace
+{
+    // 64 buckets per doubling: a sprite is stretched by at most ~0.5% to the exact scale, too little to blur it
+    constexpr double ScaleBucketsPerOctave = 64.0;
+    constexpr double LinearQuantization = 4096.0;
+}
+
+SpriteCache::SpriteCache(const SpriteCachePolicy &policy)
+    : policy(policy)
+{
+}
+
+void SpriteCache::SetPolicy(const SpriteCachePolicy &policy)
+{
+    this->policy = policy;
+
+    if (!policy.enabled)
+    {
+        Clear();
+    }
+    else
+    {
+        EvictToBudget();
+    }
+}
+
+void SpriteCache::BeginFrame(const wxAffineMatrix2D &view, double contentScale)
+{
+    this->contentScale = contentScale;
+
+    deviceView = wxAffineMatrix2D();
+    deviceView.Scale(contentScale, contentScale);
+    deviceView.Concat(view);
+}
+
+void SpriteCache::Clear()
+{
+    sprites.clear();
+    lru.clear();
+    statistics.bytes = 0;
+    statistics.sprites = 0;
+}
+
+bool SpriteCache::IsWorthCaching(const CanvasObject &object) const
+{
+    return policy.enabled && ShapeUtils::CountPoints(*object.shape) >= policy.minimumPoints;
+}
+
+bool SpriteCache::Draw(wxGraphicsContext &gc, const CanvasObject &object, const wxAffineMatrix2D &objectMatrix)
+{
+    if (!IsWorthCaching(object))
+    {
+        return false;
+    }
+
+    wxAffineMatrix2D deviceMatrix = deviceView;
+    deviceMatrix.Concat(objectMatrix);
+
+    wxMatrix2D linear;
+    wxPoint2DDouble translation;
+    deviceMatrix.Get(&linear, &translation);
+
+    const double scale = std::sqrt(std::fabs(linear.m_11 * linear.m_22 - linear.m_12 * linear.m_21));
+
+    if (scale <= 0.0)
+    {
+        return true; // degenerate, nothing visible
+    }
+
+    SpriteKey key{object.id, static_cast<std::int64_t>(std::lround(std::log2(scale) * ScaleBucketsPerOctave)),
+                  {static_cast<std::int32_t>(std::lround(linear.m_11 / scale * LinearQuantization)),
+                   static_cast<std::int32_t>(std::lround(linear.m_12 / scale * LinearQuantization)),
+                   static_cast<std::int32_t>(std::lround(linear.m_21 / scale * LinearQuantization)),
+                   static_cast<std::int32_t>(std::lround(linear.m_22 / scale * LinearQuantization))}};
+
+    auto it = sprites.find(key);
+
+    if (it != sprites.end())
+    {
+        statistics.hits++;
+        lru.splice(lru.begin(), lru, it->second.lruPosition);
+    }
+    else
+    {
+        statistics.misses++;
+
+        Sprite sprite;
+
+        if (!Render(object, deviceMatrix, sprite))
+        {
+            return false;
+        }
+
+        sprite.scale = scale;
+
+        lru.push_front(key);
+        sprite.lruPosition = lru.begin();
+        it = sprites.emplace(key, std::move(sprite)).first;
+
+        statistics.bytes += static_cast<std::size_t>(it->second.width) * it->second.height * 4;
+        statistics.sprites++;
+
+        EvictToBudget();
+
+        // a sprite bigger than the whole budget was evicted right away
+        it = sprites.find(key);
+
+        if (it == sprites.end())
+        {
+            return false;
+        }
+    }
+
+    const auto &sprite = it->second;
+
+    // stretched about the object's translation to the scale the bucket rounded away
+    const double ratio = scale / sprite.scale;
+    double left = translation.m_x - sprite.anchor.m_x * ratio;
+    double top = translation.m_y - sprite.anchor.m_y * ratio;
+
+    if (ratio == 1.0)
+    {
+        // whole device pixels, so the sprite's anti-aliasing isn't resampled
+        left = std::round(left);
+        top = std::round(top);
+    }
+
+    gc.PushState();
+    gc.SetTransform(gc.CreateMatrix());
+    gc.DrawBitmap(sprite.bitmap, left / contentScale, top / contentScale, sprite.width * ratio / contentScale,
+                  sprite.height * ratio / contentScale);
+    gc.PopState();
+
+    return true;
+}
+
+bool SpriteCache::Render(const CanvasObject &object, const wxAffineMatrix2D &deviceMatrix, Sprite &sprite) const
+{
+    wxMatrix2D linear;
+    wxPoint2DDouble translation;
+    deviceMatrix.Get(&linear, &translation);
+
+    // shape to device offset from the whole-pixel part of the translation, which is added back when blitting
+    wxAffineMatrix2D local;
+    local.Set(linear, {translation.m_x - std::round(translation.m_x), translation.m_y - std::round(translation.m_y)});
+
+    const auto &box = object.boundingBox;
+    const wxPoint2DDouble corners[] = {box.GetLeftTop(), box.GetRightTop(), box.GetRightBottom(), box.GetLeftBottom()};
+
+    double minX = std::numeric_limits<double>::max(), minY = std::numeric_limits<double>::max();
+    double maxX = -std::numeric_limits<double>::max(), maxY = -std::numeric_limits<double>::max();
+
+    for (const auto &corner : corners)
+    {
+        const auto pt = local.TransformPoint(corner);
+        minX = std::min(minX, pt.m_x);
+        minY = std::min(minY, pt.m_y);
+        maxX = std::max(maxX, pt.m_x);
+        maxY = std::max(maxY, pt.m_y);
+    }
+
+    // one pixel of room for anti-aliasing
+    const int originX = static_cast<int>(std::floor(minX)) - 1;
+    const int originY = static_cast<int>(std::floor(minY)) - 1;
+    const int width = static_cast<int>(std::ceil(maxX)) + 1 - originX;
+    const int height = static_cast<int>(std::ceil(maxY)) + 1 - originY;
+
+    if (width > policy.maximumSpriteSize || height > policy.maximumSpriteSize)
+    {
+        return false;
+    }
+
+    wxAffineMatrix2D toSprite;
+    toSprite.Translate(-originX, -originY);
+    toSprite.Concat(local);
+
+    RgbaImage image(width, height);
+    ScanlineRasterizer rasterizer(width, height);
+    ShapeRasterizer::Draw(rasterizer, image, *object.shape, toSprite);
+
+    // wxImage wants straight alpha in a separate plane
+    const std::size_t pixelCount = static_cast<std::size_t>(width) * height;
+    auto *rgb = static_cast<unsigned char *>(malloc(pixelCount * 3));
+    auto *alpha = static_cast<unsigned char *>(malloc(pixelCount));
+
+    for (std::size_t i = 0; i < pixelCount; i++)
+    {
+        const auto *pixel = &image.pixels[i * 4];
+        const unsigned a = pixel[3];
+
+        for (int c = 0; c < 3; c++)
+        {
+            rgb[i * 3 + c] = a ? static_cast<unsigned char>(std::min(255u, (pixel[c] * 255u + a / 2) / a)) : 0;
+        }
+
+        alpha[i] = static_cast<unsigned char>(a);
+    }
+
+    sprite.bitmap = wxBitmap(wxImage(width, height, rgb, alpha));
+    sprite.width = width;
+    sprite.height = height;
+    sprite.anchor = {translation.m_x - std::round(translation.m_x) - originX, translation.m_y - std::round(translation.m_y) - originY};
+
+    return true;
+}
+
+void SpriteCache::EvictToBudget()
+{
+    while (statistics.bytes > policy.memoryBudget && !lru.empty())
+    {
+        const auto it = sprites.find(lru.back());
+
+        statistics.bytes -= static_cast<std::size_t>(it->second.width) * it->second.height * 4;
+        statistics.sprites--;
+        statistics.evictions++;
+
+        sprites.erase(it);
+        lru.pop_back();
+    }
+}
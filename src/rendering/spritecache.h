@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include <wx/graphics.h>
+#include <wx/affinematrix2d.h>
+
+#include "../canvas/canvasobject.h"
+#include "spritecachepolicy.h"
+
+// Rasterized images of expensive objects, keyed by object id and the scale/rotation part of the device
+// matrix. Moving an object only changes the translation, so its sprite is reused and blitted at the new
+// position; rotating or scaling it lands in a different bucket and renders a new sprite. Within a bucket
+// the sprite is stretched to the exact scale, so it stays the object's size.
+class SpriteCache
+{
+public:
+    struct Statistics
+    {
+        std::size_t hits{0};
+        std::size_t misses{0};
+        std::size_t evictions{0};
+        std::size_t bytes{0};
+        std::size_t sprites{0};
+    };
+
+    explicit SpriteCache(const SpriteCachePolicy &policy = {});
+
+    void SetPolicy(const SpriteCachePolicy &policy);
+
+    // `view` maps world to window coordinates; `contentScale` is the window's pixels per logical unit
+    void BeginFrame(const wxAffineMatrix2D &view, double contentScale);
+
+    // Draws `object` (placed in the world by `objectMatrix`) from its sprite on a context in window
+    // coordinates. Returns false if the object isn't worth caching; the caller then draws it directly.
+    bool Draw(wxGraphicsContext &gc, const CanvasObject &object, const wxAffineMatrix2D &objectMatrix);
+
+    void Clear();
+
+    const Statistics &GetStatistics() const { return statistics; }
+
+private:
+    struct SpriteKey
+    {
+        std::uint64_t objectId;
+        std::int64_t scaleBucket;
+        std::int32_t linear[4]; // the device matrix's linear part, normalized by its scale
+
+        bool operator==(const SpriteKey &other) const
+        {
+            return objectId == other.objectId && scaleBucket == other.scaleBucket && linear[0] == other.linear[0] &&
+                   linear[1] == other.linear[1] && linear[2] == other.linear[2] && linear[3] == other.linear[3];
+        }
+    };
+
+    struct SpriteKeyHash
+    {
+        std::size_t operator()(const SpriteKey &key) const
+        {
+            std::size_t hash = std::hash<std::uint64_t>{}(key.objectId);
+
+            for (const auto value : {key.scaleBucket, std::int64_t{key.linear[0]}, std::int64_t{key.linear[1]},
+                                     std::int64_t{key.linear[2]}, std::int64_t{key.linear[3]}})
+            {
+                hash = hash * 31 + std::hash<std::int64_t>{}(value);
+            }
+
+            return hash;
+        }
+    };
+
+    struct Sprite
+    {
+        wxBitmap bitmap;
+        int width;
+        int height;
+        wxPoint2DDouble anchor; // where the object's translation falls in the sprite, in its pixels
+        double scale;           // the device scale it was rendered at
+        std::list<SpriteKey>::iterator lruPosition;
+    };
+
+    bool IsWorthCaching(const CanvasObject &object) const;
+
+    // Rasterizes `object` under the linear part of `deviceMatrix`. Returns false if the sprite would be too big.
+    bool Render(const CanvasObject &object, const wxAffineMatrix2D &deviceMatrix, Sprite &sprite) const;
+
+    void EvictToBudget();
+
+    SpriteCachePolicy policy;
+
+    wxAffineMatrix2D deviceView;
+    double contentScale{1.0};
+
+    std::unordered_map<SpriteKey, Sprite, SpriteKeyHash> sprites;
+    std::list<SpriteKey> lru; // most recently used first
+
+    Statistics statistics;
+};
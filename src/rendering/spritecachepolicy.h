@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+// Which objects get cached as sprites and how much memory the sprites may take
+struct SpriteCachePolicy
+{
+    bool enabled{true};
+
+    std::size_t memoryBudget{64 * 1024 * 1024};
+
+    // Only paths and polygons with at least this many points are worth a sprite
+    std::size_t minimumPoints{512};
+
+    // Larger sprites (in device pixels per side) are drawn as vectors instead
+    int maximumSpriteSize{4096};
+};
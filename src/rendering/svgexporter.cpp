@@ -0,0 +1,367 @@
+#include <wx/stream.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "svgexporter.h"
+#include "../canvas/canvasobject.h"
+#include "../canvas/objectspace.h"
+#include "imagesource.h"
+#include "../utils/visitor.h"
+
+namespace
+{
+    constexpr std::size_t FlushThreshold = 64 * 1024;
+    constexpr int MatrixPrecision = 6;
+
+    class SvgWriter
+    {
+    public:
+        SvgWriter(wxOutputStream &out, int precision)
+            : out(out), precision(std::clamp(precision, 0, 9)), scale(std::pow(10.0, this->precision))
+        {
+            buffer.reserve(FlushThreshold + 4096);
+        }
+
+        SvgWriter &operator<<(const char *text)
+        {
+            buffer += text;
+            return *this;
+        }
+
+        // Coordinate at the writer's precision
+        SvgWriter &operator<<(double value)
+        {
+            WriteFixed(Quantize(value), precision);
+            return *this;
+        }
+
+        std::int64_t Quantize(double value) const
+        {
+            return static_cast<std::int64_t>(std::llround(value * scale));
+        }
+
+        // `scaled` is a value multiplied by 10^decimals
+        void WriteFixed(std::int64_t scaled, int decimals)
+        {
+            if (scaled < 0)
+            {
+                buffer += '-';
+                scaled = -scaled;
+            }
+
+            std::int64_t divisor = 1;
+
+            for (int i = 0; i < decimals; i++)
+            {
+                divisor *= 10;
+            }
+
+            const auto integer = scaled / divisor;
+            auto fraction = scaled % divisor;
+
+            if (integer != 0 || fraction == 0)
+            {
+                buffer += std::to_string(integer);
+            }
+
+            if (fraction != 0)
+            {
+                int digits = decimals;
+
+                while (fraction % 10 == 0)
+                {
+                    fraction /= 10;
+                    digits--;
+                }
+
+                const auto fractionText = std::to_string(fraction);
+                buffer += '.';
+                buffer.append(digits - fractionText.size(), '0');
+                buffer += fractionText;
+            }
+        }
+
+        // Numbers in a path or list: a minus sign separates them on its own
+        void WriteListValue(std::int64_t scaled)
+        {
+            if (scaled >= 0 && !buffer.empty() && buffer.back() != ' ' && buffer.back() != '"' && !std::isalpha(static_cast<unsigned char>(buffer.back())))
+            {
+                buffer += ' ';
+            }
+
+            WriteFixed(scaled, precision);
+        }
+
+        void WriteColour(const wxColour &colour)
+        {
+            static const char hex[] = "0123456789abcdef";
+            const unsigned char channels[] = {colour.Red(), colour.Green(), colour.Blue()};
+
+            buffer += '#';
+
+            for (const auto channel : channels)
+            {
+                buffer += hex[channel >> 4];
+                buffer += hex[channel & 0xF];
+            }
+        }
+
+        void WriteMatrix(const wxAffineMatrix2D &matrix)
+        {
+            wxMatrix2D linear;
+            wxPoint2DDouble translation;
+            matrix.Get(&linear, &translation);
+
+            const double values[] = {linear.m_11, linear.m_12, linear.m_21, linear.m_22};
+            const double matrixScale = std::pow(10.0, MatrixPrecision);
+
+            buffer += "matrix(";
+
+            for (const auto value : values)
+            {
+                WriteFixed(static_cast<std::int64_t>(std::llround(value * matrixScale)), MatrixPrecision);
+                buffer += ' ';
+            }
+
+            *this << translation.m_x;
+            buffer += ' ';
+            *this << translation.m_y;
+            buffer += ')';
+        }
+
+        // Flushes along the way, so a large image never sits in the buffer whole; a failed write
+        // surfaces at the next Checkpoint
+        void WriteBase64(const std::vector<unsigned char> &data)
+        {
+            static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+            for (std::size_t i = 0; i < data.size(); i += 3)
+            {
+                const std::uint32_t bits = std::uint32_t{data[i]} << 16 | (i + 1 < data.size() ? std::uint32_t{data[i + 1]} << 8 : 0) |
+                                           (i + 2 < data.size() ? std::uint32_t{data[i + 2]} : 0);
+
+                buffer += alphabet[bits >> 18];
+                buffer += alphabet[(bits >> 12) & 0x3F];
+                buffer += i + 1 < data.size() ? alphabet[(bits >> 6) & 0x3F] : '=';
+                buffer += i + 2 < data.size() ? alphabet[bits & 0x3F] : '=';
+
+                if (buffer.size() >= FlushThreshold)
+                {
+                    Flush();
+                }
+            }
+        }
+
+        // Flushes once enough has accumulated
+        bool Checkpoint()
+        {
+            return buffer.size() < FlushThreshold || Flush();
+        }
+
+        bool Flush()
+        {
+            if (!buffer.empty())
+            {
+                out.Write(buffer.data(), buffer.size());
+
+                if (out.LastWrite() != buffer.size())
+                {
+                    return false;
+                }
+
+                buffer.clear();
+            }
+
+            return true;
+        }
+
+    private:
+        wxOutputStream &out;
+        int precision;
+        double scale;
+        std::string buffer;
+    };
+
+    void WritePaint(SvgWriter &writer, const char *attribute, const wxColour &colour)
+    {
+        writer << " " << attribute << "=\"";
+        writer.WriteColour(colour);
+        writer << "\"";
+
+        if (colour.Alpha() != wxALPHA_OPAQUE)
+        {
+            writer << " " << attribute << "-opacity=\"";
+            writer.WriteFixed(std::lround(colour.Alpha() / 255.0 * 1000), 3);
+            writer << "\"";
+        }
+    }
+
+    // Relative polyline. Deltas are taken between quantized positions, so rounding never accumulates.
+    void WritePolyline(SvgWriter &writer, const std::vector<wxPoint2DDouble> &points, bool close)
+    {
+        writer << " d=\"M";
+
+        auto previousX = writer.Quantize(points.front().m_x);
+        auto previousY = writer.Quantize(points.front().m_y);
+
+        writer.WriteListValue(previousX);
+        writer.WriteListValue(previousY);
+
+        if (points.size() > 1)
+        {
+            writer << "l";
+        }
+
+        for (std::size_t i = 1; i < points.size(); i++)
+        {
+            const auto x = writer.Quantize(points[i].m_x);
+            const auto y = writer.Quantize(points[i].m_y);
+
+            writer.WriteListValue(x - previousX);
+            writer.WriteListValue(y - previousY);
+
+            previousX = x;
+            previousY = y;
+        }
+
+        writer << (close ? "z\"" : "\"");
+    }
+
+    void WriteTransform(SvgWriter &writer, const CanvasObject &object)
+    {
+        switch (TransformationKinds::Classify(object.transformation))
+        {
+        case TransformationKind::Identity:
+            return;
+        case TransformationKind::Translation:
+            writer << " transform=\"translate(" << object.transformation.translationX << " " << object.transformation.translationY << ")\"";
+            return;
+        default:
+            writer << " transform=\"";
+            writer.WriteMatrix(ObjectSpace::GetTransformationMatrix(object));
+            writer << "\"";
+            return;
+        }
+    }
+
+    // Mirrors DrawingVisitor: filled shapes also get a one unit outline in their own colour
+    void WriteObject(SvgWriter &writer, const CanvasObject &object)
+    {
+        std::visit(visitor{[&](const Path &path)
+                           {
+                               if (path.points.size() < 2)
+                               {
+                                   return;
+                               }
+
+                               writer << "<path";
+                               WriteTransform(writer, object);
+                               WritePolyline(writer, path.points, false);
+                               writer << " fill=\"none\"";
+                               WritePaint(writer, "stroke", path.color);
+                               writer << " stroke-width=\"" << static_cast<double>(path.width) << "\"/>\n";
+                           },
+                           [&](const Rect &rect)
+                           {
+                               writer << "<rect";
+                               WriteTransform(writer, object);
+                               writer << " x=\"" << rect.rect.m_x << "\" y=\"" << rect.rect.m_y << "\" width=\"" << rect.rect.m_width
+                                      << "\" height=\"" << rect.rect.m_height << "\"";
+                               WritePaint(writer, "fill", rect.color);
+                               WritePaint(writer, "stroke", rect.color);
+                               writer << "/>\n";
+                           },
+                           [&](const Circle &circle)
+                           {
+                               writer << "<circle";
+                               WriteTransform(writer, object);
+                               writer << " cx=\"" << circle.center.m_x << "\" cy=\"" << circle.center.m_y << "\" r=\"" << circle.radius << "\"";
+                               WritePaint(writer, "fill", circle.color);
+                               WritePaint(writer, "stroke", circle.color);
+                               writer << "/>\n";
+                           },
+                           [&](const FilledPolygon &polygon)
+                           {
+                               if (polygon.points.size() < 3)
+                               {
+                                   return;
+                               }
+
+                               writer << "<path";
+                               WriteTransform(writer, object);
+                               WritePolyline(writer, polygon.points, true);
+                               WritePaint(writer, "fill", polygon.color);
+                               WritePaint(writer, "stroke", polygon.color);
+                               writer << "/>\n";
+                           },
+                           [&](const Group &group)
+                           {
+                               writer << "<g";
+                               WriteTransform(writer, object);
+                               writer << ">\n";
+
+                               for (const auto &child : group.children)
+                               {
+                                   WriteObject(writer, child);
+                               }
+
+                               writer << "</g>\n";
+                           },
+                           [&](const RasterImage &image)
+                           {
+                               writer << "<image";
+                               WriteTransform(writer, object);
+                               writer << " x=\"" << image.rect.m_x << "\" y=\"" << image.rect.m_y << "\" width=\"" << image.rect.m_width
+                                      << "\" height=\"" << image.rect.m_height << "\" preserveAspectRatio=\"none\" href=\"data:"
+                                      << image.source->GetMimeType().c_str() << ";base64,";
+                               writer.WriteBase64(image.source->GetEncoded());
+                               writer << "\"/>\n";
+                           }},
+                   *object.shape);
+    }
+}
+
+namespace SvgExporter
+{
+    bool Export(const std::vector<CanvasObject> &objects, const SvgExportSettings &settings, wxOutputStream &out)
+    {
+        SvgWriter writer(out, settings.precision);
+        const auto &area = settings.sourceArea;
+
+        writer << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << settings.outputWidth << "\" height=\"" << settings.outputHeight
+               << "\" viewBox=\"" << area.m_x << " " << area.m_y << " " << area.m_width << " " << area.m_height << "\">\n";
+
+        if (settings.background.Alpha() != wxALPHA_TRANSPARENT)
+        {
+            writer << "<rect x=\"" << area.m_x << "\" y=\"" << area.m_y << "\" width=\"" << area.m_width << "\" height=\"" << area.m_height << "\"";
+            WritePaint(writer, "fill", settings.background);
+            writer << "/>\n";
+        }
+
+        // wx pens default to round caps and joins
+        writer << "<g stroke-linecap=\"round\" stroke-linejoin=\"round\">\n";
+
+        for (const auto &object : objects)
+        {
+            if (!ObjectSpace::GetWorldBounds(object).Intersects(area))
+            {
+                continue;
+            }
+
+            WriteObject(writer, object);
+
+            if (!writer.Checkpoint())
+            {
+                return false;
+            }
+        }
+
+        writer << "</g>\n</svg>\n";
+
+        return writer.Flush();
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include <wx/colour.h>
+#include <wx/geometry.h>
+
+class wxOutputStream;
+struct CanvasObject;
+
+struct SvgExportSettings
+{
+    // area of the drawing to export, in world coordinates
+    wxRect2DDouble sourceArea;
+
+    // size of the SVG canvas in CSS pixels; the source area is scaled to fit it
+    double outputWidth;
+    double outputHeight;
+
+    // decimals kept for coordinates
+    int precision{2};
+
+    // a fully transparent colour leaves the background out
+    wxColour background{*wxWHITE};
+};
+
+// Writes the drawing as SVG, one object at a time through a small buffer, so the whole document never
+// sits in memory. Each object keeps its own coordinates with its Transformation as a `transform`
+// attribute; polylines are written as relative `d` strings at the configured precision.
+namespace SvgExporter
+{
+    bool Export(const std::vector<CanvasObject> &objects, const SvgExportSettings &settings, wxOutputStream &out);
+}
@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <tuple>
+
+#include "tilecache.h"
+#include "rasterizer.h"
+#include "shaperasterizer.h"
+#include "../utils/threadpool.h"
+
+namespace
+{
+    constexpr int MinLevel = -8;
+    constexpr int MaxLevel = 8;
+
+    constexpr std::size_t MaxInvalidationTests = 1 << 20;
+}
+
+TileCache::TileCache(std::size_t memoryBudget)
+    : memoryBudget(memoryBudget)
+{
+}
+
+wxRect2DDouble TileCache::GetWorldRect(const TileKey &key)
+{
+    const double worldTileSize = std::ldexp(static_cast<double>(TileSize), -key.level);
+    return wxRect2DDouble(key.x * worldTileSize, key.y * worldTileSize, worldTileSize, worldTileSize);
+}
+
+void TileCache::Clear()
+{
+    tiles.clear();
+    lru.clear();
+    synchronized = false;
+}
+
+void TileCache::Draw(wxGraphicsContext &gc, const Scene &scene, const Viewport &viewport, wxSize windowSize, double contentScale)
+{
+    Synchronize(scene);
+
+    const int level = std::clamp(static_cast<int>(std::ceil(std::log2(viewport.zoom * contentScale) - 1e-9)), MinLevel, MaxLevel);
+    const double worldTileSize = std::ldexp(static_cast<double>(TileSize), -level);
+
+    const auto visible = viewport.ToWorld(wxRect2DDouble(0, 0, windowSize.GetWidth(), windowSize.GetHeight()));
+    const int firstX = static_cast<int>(std::floor(visible.m_x / worldTileSize));
+    const int firstY = static_cast<int>(std::floor(visible.m_y / worldTileSize));
+    const int lastX = static_cast<int>(std::floor((visible.m_x + visible.m_width) / worldTileSize));
+    const int lastY = static_cast<int>(std::floor((visible.m_y + visible.m_height) / worldTileSize));
+
+    std::vector<TileKey> visibleKeys;
+    std::vector<TileKey> missing;
+
+    for (int y = firstY; y <= lastY; y++)
+    {
+        for (int x = firstX; x <= lastX; x++)
+        {
+            const TileKey key{level, x, y};
+            visibleKeys.push_back(key);
+
+            if (tiles.find(key) == tiles.end())
+            {
+                missing.push_back(key);
+            }
+        }
+    }
+
+    RenderTiles(scene, missing);
+
+    // tile edges are snapped to whole window units, so neighbours meet without seams
+    const auto snappedX = [&](int tileX)
+    { return std::round(viewport.ToWindow({tileX * worldTileSize, 0}).m_x); };
+    const auto snappedY = [&](int tileY)
+    { return std::round(viewport.ToWindow({0, tileY * worldTileSize}).m_y); };
+
+    for (const auto &key : visibleKeys)
+    {
+        auto &tile = tiles.at(key);
+        Touch(tile);
+
+        const double left = snappedX(key.x);
+        const double top = snappedY(key.y);
+        gc.DrawBitmap(tile.bitmap, left, top, snappedX(key.x + 1) - left, snappedY(key.y + 1) - top);
+    }
+
+    const std::size_t budgetTiles = std::max<std::size_t>(1, memoryBudget / BytesPerTile);
+    EvictDownTo(std::max(budgetTiles, visibleKeys.size()));
+}
+
+void TileCache::Synchronize(const Scene &scene)
+{
+    const auto &objects = scene.objects;
+    const auto &excluded = scene.excludedIndices;
+
+    const auto record = [&](std::size_t i, bool isExcluded)
+    {
+        return DrawnObject{objects[i].id, objects[i].transformation, isExcluded, scene.index.GetBounds(i)};
+    };
+
+    if (!synchronized || scene.rewriteVersion != rewriteVersion)
+    {
+        std::vector<DrawnObject> current;
+        current.reserve(objects.size());
+
+        auto nextExcluded = excluded.begin();
+
+        for (std::size_t i = 0; i < objects.size(); i++)
+        {
+            const bool isExcluded = nextExcluded != excluded.end() && *nextExcluded == i;
+            nextExcluded += isExcluded;
+
+            current.push_back(record(i, isExcluded));
+        }
+
+        if (synchronized)
+        {
+            InvalidateRewritten(std::move(current));
+        }
+        else
+        {
+            tiles.clear();
+            lru.clear();
+            drawn = std::move(current);
+        }
+    }
+    else
+    {
+        std::vector<wxRect2DDouble> changed;
+
+        if (excluded != excludedIndices)
+        {
+            // only objects that joined or left the exclusions look different
+            std::vector<std::size_t> toggled;
+            std::set_symmetric_difference(excludedIndices.begin(), excludedIndices.end(),
+                                          excluded.begin(), excluded.end(), std::back_inserter(toggled));
+
+            for (const auto index : toggled)
+            {
+                if (index < drawn.size())
+                {
+                    drawn[index].excluded = !drawn[index].excluded;
+                    changed.push_back(drawn[index].bounds);
+                }
+            }
+        }
+
+        // only appends since the last draw
+        for (std::size_t i = drawn.size(); i < objects.size(); i++)
+        {
+            drawn.push_back(record(i, std::binary_search(excluded.begin(), excluded.end(), i)));
+            changed.push_back(drawn.back().bounds);
+        }
+
+        InvalidateAreas(changed);
+    }
+
+    synchronized = true;
+    sceneVersion = scene.sceneVersion;
+    rewriteVersion = scene.rewriteVersion;
+    excludedIndices = excluded;
+}
+
+// Finds the objects that differ between what the tiles show and `current`, and drops the tiles under
+// both their old and new bounds
+void TileCache::InvalidateRewritten(std::vector<DrawnObject> current)
+{
+    // an edit leaves both ends of the list alone
+    std::size_t first = 0;
+
+    while (first < drawn.size() && first < current.size() && drawn[first] == current[first])
+    {
+        first++;
+    }
+
+    std::size_t drawnEnd = drawn.size();
+    std::size_t currentEnd = current.size();
+
+    while (drawnEnd > first && currentEnd > first && drawn[drawnEnd - 1] == current[currentEnd - 1])
+    {
+        drawnEnd--;
+        currentEnd--;
+    }
+
+    std::vector<wxRect2DDouble> changed;
+
+    if (drawnEnd - first == currentEnd - first)
+    {
+        // transforms and replacements keep every index
+        for (std::size_t i = first; i < drawnEnd; i++)
+        {
+            if (drawn[i] != current[i])
+            {
+                changed.push_back(drawn[i].bounds);
+                changed.push_back(current[i].bounds);
+            }
+        }
+    }
+    else
+    {
+        // objects were taken out and others put in; those on one side only are the change. Nothing moves in
+        // z-order without being taken out and put back as a different object, so the rest look the same.
+        const auto less = [](const DrawnObject *a, const DrawnObject *b)
+        {
+            const auto &x = a->transformation;
+            const auto &y = b->transformation;
+
+            return std::tie(a->id, x.translationX, x.translationY, x.rotationAngle, x.scaleX, x.scaleY, a->excluded) <
+                   std::tie(b->id, y.translationX, y.translationY, y.rotationAngle, y.scaleX, y.scaleY, b->excluded);
+        };
+
+        std::vector<const DrawnObject *> before, after;
+
+        for (std::size_t i = first; i < drawnEnd; i++)
+        {
+            before.push_back(&drawn[i]);
+        }
+
+        for (std::size_t i = first; i < currentEnd; i++)
+        {
+            after.push_back(&current[i]);
+        }
+
+        std::sort(before.begin(), before.end(), less);
+        std::sort(after.begin(), after.end(), less);
+
+        auto b = before.begin();
+        auto a = after.begin();
+
+        while (b != before.end() || a != after.end())
+        {
+            if (a == after.end() || (b != before.end() && less(*b, *a)))
+            {
+                changed.push_back((*b++)->bounds);
+            }
+            else if (b == before.end() || less(*a, *b))
+            {
+                changed.push_back((*a++)->bounds);
+            }
+            else
+            {
+                ++b;
+                ++a;
+            }
+        }
+    }
+
+    drawn = std::move(current);
+    InvalidateAreas(changed);
+}
+
+void TileCache::InvalidateAreas(const std::vector<wxRect2DDouble> &worldAreas)
+{
+    if (worldAreas.empty())
+    {
+        return;
+    }
+
+    // past this, testing every tile against every area costs more than rendering the view again
+    if (worldAreas.size() * tiles.size() > MaxInvalidationTests)
+    {
+        tiles.clear();
+        lru.clear();
+        return;
+    }
+
+    for (auto it = tiles.begin(); it != tiles.end();)
+    {
+        // anti-aliasing reaches a pixel past the geometry
+        auto tileArea = GetWorldRect(it->first);
+        const double pixel = std::ldexp(1.0, -it->first.level);
+        tileArea.Inset(-pixel, -pixel);
+
+        if (std::any_of(worldAreas.begin(), worldAreas.end(), [&](const wxRect2DDouble &area)
+                        { return tileArea.Intersects(area); }))
+        {
+            lru.erase(it->second.lruPosition);
+            it = tiles.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void TileCache::RenderTiles(const Scene &scene, const std::vector<TileKey> &keys)
+{
+    if (keys.empty())
+    {
+        return;
+    }
+
+    std::vector<std::vector<unsigned char>> pixels(keys.size());
+
+    ThreadPool::Shared().ParallelFor(keys.size(), 1, [&](std::size_t begin, std::size_t end)
+                                     {
+                                         RgbaImage image(TileSize, TileSize);
+                                         ScanlineRasterizer rasterizer(TileSize, TileSize);
+                                         std::vector<std::size_t> candidates;
+
+                                         for (std::size_t i = begin; i < end; i++)
+                                         {
+                                             const auto &key = keys[i];
+                                             const double scale = std::ldexp(1.0, key.level);
+
+                                             auto area = GetWorldRect(key);
+                                             area.Inset(-1.0 / scale, -1.0 / scale);
+
+                                             wxAffineMatrix2D view;
+                                             view.Translate(-key.x * static_cast<double>(TileSize), -key.y * static_cast<double>(TileSize));
+                                             view.Scale(scale, scale);
+
+                                             image.Fill({255, 255, 255, 255});
+
+                                             // in z-order
+                                             candidates.clear();
+                                             scene.index.Query(area, candidates);
+                                             std::sort(candidates.begin(), candidates.end());
+
+                                             for (const auto o : candidates)
+                                             {
+                                                 if (!drawn[o].excluded)
+                                                 {
+                                                     ShapeRasterizer::Draw(rasterizer, image, scene.objects[o], view);
+                                                 }
+                                             }
+
+                                             pixels[i].resize(static_cast<std::size_t>(TileSize) * TileSize * 3);
+                                             image.CopyRgb(pixels[i].data());
+                                         } });
+
+    // wx bitmaps are only created on the UI thread
+    for (std::size_t i = 0; i < keys.size(); i++)
+    {
+        wxImage image(TileSize, TileSize, pixels[i].data(), true);
+
+        lru.push_front(keys[i]);
+        tiles[keys[i]] = Tile{wxBitmap(image), lru.begin()};
+    }
+}
+
+void TileCache::Touch(Tile &tile)
+{
+    lru.splice(lru.begin(), lru, tile.lruPosition);
+}
+
+void TileCache::EvictDownTo(std::size_t tileCount)
+{
+    while (tiles.size() > tileCount)
+    {
+        tiles.erase(lru.back());
+        lru.pop_back();
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <wx/graphics.h>
+
+#include "../canvas/canvasobject.h"
+#include "../canvas/spatialindex.h"
+#include "../canvas/viewport.h"
+
+// Pyramid of rasterized tiles of the committed scene. Level L holds the world rendered at 2^L pixels per
+// unit, cut into TileSize squares; each paint picks the level just above the current zoom and scales it
+// down, so panning re-blits cached tiles and zooming only renders once per power of two.
+// Tiles are rendered with the software rasterizer, in parallel. An edit only drops the tiles under the
+// objects it changed, wherever they were before and are now.
+class TileCache
+{
+public:
+    static constexpr int TileSize = 256;
+
+    struct Scene
+    {
+        const std::vector<CanvasObject> &objects;
+        std::uint64_t sceneVersion;
+        std::uint64_t rewriteVersion; // see DrawingDocument::GetRewriteVersion()
+        const std::vector<std::size_t> &excludedIndices; // sorted; drawn live by the caller, e.g. the selection
+        const SpatialIndex &index; // up to date with `objects`
+    };
+
+    explicit TileCache(std::size_t memoryBudget = 128 * 1024 * 1024);
+
+    // Draws `scene` as seen through `viewport` on a window of `windowSize`. `contentScale` is the
+    // window's pixels per logical unit.
+    void Draw(wxGraphicsContext &gc, const Scene &scene, const Viewport &viewport, wxSize windowSize, double contentScale);
+
+    void Clear();
+
+    std::size_t GetMemoryUsage() const { return tiles.size() * BytesPerTile; }
+
+private:
+    static constexpr std::size_t BytesPerTile = static_cast<std::size_t>(TileSize) * TileSize * 4;
+
+    struct TileKey
+    {
+        int level;
+        int x;
+        int y;
+
+        bool operator==(const TileKey &other) const { return level == other.level && x == other.x && y == other.y; }
+    };
+
+    struct TileKeyHash
+    {
+        std::size_t operator()(const TileKey &key) const
+        {
+            return (static_cast<std::size_t>(key.level) * 0x9E3779B1u) ^ (static_cast<std::size_t>(key.x) * 0x85EBCA77u) ^
+                   (static_cast<std::size_t>(key.y) * 0xC2B2AE3Du);
+        }
+    };
+
+    struct Tile
+    {
+        wxBitmap bitmap;
+        std::list<TileKey>::iterator lruPosition;
+    };
+
+    // What the tiles show of an object. The id and transformation determine its pixels.
+    struct DrawnObject
+    {
+        std::uint64_t id;
+        Transformation transformation;
+        bool excluded;
+        wxRect2DDouble bounds;
+
+        bool operator==(const DrawnObject &other) const
+        {
+            return id == other.id && transformation == other.transformation && excluded == other.excluded;
+        }
+
+        bool operator!=(const DrawnObject &other) const { return !(*this == other); }
+    };
+
+    static wxRect2DDouble GetWorldRect(const TileKey &key);
+
+    // Drops cached tiles that the changes since the last Draw touched
+    void Synchronize(const Scene &scene);
+    void InvalidateRewritten(std::vector<DrawnObject> current);
+    void InvalidateAreas(const std::vector<wxRect2DDouble> &worldAreas);
+
+    void RenderTiles(const Scene &scene, const std::vector<TileKey> &keys);
+    void Touch(Tile &tile);
+    void EvictDownTo(std::size_t tileCount);
+
+    std::size_t memoryBudget;
+
+    std::unordered_map<TileKey, Tile, TileKeyHash> tiles;
+    std::list<TileKey> lru; // most recently used first
+
+    // what the cached tiles show
+    bool synchronized{false};
+    std::uint64_t sceneVersion{0};
+    std::uint64_t rewriteVersion{0};
+    std::vector<std::size_t> excludedIndices;
+    std::vector<DrawnObject> drawn; // per object, in document order
+};
@@ -0,0 +1,294 @@
+#include <wx/graphics.h>
+#include <wx/image.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+
+#include "tiledexporter.h"
+#include "pngstreamwriter.h"
+#include "shaperasterizer.h"
+#include "../canvas/canvasobject.h"
+#include "../canvas/objectspace.h"
+#include "../utils/threadpool.h"
+
+namespace
+{
+    constexpr int BytesPerPixel = 3;
+    constexpr auto ProgressInterval = std::chrono::milliseconds(50);
+
+    struct TileJob
+    {
+        int x, y, width, height;
+        std::vector<const CanvasObject *> objects;
+    };
+
+    void CopyTileRows(const TileJob &tile, const TiledExportSettings &settings, unsigned char *band, int bandY,
+                      const unsigned char *pixels, int pixelStride)
+    {
+        const std::size_t bandStride = static_cast<std::size_t>(settings.outputWidth) * BytesPerPixel;
+
+        for (int row = 0; row < tile.height; row++)
+        {
+            unsigned char *dst = band + (tile.y - bandY + row) * bandStride + tile.x * BytesPerPixel;
+            const unsigned char *src = pixels + static_cast<std::size_t>(row) * tile.width * pixelStride;
+
+            if (pixelStride == BytesPerPixel)
+            {
+                std::memcpy(dst, src, static_cast<std::size_t>(tile.width) * BytesPerPixel);
+                continue;
+            }
+
+            for (int x = 0; x < tile.width; x++)
+            {
+                std::memcpy(dst + x * BytesPerPixel, src + x * pixelStride, BytesPerPixel);
+            }
+        }
+    }
+
+    wxAffineMatrix2D TileMatrix(const TileJob &tile, const TiledExportSettings &settings, double scale)
+    {
+        wxAffineMatrix2D matrix;
+        matrix.Translate(-tile.x, -tile.y);
+        matrix.Scale(scale, scale);
+        matrix.Translate(-settings.sourceArea.m_x, -settings.sourceArea.m_y);
+
+        return matrix;
+    }
+
+    void RenderTileSoftware(const TileJob &tile, const TiledExportSettings &settings, double scale,
+                            unsigned char *band, int bandY, const std::atomic<bool> &cancelled)
+    {
+        // the background is opaque, so premultiplied pixels are the final colours
+        RgbaImage image(tile.width, tile.height, ShapeRasterizer::ToRgba(settings.background));
+        ScanlineRasterizer rasterizer(tile.width, tile.height);
+
+        const auto matrix = TileMatrix(tile, settings, scale);
+
+        for (const auto object : tile.objects)
+        {
+            if (cancelled)
+            {
+                return;
+            }
+
+            ShapeRasterizer::Draw(rasterizer, image, *object, matrix);
+        }
+
+        CopyTileRows(tile, settings, band, bandY, image.pixels.data(), 4);
+    }
+
+    void RenderTilePlatform(const TileJob &tile, const TiledExportSettings &settings, double scale,
+                            unsigned char *band, int bandY, const std::atomic<bool> &cancelled)
+    {
+        wxImage image(tile.width, tile.height, false);
+        unsigned char *data = image.GetData();
+
+        for (int i = 0; i < tile.width * tile.height; i++)
+        {
+            data[i * 3] = settings.background.Red();
+            data[i * 3 + 1] = settings.background.Green();
+            data[i * 3 + 2] = settings.background.Blue();
+        }
+
+        if (!tile.objects.empty())
+        {
+            std::unique_ptr<wxGraphicsContext> gc{wxGraphicsContext::Create(image)};
+
+            if (gc)
+            {
+                gc->SetTransform(gc->CreateMatrix(TileMatrix(tile, settings, scale)));
+
+                GraphicsStyleCache styles(*gc);
+
+                DrawingOptions options;
+                options.detachColours = true;
+                options.styles = &styles;
+
+                for (const auto object : tile.objects)
+                {
+                    if (cancelled)
+                    {
+                        return;
+                    }
+
+                    object->Draw(*gc, options);
+                }
+            }
+            // the context writes its pixels back into the image when destroyed
+        }
+
+        CopyTileRows(tile, settings, band, bandY, image.GetData(), BytesPerPixel);
+    }
+
+    // Rasterizes one tile and copies its pixels into the band buffer
+    void RenderTile(const TileJob &tile, const TiledExportSettings &settings, double scale,
+                    unsigned char *band, int bandY, const std::atomic<bool> &cancelled)
+    {
+        if (cancelled)
+        {
+            return;
+        }
+
+        if (settings.renderer == ExportRenderer::Software)
+        {
+            RenderTileSoftware(tile, settings, scale, band, bandY, cancelled);
+        }
+        else
+        {
+            RenderTilePlatform(tile, settings, scale, band, bandY, cancelled);
+        }
+    }
+
+    std::vector<const CanvasObject *> Intersecting(const std::vector<const CanvasObject *> &candidates,
+                                                   const std::vector<wxRect2DDouble> &bounds,
+                                                   const std::vector<CanvasObject> &objects,
+                                                   const wxRect2DDouble &area)
+    {
+        std::vector<const CanvasObject *> result;
+
+        for (const auto object : candidates)
+        {
+            if (bounds[object - objects.data()].Intersects(area))
+            {
+                result.push_back(object);
+            }
+        }
+
+        return result;
+    }
+}
+
+namespace TiledExporter
+{
+    Result ExportPng(const std::vector<CanvasObject> &objects, const TiledExportSettings &settings,
+                     wxOutputStream &out, const ProgressCallback &progress)
+    {
+        if (settings.outputWidth <= 0 || settings.outputHeight <= 0 || settings.sourceArea.m_width <= 0)
+        {
+            return Result::Failed;
+        }
+
+        if (settings.renderer == ExportRenderer::Platform)
+        {
+            // the default renderer is created lazily; make sure that happens on this thread
+            wxGraphicsRenderer::GetDefaultRenderer();
+        }
+
+        const double scale = settings.outputWidth / settings.sourceArea.m_width;
+        const int tileSize = std::max(16, settings.tileSize);
+
+        // a pixel of slack for anti-aliasing bleeding across tile edges
+        const double margin = 1.0 / scale;
+
+        std::vector<wxRect2DDouble> bounds;
+        std::vector<const CanvasObject *> all;
+        bounds.reserve(objects.size());
+        all.reserve(objects.size());
+
+        for (const auto &object : objects)
+        {
+            auto worldBounds = ObjectSpace::GetWorldBounds(object);
+            worldBounds.Inset(-margin, -margin);
+
+            bounds.push_back(worldBounds);
+            all.push_back(&object);
+        }
+
+        const auto toWorld = [&](int x, int y, int w, int h)
+        {
+            return wxRect2DDouble(settings.sourceArea.m_x + x / scale, settings.sourceArea.m_y + y / scale, w / scale, h / scale);
+        };
+
+        const int columns = (settings.outputWidth + tileSize - 1) / tileSize;
+        const int rows = (settings.outputHeight + tileSize - 1) / tileSize;
+        const int totalTiles = columns * rows;
+
+        PngStreamWriter png(out, settings.outputWidth, settings.outputHeight, PngStreamWriter::PixelFormat::RGB);
+
+        std::vector<unsigned char> band(static_cast<std::size_t>(settings.outputWidth) * tileSize * BytesPerPixel);
+        std::atomic<bool> cancelled{false};
+        int finishedTiles = 0;
+
+        // tiles go to the shared pool, at most `inFlight` at a time; with one thread they render right here
+        ThreadPool *pool = settings.threadCount == 1 ? nullptr : &ThreadPool::Shared();
+        const std::size_t inFlight = settings.threadCount > 0 ? settings.threadCount : ThreadPool::DefaultThreadCount();
+
+        for (int row = 0; row < rows; row++)
+        {
+            const int bandY = row * tileSize;
+            const int bandHeight = std::min(tileSize, settings.outputHeight - bandY);
+
+            const auto bandObjects = Intersecting(all, bounds, objects, toWorld(0, bandY, settings.outputWidth, bandHeight));
+
+            // every tile of the band is waited for before it is written or the export returns: they use its locals
+            std::deque<std::future<void>> pending;
+
+            const auto finishOldest = [&]
+            {
+                auto &future = pending.front();
+
+                while (future.wait_for(ProgressInterval) != std::future_status::ready)
+                {
+                    if (progress && !progress(finishedTiles, totalTiles))
+                    {
+                        cancelled = true;
+                    }
+                }
+
+                future.get();
+                pending.pop_front();
+                finishedTiles++;
+            };
+
+            for (int column = 0; column < columns; column++)
+            {
+                auto tile = std::make_shared<TileJob>();
+                tile->x = column * tileSize;
+                tile->y = bandY;
+                tile->width = std::min(tileSize, settings.outputWidth - tile->x);
+                tile->height = bandHeight;
+                tile->objects = Intersecting(bandObjects, bounds, objects, toWorld(tile->x, tile->y, tile->width, tile->height));
+
+                if (!pool)
+                {
+                    if (progress && !progress(finishedTiles, totalTiles))
+                    {
+                        cancelled = true;
+                    }
+
+                    RenderTile(*tile, settings, scale, band.data(), bandY, cancelled);
+                    finishedTiles++;
+                    continue;
+                }
+
+                if (pending.size() >= inFlight)
+                {
+                    finishOldest();
+                }
+
+                pending.push_back(pool->Submit([tile, &settings, scale, &band, bandY, &cancelled]
+                                               { RenderTile(*tile, settings, scale, band.data(), bandY, cancelled); }));
+            }
+
+            while (!pending.empty())
+            {
+                finishOldest();
+            }
+
+            if (cancelled || (progress && !progress(finishedTiles, totalTiles)))
+            {
+                return Result::Cancelled;
+            }
+
+            if (!png.WriteRows(band.data(), bandHeight))
+            {
+                return Result::Failed;
+            }
+        }
+
+        return png.Finish() ? Result::Done : Result::Failed;
+    }
+}
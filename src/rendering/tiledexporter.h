@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <wx/colour.h>
+#include <wx/geometry.h>
+
+class wxOutputStream;
+struct CanvasObject;
+
+enum class ExportRenderer
+{
+    Software, // ScanlineRasterizer: thread safe and deterministic
+    Platform  // wxGraphicsContext on a wxImage per tile
+};
+
+struct TiledExportSettings
+{
+    // area of the drawing to export, in world coordinates
+    wxRect2DDouble sourceArea;
+
+    int outputWidth;
+    int outputHeight;
+
+    int tileSize{512};
+    unsigned threadCount{0}; // tiles rendered at once on the shared pool: 0 = one per core, 1 = all on the calling thread
+
+    wxColour background{*wxWHITE};
+
+    ExportRenderer renderer{ExportRenderer::Software};
+};
+
+// Renders the drawing at an arbitrary resolution, a row of tiles at a time, on the shared thread pool.
+// Each finished row is streamed straight into the PNG encoder, so memory use is bounded by
+// one row of tiles no matter how large the output is. It waits for its tiles, so it must not be
+// called from a task of the shared pool unless threadCount is 1.
+namespace TiledExporter
+{
+    // Called on the calling thread between tiles. Return false to cancel the export.
+    using ProgressCallback = std::function<bool(int finishedTiles, int totalTiles)>;
+
+    enum class Result
+    {
+        Done,
+        Cancelled,
+        Failed
+    };
+
+    Result ExportPng(const std::vector<CanvasObject> &objects, const TiledExportSettings &settings,
+                     wxOutputStream &out, const ProgressCallback &progress = {});
+}
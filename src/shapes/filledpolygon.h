@@ -0,0 +1,10 @@
+#pragma once
+
+#include <wx/wx.h>
+#include <vector>
+
+struct FilledPolygon
+{
+    std::vector<wxPoint2DDouble> points;
+    wxColour color;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <wx/geometry.h>
+#include <vector>
+
+struct CanvasObject;
+
+// Objects drawn, hit-tested and transformed as one through the group object's own Transformation.
+// Like every shape it never changes once built, so what it caches about its children stays valid;
+// Grouping::BuildGroup fills it in.
+struct Group
+{
+    std::vector<CanvasObject> children;
+
+    // union of the children's world bounds, i.e. in the group's own coordinates
+    wxRect2DDouble bounds;
+    std::size_t pointCount{0};
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <memory>
+
+#include <wx/graphics.h>
+
+class ImageSource;
+
+// An imported bitmap, stretched over `rect` in object coordinates. Copies share the pixels.
+struct RasterImage
+{
+    std::shared_ptr<const ImageSource> source;
+    wxRect2DDouble rect;
+};
@@ -5,5 +5,8 @@
 #include "path.h"
 #include "rect.h"
 #include "circle.h"
+#include "filledpolygon.h"
+#include "group.h"
+#include "rasterimage.h"
 
-using Shape = std::variant<Path, Rect, Circle>;
\ No newline at end of file
+using Shape = std::variant<Path, Rect, Circle, FilledPolygon, Group, RasterImage>;
\ No newline at end of file
@@ -11,10 +11,8 @@
 
 struct ShapeFactory
 {
-    static Shape Create(ToolSettings &settings, wxPoint origin)
+    static Shape Create(ToolSettings &settings, wxPoint2DDouble origin2D)
     {
-        wxPoint2DDouble origin2D = origin;
-
         switch (settings.currentTool)
         {
         case ToolType::Pen:
@@ -19,6 +19,23 @@ namespace ShapeUtils
                            {
                                boundingBox = rect.rect;
                            },
+                           [&boundingBox](const FilledPolygon &polygon)
+                           {
+                               double minX = std::numeric_limits<double>::max();
+                               double minY = std::numeric_limits<double>::max();
+                               double maxX = -std::numeric_limits<double>::max();
+                               double maxY = -std::numeric_limits<double>::max();
+
+                               for (const auto &pt : polygon.points)
+                               {
+                                   minX = std::min(minX, pt.m_x);
+                                   minY = std::min(minY, pt.m_y);
+                                   maxX = std::max(maxX, pt.m_x);
+                                   maxY = std::max(maxY, pt.m_y);
+                               }
+
+                               boundingBox = wxRect2DDouble(minX, minY, maxX - minX, maxY - minY);
+                           },
                            [&boundingBox](const Path &path)
                            {
                                double minX = std::numeric_limits<double>::max();
@@ -36,9 +53,31 @@ namespace ShapeUtils
 
                                boundingBox = wxRect2DDouble(minX - path.width / 2, minY - path.width / 2,
                                                             maxX - minX + path.width, maxY - minY + path.width);
+                           },
+                           [&boundingBox](const Group &group)
+                           {
+                               boundingBox = group.bounds;
+                           },
+                           [&boundingBox](const RasterImage &image)
+                           {
+                               boundingBox = image.rect;
                            }},
                    shape);
 
         return boundingBox;
     }
-}
\ No newline at end of file
+
+    // Vertices of paths and polygons, including those inside groups; the other shapes have none
+    static std::size_t CountPoints(const Shape &shape)
+    {
+        return std::visit(visitor{[](const Path &path)
+                                  { return path.points.size(); },
+                                  [](const FilledPolygon &polygon)
+                                  { return polygon.points.size(); },
+                                  [](const Group &group)
+                                  { return group.pointCount; },
+                                  [](const auto &)
+                                  { return std::size_t{0}; }},
+                          shape);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <wx/graphics.h>
+
+// What a shape is drawn with: its colour and, for strokes, the width (filled shapes use 1)
+struct Style
+{
+    wxColour colour;
+    int width{1};
+};
+
+// A style by value, for hashing; the colour's reference count is never touched, so any thread may build one
+struct StyleKey
+{
+    std::uint32_t rgba;
+    int width;
+
+    static StyleKey Of(const wxColour &colour, int width = 1)
+    {
+        const std::uint32_t rgba = colour.IsOk() ? (std::uint32_t{colour.Red()} << 24 | std::uint32_t{colour.Green()} << 16 |
+                                                     std::uint32_t{colour.Blue()} << 8 | std::uint32_t{colour.Alpha()})
+                                                  : 0;
+        return {rgba, width};
+    }
+
+    bool operator==(const StyleKey &other) const { return rgba == other.rgba && width == other.width; }
+};
+
+struct StyleKeyHash
+{
+    std::size_t operator()(const StyleKey &key) const
+    {
+        return std::hash<std::uint64_t>{}(std::uint64_t{key.rgba} << 32 | static_cast<std::uint32_t>(key.width));
+    }
+};
+
+// Interns styles to small dense indices. Equal styles get the same index and one shared wxColour, so
+// shapes that take their colour from the table share its reference-counted data instead of each owning a copy.
+class StyleTable
+{
+public:
+    std::size_t Intern(const wxColour &colour, int width = 1)
+    {
+        const auto [found, inserted] = indices.try_emplace(StyleKey::Of(colour, width), styles.size());
+
+        if (inserted)
+        {
+            styles.push_back({colour, width});
+        }
+
+        return found->second;
+    }
+
+    const Style &operator[](std::size_t index) const { return styles[index]; }
+    std::size_t Size() const { return styles.size(); }
+
+private:
+    std::vector<Style> styles;
+    std::unordered_map<StyleKey, std::size_t, StyleKeyHash> indices;
+};
@@ -0,0 +1,96 @@
+#include <cstdio>
+
+#include "../canvas/canvasobject.h"
+#include "../canvas/baking.h"
+#include "../canvas/grouping.h"
+
+// Bake on Save may only bake what comes out looking the same, so the checks below pin down which
+// transformed objects Baking::BakesExactly lets through.
+namespace
+{
+    int failures = 0;
+
+    void Check(bool condition, const char *what)
+    {
+        if (!condition)
+        {
+            std::fprintf(stderr, "%s\n", what);
+            failures++;
+        }
+    }
+
+    const wxColour Red{255, 0, 0};
+
+    CanvasObject Transformed(Shape shape, double scaleX, double scaleY, double rotation = 0.0)
+    {
+        CanvasObject object(std::move(shape));
+        object.transformation.translationX = 7;
+        object.transformation.rotationAngle = rotation;
+        object.transformation.scaleX = scaleX;
+        object.transformation.scaleY = scaleY;
+
+        return object;
+    }
+
+    Path Stroke(int width)
+    {
+        return Path{{{0, 0}, {10, 5}, {20, 0}}, Red, width};
+    }
+
+    void TestStrokes()
+    {
+        Check(Baking::BakesExactly(Transformed(Stroke(3), 1, 1, 0.7)), "stroke: moved and rotated isn't exact");
+        Check(Baking::BakesExactly(Transformed(Stroke(3), -1, 1)), "stroke: mirrored isn't exact");
+        Check(Baking::BakesExactly(Transformed(Stroke(2), 1.5, 1.5)), "stroke: width 2 at 1.5 isn't exact");
+        Check(!Baking::BakesExactly(Transformed(Stroke(1), 1.5, 1.5)), "stroke: width 1 at 1.5 rounds to 2");
+        Check(!Baking::BakesExactly(Transformed(Stroke(2), 0.1, 0.1)), "stroke: width 2 at 0.1 widens to 1");
+        Check(!Baking::BakesExactly(Transformed(Stroke(3), 0.5, 0.5)), "stroke: width 3 at 0.5 rounds to 2");
+        Check(!Baking::BakesExactly(Transformed(Stroke(2), 2, 1)), "stroke: non-uniform scale is exact");
+
+        const auto baked = Baking::Bake(Transformed(Stroke(2), 1.5, -1.5));
+        Check(std::get<Path>(*baked.shape).width == 3, "stroke: exact bake has the wrong width");
+    }
+
+    void TestFills()
+    {
+        Check(Baking::BakesExactly(Transformed(Rect{{0, 0, 10, 20}, Red}, 1, 1, 0.3)), "rect: rotated isn't exact");
+        Check(Baking::BakesExactly(Transformed(Rect{{0, 0, 10, 20}, Red}, -1, 1)), "rect: mirrored isn't exact");
+        Check(!Baking::BakesExactly(Transformed(Rect{{0, 0, 10, 20}, Red}, 10, 10)), "rect: scaled outline is exact");
+        Check(!Baking::BakesExactly(Transformed(Circle{5, {0, 0}, Red}, 2, 2)), "circle: scaled outline is exact");
+        Check(!Baking::BakesExactly(Transformed(Circle{5, {0, 0}, Red}, 1, 0.5)), "circle: ellipse is exact");
+        Check(!Baking::BakesExactly(Transformed(FilledPolygon{{{0, 0}, {10, 0}, {0, 10}}, Red}, 0.5, 0.5)),
+              "polygon: scaled outline is exact");
+    }
+
+    void TestGroups()
+    {
+        const auto group = [](Shape child, double childScale, double scaleX, double scaleY)
+        {
+            std::vector<CanvasObject> children;
+            children.push_back(Transformed(std::move(child), childScale, childScale));
+
+            return Transformed(Grouping::BuildGroup(std::move(children)), scaleX, scaleY);
+        };
+
+        Check(Baking::BakesExactly(group(Stroke(1), 1, 2, 2)), "group: whole stroke width under a scale isn't exact");
+        Check(Baking::BakesExactly(group(Rect{{0, 0, 10, 20}, Red}, 0.5, 2, 2)), "group: scales that cancel aren't exact");
+        Check(!Baking::BakesExactly(group(Stroke(1), 1.5, 1, 1)), "group: child stroke rounding is exact");
+        Check(!Baking::BakesExactly(group(Rect{{0, 0, 10, 20}, Red}, 1, 2, 2)), "group: scaled child fill is exact");
+        Check(!Baking::BakesExactly(group(Stroke(2), 1, 2, 1)), "group: non-uniform scale is exact");
+    }
+}
+
+int main()
+{
+    TestStrokes();
+    TestFills();
+    TestGroups();
+
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
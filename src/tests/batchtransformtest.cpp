@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../transforms/batchtransform.h"
+
+// Every SIMD kernel must match the scalar path bit for bit, for every tail length and in place.
+namespace
+{
+    constexpr std::size_t MaxCount = 17;
+    constexpr double Sentinel = -12345.678;
+
+    int failures = 0;
+
+    const char *NameOf(BatchTransform::Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case BatchTransform::Kernel::Scalar:
+            return "Scalar";
+        case BatchTransform::Kernel::SSE2:
+            return "SSE2";
+        case BatchTransform::Kernel::AVX2:
+            return "AVX2";
+        }
+
+        return "?";
+    }
+
+    void Check(bool condition, BatchTransform::Kernel kernel, std::size_t count, const char *what)
+    {
+        if (!condition)
+        {
+            std::fprintf(stderr, "%s, %zu points: %s\n", NameOf(kernel), count, what);
+            failures++;
+        }
+    }
+
+    void TestKernel(BatchTransform::Kernel kernel, const BatchTransform::AffineCoefficients &m, const std::vector<double> &points)
+    {
+        for (std::size_t count = 0; count <= MaxCount; count++)
+        {
+            std::vector<double> expected(2 * count);
+            BatchTransform::TransformPoints(BatchTransform::Kernel::Scalar, m, points.data(), expected.data(), count);
+
+            // one extra point, which the kernel must leave alone
+            std::vector<double> out(2 * (count + 1), Sentinel);
+            BatchTransform::TransformPoints(kernel, m, points.data(), out.data(), count);
+
+            Check(std::memcmp(out.data(), expected.data(), expected.size() * sizeof(double)) == 0, kernel, count, "differs from scalar");
+            Check(out[2 * count] == Sentinel && out[2 * count + 1] == Sentinel, kernel, count, "writes past the end");
+
+            std::vector<double> inPlace(points.begin(), points.begin() + 2 * count);
+            BatchTransform::TransformPoints(kernel, m, inPlace.data(), inPlace.data(), count);
+
+            Check(std::memcmp(inPlace.data(), expected.data(), expected.size() * sizeof(double)) == 0, kernel, count, "differs from scalar in place");
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937_64 random(2024);
+    std::uniform_real_distribution<double> coordinate(-1e6, 1e6);
+    std::uniform_real_distribution<double> coefficient(-4.0, 4.0);
+
+    std::vector<double> points(2 * MaxCount);
+
+    for (auto &value : points)
+    {
+        value = coordinate(random);
+    }
+
+    const BatchTransform::Kernel kernels[] = {BatchTransform::Kernel::Scalar, BatchTransform::Kernel::SSE2, BatchTransform::Kernel::AVX2};
+
+    for (int trial = 0; trial < 100; trial++)
+    {
+        const BatchTransform::AffineCoefficients m{coefficient(random), coefficient(random),
+                                                   coefficient(random), coefficient(random),
+                                                   coordinate(random), coordinate(random)};
+
+        for (const auto kernel : kernels)
+        {
+            if (BatchTransform::IsKernelSupported(kernel))
+            {
+                TestKernel(kernel, m, points);
+            }
+        }
+    }
+
+    for (const auto kernel : kernels)
+    {
+        std::printf("%s: %s\n", NameOf(kernel), BatchTransform::IsKernelSupported(kernel) ? "tested" : "not supported here");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../canvas/canvasobject.h"
+#include "../rendering/shaperasterizer.h"
+
+// The software rasterizer's output is deterministic, so its edges can be checked to the coverage level:
+// filled shapes carry their 1px outline, and the pieces of a stroke meet without overlapping seams.
+namespace
+{
+    constexpr int Size = 64;
+
+    int failures = 0;
+
+    void Check(bool condition, const char *what)
+    {
+        if (!condition)
+        {
+            std::fprintf(stderr, "%s\n", what);
+            failures++;
+        }
+    }
+
+    RgbaImage Render(const Shape &shape, const wxAffineMatrix2D &matrix = {})
+    {
+        RgbaImage image(Size, Size);
+        ScanlineRasterizer rasterizer(Size, Size);
+
+        ShapeRasterizer::Draw(rasterizer, image, shape, matrix);
+        return image;
+    }
+
+    int AlphaAt(const RgbaImage &image, int x, int y)
+    {
+        return image.Row(y)[4 * x + 3];
+    }
+
+    bool IsNear(int value, int expected, int tolerance)
+    {
+        return std::abs(value - expected) <= tolerance;
+    }
+
+    bool IsSame(const RgbaImage &a, const RgbaImage &b, int tolerance)
+    {
+        for (std::size_t i = 0; i < a.pixels.size(); i++)
+        {
+            if (std::abs(a.pixels[i] - b.pixels[i]) > tolerance)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const wxColour Red{255, 0, 0};
+
+    void TestRectOutline()
+    {
+        const auto image = Render(Rect{{10, 10, 20, 20}, Red});
+
+        // the outline reaches half a pixel past the edges, on either side
+        Check(AlphaAt(image, 8, 20) == 0, "rect: covers beyond its outline");
+        Check(IsNear(AlphaAt(image, 9, 20), 128, 1), "rect: left outline isn't half a pixel");
+        Check(AlphaAt(image, 10, 20) == 255, "rect: left edge isn't covered");
+        Check(AlphaAt(image, 29, 20) == 255, "rect: right edge isn't covered");
+        Check(IsNear(AlphaAt(image, 30, 20), 128, 1), "rect: right outline isn't half a pixel");
+        Check(AlphaAt(image, 31, 20) == 0, "rect: covers beyond its outline");
+        Check(IsNear(AlphaAt(image, 20, 9), 128, 1), "rect: top outline isn't half a pixel");
+        Check(IsNear(AlphaAt(image, 20, 30), 128, 1), "rect: bottom outline isn't half a pixel");
+    }
+
+    void TestCircleOutline()
+    {
+        const auto image = Render(Circle{10, {32, 32}, Red});
+
+        // without the outline the edge would stop at x = 42; the flattened arc cuts a little inside
+        Check(AlphaAt(image, 41, 32) == 255, "circle: edge isn't covered");
+        Check(AlphaAt(image, 42, 32) > 64 && AlphaAt(image, 42, 32) < 255, "circle: outline is missing");
+        Check(AlphaAt(image, 43, 32) == 0, "circle: covers beyond its outline");
+    }
+
+    void TestPolygonOrientation()
+    {
+        const std::vector<wxPoint2DDouble> clockwise{{10.25, 10.5}, {40.5, 10.5}, {40.5, 30.75}, {10.25, 30.75}};
+        const std::vector<wxPoint2DDouble> counterClockwise(clockwise.rbegin(), clockwise.rend());
+
+        wxAffineMatrix2D rotation;
+        rotation.Translate(32, 4);
+        rotation.Rotate(0.5);
+
+        const auto a = Render(FilledPolygon{clockwise, Red}, rotation);
+        const auto b = Render(FilledPolygon{counterClockwise, Red}, rotation);
+        const auto rect = Render(Rect{{10.25, 10.5, 30.25, 20.25}, Red}, rotation);
+
+        Check(IsSame(a, b, 1), "polygon: outline depends on the winding");
+        Check(IsSame(a, rect, 1), "polygon: differs from the same rect");
+    }
+
+    // Extra vertices along a straight line must not add coverage where its segments meet
+    void TestStrokeSeams()
+    {
+        const auto whole = Render(Path{{{10, 20.3}, {50, 20.3}}, Red, 6});
+        const auto pieces = Render(Path{{{10, 20.3}, {20, 20.3}, {20, 20.3}, {30, 20.3}, {50, 20.3}}, Red, 6});
+
+        Check(IsSame(whole, pieces, 1), "stroke: joins along a straight line show");
+
+        // the top edge sits at 17.3, so that row is 70% covered away from the caps
+        Check(IsNear(AlphaAt(pieces, 30, 17), 179, 1), "stroke: edge coverage at a join is off");
+    }
+
+    void TestStrokeCorner()
+    {
+        const auto image = Render(Path{{{10, 10}, {40, 10}, {40, 40}}, Red, 6});
+
+        // past the corner the stroke is rounded, not square
+        Check(AlphaAt(image, 42, 7) < 255, "corner: outer join isn't rounded");
+        Check(AlphaAt(image, 41, 8) == 255, "corner: outer join isn't covered");
+        Check(AlphaAt(image, 35, 15) == 0, "corner: inner join covers beyond the stroke");
+        Check(AlphaAt(image, 38, 12) == 255, "corner: inner join isn't covered");
+    }
+}
+
+int main()
+{
+    TestRectOutline();
+    TestCircleOutline();
+    TestPolygonOrientation();
+    TestStrokeSeams();
+    TestStrokeCorner();
+
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
@@ -2,12 +2,16 @@
 
 #include <wx/wx.h>
 
+#include "rendering/renderquality.h"
+#include "rendering/spritecachepolicy.h"
+
 enum class ToolType
 {
     Pen,
     Rect,
     Circle,
-    Transform
+    Transform,
+    Eraser
 };
 
 struct ToolSettings
@@ -18,4 +22,30 @@ struct ToolSettings
     ToolType currentTool{ToolType::Pen};
 
     double selectionHandleWidth; // setup this with FromDIP
+
+    // Moving the selection snaps its bounds to nearby objects' and to the grid, within snapDistance pixels
+    bool snapToObjects{true};
+    bool snapToGrid{false};
+    double gridSpacing{20.0}; // world units
+    double snapDistance;      // setup this with FromDIP
+
+    // Saved objects have their transformations applied to their geometry, except where that would change
+    // their look: scaled fills and ellipses, and strokes that don't scale to a whole width (Bake Selection
+    // and Bake All do approximate them)
+    bool bakeTransformationsOnSave{false};
+
+    RenderQualityPolicy renderQualityPolicy;
+    SpriteCachePolicy spriteCachePolicy;
+
+    // Rasterize the committed objects on a worker thread; only the selection and overlays are drawn on paint
+    bool backgroundRendering{false};
+
+    // Keep rasterized tiles of the committed objects between paints
+    bool tileCaching{true};
+
+    // Undo steps are dropped, oldest first, once they hold more than this
+    std::size_t historyMemoryBudget{64 * 1024 * 1024};
+
+    // Geometry far from the view moves to a cache file while the document's objects hold more than this
+    std::size_t residentGeometryBudget{256 * 1024 * 1024};
 };
\ No newline at end of file
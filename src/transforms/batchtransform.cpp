@@ -0,0 +1,164 @@
+#include "batchtransform.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BATCHTRANSFORM_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(BATCHTRANSFORM_X86) && (defined(__GNUC__) || defined(__clang__))
+#define BATCHTRANSFORM_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BATCHTRANSFORM_TARGET(isa)
+#endif
+
+namespace BatchTransform
+{
+    namespace
+    {
+        void TransformScalar(const AffineCoefficients &m, const double *in, double *out, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                const double x = in[2 * i];
+                const double y = in[2 * i + 1];
+
+                out[2 * i] = x * m.m11 + y * m.m21 + m.tx;
+                out[2 * i + 1] = x * m.m12 + y * m.m22 + m.ty;
+            }
+        }
+
+#ifdef BATCHTRANSFORM_X86
+        BATCHTRANSFORM_TARGET("sse2")
+        void TransformSSE2(const AffineCoefficients &m, const double *in, double *out, std::size_t count)
+        {
+            const __m128d col0 = _mm_setr_pd(m.m11, m.m12);
+            const __m128d col1 = _mm_setr_pd(m.m21, m.m22);
+            const __m128d translation = _mm_setr_pd(m.tx, m.ty);
+
+            for (std::size_t i = 0; i < count; i++)
+            {
+                const __m128d p = _mm_loadu_pd(in + 2 * i);
+                const __m128d xs = _mm_unpacklo_pd(p, p);
+                const __m128d ys = _mm_unpackhi_pd(p, p);
+
+                _mm_storeu_pd(out + 2 * i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(xs, col0), _mm_mul_pd(ys, col1)), translation));
+            }
+        }
+
+        BATCHTRANSFORM_TARGET("avx2")
+        void TransformAVX2(const AffineCoefficients &m, const double *in, double *out, std::size_t count)
+        {
+            // two points per register, four per iteration
+            const __m256d col0 = _mm256_setr_pd(m.m11, m.m12, m.m11, m.m12);
+            const __m256d col1 = _mm256_setr_pd(m.m21, m.m22, m.m21, m.m22);
+            const __m256d translation = _mm256_setr_pd(m.tx, m.ty, m.tx, m.ty);
+
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m256d p0 = _mm256_loadu_pd(in + 2 * i);
+                const __m256d p1 = _mm256_loadu_pd(in + 2 * i + 4);
+
+                const __m256d r0 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_permute_pd(p0, 0x0), col0),
+                                                               _mm256_mul_pd(_mm256_permute_pd(p0, 0xF), col1)),
+                                                 translation);
+                const __m256d r1 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_permute_pd(p1, 0x0), col0),
+                                                               _mm256_mul_pd(_mm256_permute_pd(p1, 0xF), col1)),
+                                                 translation);
+
+                _mm256_storeu_pd(out + 2 * i, r0);
+                _mm256_storeu_pd(out + 2 * i + 4, r1);
+            }
+
+            TransformSSE2(m, in + 2 * i, out + 2 * i, count - i);
+        }
+
+        bool CpuSupportsAVX2()
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            {
+                return false;
+            }
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+
+        Kernel DetectKernel()
+        {
+#ifdef BATCHTRANSFORM_X86
+            return CpuSupportsAVX2() ? Kernel::AVX2 : Kernel::SSE2;
+#else
+            return Kernel::Scalar;
+#endif
+        }
+    }
+
+    Kernel GetActiveKernel()
+    {
+        static const Kernel kernel = DetectKernel();
+        return kernel;
+    }
+
+    bool IsKernelSupported(Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case Kernel::Scalar:
+            return true;
+        case Kernel::SSE2:
+            return GetActiveKernel() != Kernel::Scalar;
+        case Kernel::AVX2:
+            return GetActiveKernel() == Kernel::AVX2;
+        }
+
+        return false;
+    }
+
+    void TransformPoints(Kernel kernel, const AffineCoefficients &m, const double *in, double *out, std::size_t count)
+    {
+        if (!IsKernelSupported(kernel))
+        {
+            kernel = Kernel::Scalar;
+        }
+
+        switch (kernel)
+        {
+#ifdef BATCHTRANSFORM_X86
+        case Kernel::AVX2:
+            TransformAVX2(m, in, out, count);
+            break;
+        case Kernel::SSE2:
+            TransformSSE2(m, in, out, count);
+            break;
+#endif
+        default:
+            TransformScalar(m, in, out, count);
+            break;
+        }
+    }
+
+    void TransformPoints(const AffineCoefficients &m, const double *in, double *out, std::size_t count)
+    {
+        TransformPoints(GetActiveKernel(), m, in, out, count);
+    }
+}
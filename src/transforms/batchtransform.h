@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+// Transforms contiguous spans of interleaved (x, y) double pairs with a 2D affine matrix.
+// The SIMD kernels evaluate exactly the same expression as wxAffineMatrix2D::TransformPoint,
+// so their output is bit-identical to the scalar path.
+namespace BatchTransform
+{
+    struct AffineCoefficients
+    {
+        double m11{1.0}, m12{0.0};
+        double m21{0.0}, m22{1.0};
+        double tx{0.0}, ty{0.0};
+    };
+
+    enum class Kernel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // Uses the fastest kernel supported by the running CPU. `in` and `out` may alias.
+    void TransformPoints(const AffineCoefficients &m, const double *in, double *out, std::size_t count);
+
+    void TransformPoints(Kernel kernel, const AffineCoefficients &m, const double *in, double *out, std::size_t count);
+
+    Kernel GetActiveKernel();
+    bool IsKernelSupported(Kernel kernel);
+}
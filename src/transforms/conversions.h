@@ -5,7 +5,7 @@
 
 namespace TransformWxConversions
 {
-    wxAffineMatrix2D GetMatrix(Transformation t, wxPoint2DDouble scaleCenter, wxPoint2DDouble rotationCenter)
+    inline wxAffineMatrix2D GetMatrix(Transformation t, wxPoint2DDouble scaleCenter, wxPoint2DDouble rotationCenter)
     {
         wxAffineMatrix2D matrix;
 
@@ -22,7 +22,7 @@ namespace TransformWxConversions
         return matrix;
     }
 
-    wxAffineMatrix2D GetInverseMatrix(Transformation t, wxPoint2DDouble scaleCenter, wxPoint2DDouble rotationCenter)
+    inline wxAffineMatrix2D GetInverseMatrix(Transformation t, wxPoint2DDouble scaleCenter, wxPoint2DDouble rotationCenter)
     {
         wxAffineMatrix2D matrix = GetMatrix(t, scaleCenter, rotationCenter);
         matrix.Invert();
@@ -7,4 +7,15 @@ struct Transformation
     double rotationAngle{0.0};
     double scaleX{1.0};
     double scaleY{1.0};
-};
\ No newline at end of file
+};
+
+inline bool operator==(const Transformation &a, const Transformation &b)
+{
+    return a.translationX == b.translationX && a.translationY == b.translationY && a.rotationAngle == b.rotationAngle &&
+           a.scaleX == b.scaleX && a.scaleY == b.scaleY;
+}
+
+inline bool operator!=(const Transformation &a, const Transformation &b)
+{
+    return !(a == b);
+}
\ No newline at end of file
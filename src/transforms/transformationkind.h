@@ -0,0 +1,183 @@
+#pragma once
+
+#include <type_traits>
+#include <wx/graphics.h>
+#include <wx/affinematrix2d.h>
+
+#include "transformation.h"
+#include "conversions.h"
+
+// Most objects are only ever moved, so the full rotate/scale composite is overkill for them.
+// Each kind gets its own specialization of TransformationPath; the general one falls back to the matrix.
+enum class TransformationKind
+{
+    Identity,
+    Translation,
+    TranslationScale,
+    General
+};
+
+namespace TransformationKinds
+{
+    inline TransformationKind Classify(const Transformation &t)
+    {
+        if (t.rotationAngle != 0.0)
+        {
+            return TransformationKind::General;
+        }
+
+        if (t.scaleX != 1.0 || t.scaleY != 1.0)
+        {
+            return TransformationKind::TranslationScale;
+        }
+
+        if (t.translationX != 0.0 || t.translationY != 0.0)
+        {
+            return TransformationKind::Translation;
+        }
+
+        return TransformationKind::Identity;
+    }
+
+    template <TransformationKind Kind>
+    using KindTag = std::integral_constant<TransformationKind, Kind>;
+
+    // Calls f with a KindTag so the callee can instantiate the matching TransformationPath.
+    template <typename F>
+    decltype(auto) Dispatch(const Transformation &t, F &&f)
+    {
+        switch (Classify(t))
+        {
+        case TransformationKind::Identity:
+            return f(KindTag<TransformationKind::Identity>{});
+        case TransformationKind::Translation:
+            return f(KindTag<TransformationKind::Translation>{});
+        case TransformationKind::TranslationScale:
+            return f(KindTag<TransformationKind::TranslationScale>{});
+        default:
+            return f(KindTag<TransformationKind::General>{});
+        }
+    }
+}
+
+// `center` is the pivot for scaling and rotation (the object's bounding box centre).
+template <TransformationKind Kind>
+struct TransformationPath;
+
+template <>
+struct TransformationPath<TransformationKind::Identity>
+{
+    static void Apply(wxGraphicsContext &, const Transformation &, wxPoint2DDouble) {}
+
+    static wxPoint2DDouble ToScreen(const Transformation &, wxPoint2DDouble, wxPoint2DDouble pt) { return pt; }
+    static wxPoint2DDouble ToObject(const Transformation &, wxPoint2DDouble, wxPoint2DDouble pt) { return pt; }
+    static wxPoint2DDouble ToScreenDistance(const Transformation &, wxPoint2DDouble, wxPoint2DDouble v) { return v; }
+    static wxPoint2DDouble ToObjectDistance(const Transformation &, wxPoint2DDouble, wxPoint2DDouble v) { return v; }
+
+    static wxAffineMatrix2D GetMatrix(const Transformation &, wxPoint2DDouble) { return {}; }
+};
+
+template <>
+struct TransformationPath<TransformationKind::Translation>
+{
+    static void Apply(wxGraphicsContext &gc, const Transformation &t, wxPoint2DDouble)
+    {
+        gc.Translate(t.translationX, t.translationY);
+    }
+
+    static wxPoint2DDouble ToScreen(const Transformation &t, wxPoint2DDouble, wxPoint2DDouble pt)
+    {
+        return {pt.m_x + t.translationX, pt.m_y + t.translationY};
+    }
+
+    static wxPoint2DDouble ToObject(const Transformation &t, wxPoint2DDouble, wxPoint2DDouble pt)
+    {
+        return {pt.m_x - t.translationX, pt.m_y - t.translationY};
+    }
+
+    static wxPoint2DDouble ToScreenDistance(const Transformation &, wxPoint2DDouble, wxPoint2DDouble v) { return v; }
+    static wxPoint2DDouble ToObjectDistance(const Transformation &, wxPoint2DDouble, wxPoint2DDouble v) { return v; }
+
+    static wxAffineMatrix2D GetMatrix(const Transformation &t, wxPoint2DDouble)
+    {
+        wxAffineMatrix2D matrix;
+        matrix.Translate(t.translationX, t.translationY);
+        return matrix;
+    }
+};
+
+template <>
+struct TransformationPath<TransformationKind::TranslationScale>
+{
+    static void Apply(wxGraphicsContext &gc, const Transformation &t, wxPoint2DDouble center)
+    {
+        gc.Translate(t.translationX + center.m_x, t.translationY + center.m_y);
+        gc.Scale(t.scaleX, t.scaleY);
+        gc.Translate(-center.m_x, -center.m_y);
+    }
+
+    static wxPoint2DDouble ToScreen(const Transformation &t, wxPoint2DDouble center, wxPoint2DDouble pt)
+    {
+        return {t.translationX + center.m_x + (pt.m_x - center.m_x) * t.scaleX,
+                t.translationY + center.m_y + (pt.m_y - center.m_y) * t.scaleY};
+    }
+
+    static wxPoint2DDouble ToObject(const Transformation &t, wxPoint2DDouble center, wxPoint2DDouble pt)
+    {
+        return {center.m_x + (pt.m_x - t.translationX - center.m_x) / t.scaleX,
+                center.m_y + (pt.m_y - t.translationY - center.m_y) / t.scaleY};
+    }
+
+    static wxPoint2DDouble ToScreenDistance(const Transformation &t, wxPoint2DDouble, wxPoint2DDouble v)
+    {
+        return {v.m_x * t.scaleX, v.m_y * t.scaleY};
+    }
+
+    static wxPoint2DDouble ToObjectDistance(const Transformation &t, wxPoint2DDouble, wxPoint2DDouble v)
+    {
+        return {v.m_x / t.scaleX, v.m_y / t.scaleY};
+    }
+
+    static wxAffineMatrix2D GetMatrix(const Transformation &t, wxPoint2DDouble center)
+    {
+        wxAffineMatrix2D matrix;
+        matrix.Translate(t.translationX + center.m_x, t.translationY + center.m_y);
+        matrix.Scale(t.scaleX, t.scaleY);
+        matrix.Translate(-center.m_x, -center.m_y);
+        return matrix;
+    }
+};
+
+template <>
+struct TransformationPath<TransformationKind::General>
+{
+    static void Apply(wxGraphicsContext &gc, const Transformation &t, wxPoint2DDouble center)
+    {
+        gc.ConcatTransform(gc.CreateMatrix(GetMatrix(t, center)));
+    }
+
+    static wxPoint2DDouble ToScreen(const Transformation &t, wxPoint2DDouble center, wxPoint2DDouble pt)
+    {
+        return GetMatrix(t, center).TransformPoint(pt);
+    }
+
+    static wxPoint2DDouble ToObject(const Transformation &t, wxPoint2DDouble center, wxPoint2DDouble pt)
+    {
+        return TransformWxConversions::GetInverseMatrix(t, center, center).TransformPoint(pt);
+    }
+
+    static wxPoint2DDouble ToScreenDistance(const Transformation &t, wxPoint2DDouble center, wxPoint2DDouble v)
+    {
+        return GetMatrix(t, center).TransformDistance(v);
+    }
+
+    static wxPoint2DDouble ToObjectDistance(const Transformation &t, wxPoint2DDouble center, wxPoint2DDouble v)
+    {
+        return TransformWxConversions::GetInverseMatrix(t, center, center).TransformDistance(v);
+    }
+
+    static wxAffineMatrix2D GetMatrix(const Transformation &t, wxPoint2DDouble center)
+    {
+        return TransformWxConversions::GetMatrix(t, center, center);
+    }
+};
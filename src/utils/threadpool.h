@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool: every worker has its own queue and takes its newest task first, while idle
+// workers steal the oldest tasks of the others. Tasks submitted from a worker stay on that worker's
+// queue, so nested work keeps its data hot in the same core's cache.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned threadCount = DefaultThreadCount())
+    {
+        const unsigned count = std::max(1u, threadCount);
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            queues.push_back(std::make_unique<WorkerQueue>());
+        }
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            workers.emplace_back([this, i]
+                                 { WorkerLoop(i); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+
+        wakeUp.notify_all();
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    template <typename F>
+    auto Submit(F &&f) -> std::future<decltype(f())>
+    {
+        auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::forward<F>(f));
+        auto future = task->get_future();
+
+        Enqueue([task]
+                { (*task)(); });
+
+        return future;
+    }
+
+    // Calls body(begin, end) over [0, count) in chunks of at most `grain` items, on the pool's workers and
+    // the calling thread, and returns once every chunk has run. Chunks are handed out dynamically, so
+    // uneven work balances itself. Safe to call from inside a pool task. `body` must not throw.
+    template <typename F>
+    void ParallelFor(std::size_t count, std::size_t grain, F &&body)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        grain = std::max<std::size_t>(1, grain);
+        const std::size_t chunkCount = (count + grain - 1) / grain;
+
+        if (chunkCount == 1)
+        {
+            body(std::size_t{0}, count);
+            return;
+        }
+
+        struct Progress
+        {
+            std::atomic<std::size_t> nextChunk{0};
+            std::atomic<std::size_t> finishedChunks{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+
+        auto progress = std::make_shared<Progress>();
+
+        // helpers that start after every chunk is claimed return without touching `body`
+        auto run = [progress, chunkCount, count, grain, &body]
+        {
+            for (std::size_t chunk; (chunk = progress->nextChunk++) < chunkCount;)
+            {
+                const std::size_t begin = chunk * grain;
+                body(begin, std::min(count, begin + grain));
+
+                if (++progress->finishedChunks == chunkCount)
+                {
+                    std::lock_guard<std::mutex> lock(progress->mutex);
+                    progress->finished.notify_all();
+                }
+            }
+        };
+
+        const std::size_t helperCount = std::min<std::size_t>(workers.size(), chunkCount - 1);
+
+        for (std::size_t i = 0; i < helperCount; i++)
+        {
+            Enqueue(run);
+        }
+
+        run();
+
+        std::unique_lock<std::mutex> lock(progress->mutex);
+        progress->finished.wait(lock, [&]
+                                { return progress->finishedChunks == chunkCount; });
+    }
+
+    unsigned GetThreadCount() const
+    {
+        return static_cast<unsigned>(workers.size());
+    }
+
+    static unsigned DefaultThreadCount()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // The process-wide pool, one worker per core, started on first use. Rendering shares it rather than
+    // each part starting its own, which would put several busy threads on every core. Its tasks must not
+    // block waiting for other tasks; ParallelFor is fine, as the caller helps run the chunks.
+    static ThreadPool &Shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void Enqueue(std::function<void()> task)
+    {
+        const std::size_t target = currentPool == this ? currentWorker : nextQueue++ % queues.size();
+
+        {
+            // counted before it can be taken, so the count never drops below the queued tasks
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queuedCount++;
+            queues[target]->tasks.push_back(std::move(task));
+        }
+
+        // a worker between checking the count and going to sleep holds this, so it can't miss the wake-up
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+
+        wakeUp.notify_one();
+    }
+
+    bool TryPop(std::size_t index, std::function<void()> &task)
+    {
+        auto &queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty())
+        {
+            return false;
+        }
+
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        queuedCount--;
+
+        return true;
+    }
+
+    bool TrySteal(std::size_t thief, std::function<void()> &task)
+    {
+        for (std::size_t offset = 1; offset < queues.size(); offset++)
+        {
+            auto &queue = *queues[(thief + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                queuedCount--;
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void WorkerLoop(std::size_t index)
+    {
+        currentPool = this;
+        currentWorker = index;
+
+        while (true)
+        {
+            std::function<void()> task;
+
+            if (TryPop(index, task) || TrySteal(index, task))
+            {
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this]
+                        { return stopping || queuedCount > 0; });
+
+            if (stopping && queuedCount == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> nextQueue{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<std::size_t> queuedCount{0};
+    bool stopping{false};
+
+    static inline thread_local const ThreadPool *currentPool{nullptr};
+    static inline thread_local std::size_t currentWorker{0};
+};
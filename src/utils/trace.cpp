@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+namespace
+{
+    constexpr std::size_t BufferCapacity = 1 << 16; // events per thread
+
+    struct Event
+    {
+        const char *name;
+        std::uint64_t start;
+        std::uint64_t end;
+    };
+
+    // Written only by its thread; the count is published after the event, so Flush sees whole events
+    struct Buffer
+    {
+        explicit Buffer(unsigned threadId) : threadId(threadId), events(BufferCapacity) {}
+
+        unsigned threadId;
+        std::vector<Event> events;
+        std::atomic<std::uint64_t> count{0};
+    };
+
+    std::atomic<bool> enabled{false};
+    std::string outputPath;
+    std::chrono::steady_clock::time_point epoch;
+
+    // buffers outlive their threads, so workers that finished early still show up in the trace
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+    Buffer &ThisThreadBuffer()
+    {
+        thread_local Buffer *buffer = nullptr;
+
+        if (!buffer)
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffers.push_back(std::make_unique<Buffer>(static_cast<unsigned>(buffers.size())));
+            buffer = buffers.back().get();
+        }
+
+        return *buffer;
+    }
+
+    // Names are identifiers and literals from the source, but quotes and backslashes would break the JSON
+    void WriteName(std::FILE *file, const char *name)
+    {
+        for (; *name; name++)
+        {
+            if (*name == '"' || *name == '\\')
+            {
+                std::fputc('\\', file);
+            }
+
+            std::fputc(*name, file);
+        }
+    }
+}
+
+namespace Trace
+{
+    void Initialize()
+    {
+        const char *path = std::getenv(EnvironmentVariable);
+
+        if (path && *path)
+        {
+            outputPath = path;
+            epoch = std::chrono::steady_clock::now();
+            enabled.store(true, std::memory_order_release);
+        }
+    }
+
+    bool IsEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void Record(const char *name, std::uint64_t startMicroseconds, std::uint64_t endMicroseconds)
+    {
+        // a scope that began before Flush ends after it; sequentially consistent, see Flush
+        if (!enabled.load())
+        {
+            return;
+        }
+
+        auto &buffer = ThisThreadBuffer();
+        const auto count = buffer.count.load(std::memory_order_relaxed);
+
+        buffer.events[count % BufferCapacity] = {name, startMicroseconds, endMicroseconds};
+        buffer.count.store(count + 1);
+    }
+
+    bool Flush()
+    {
+        if (!IsEnabled())
+        {
+            return true;
+        }
+
+        enabled.store(false);
+
+        std::FILE *file = std::fopen(outputPath.c_str(), "w");
+
+        if (!file)
+        {
+            return false;
+        }
+
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+        bool first = true;
+
+        std::lock_guard<std::mutex> lock(buffersMutex);
+
+        for (const auto &buffer : buffers)
+        {
+            const auto count = buffer->count.load();
+
+            // a full ring has overwritten its oldest events. A Record that saw tracing still on can yet
+            // write one more event, into the slot after the counted ones, which is the oldest of a full
+            // ring; so that one is left out.
+            for (auto i = count - std::min<std::uint64_t>(count, BufferCapacity - 1); i < count; i++)
+            {
+                const auto &event = buffer->events[i % BufferCapacity];
+
+                std::fputs(first ? "\n{\"name\":\"" : ",\n{\"name\":\"", file);
+                WriteName(file, event.name);
+                std::fprintf(file, "\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%u}",
+                             static_cast<unsigned long long>(event.start),
+                             static_cast<unsigned long long>(event.end - event.start), buffer->threadId);
+
+                first = false;
+            }
+        }
+
+        std::fputs("\n]}\n", file);
+
+        return std::fclose(file) == 0;
+    }
+}
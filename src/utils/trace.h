@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+// Scoped trace points, written out as Chrome trace-event JSON (chrome://tracing or ui.perfetto.dev).
+// Tracing is off unless the PAINTAPP_TRACE environment variable names an output file at startup, and
+// while off a trace point costs one relaxed atomic load. Each thread records into its own fixed-size
+// ring buffer without locking, so the newest events of every thread survive however long the session runs.
+namespace Trace
+{
+    constexpr auto EnvironmentVariable = "PAINTAPP_TRACE";
+
+    // Reads the environment variable; call once, before other threads record
+    void Initialize();
+
+    // Writes the recorded events to the output file and stops tracing. Call once, at exit; threads still
+    // running drop their events from then on, and each loses at most the one it was recording.
+    bool Flush();
+
+    bool IsEnabled();
+
+    // `name` must outlive the session, like a string literal
+    void Record(const char *name, std::uint64_t startMicroseconds, std::uint64_t endMicroseconds);
+
+    // Microseconds since Initialize
+    std::uint64_t Now();
+
+    // Times its own lifetime as one complete event
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name)
+            : name(IsEnabled() ? name : nullptr), start(this->name ? Now() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (name)
+            {
+                Record(name, start, Now());
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name;
+        std::uint64_t start;
+    };
+}
@@ -5,18 +5,33 @@
 #include <wx/zipstrm.h>
 #include <wx/wfstream.h>
 
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "shapes/shape.h"
+#include "shapes/styletable.h"
 #include "canvas/canvasobject.h"
+#include "canvas/grouping.h"
+#include "rendering/imagesource.h"
+#include "utils/trace.h"
 #include "transforms/transformation.h"
 
 namespace XmlNodeKeys
 {
     constexpr auto ObjectNodeName = "Object";
+    constexpr auto SharedShapeNodeName = "SharedShape";
+    constexpr auto StylesNodeName = "Styles";
+    constexpr auto StyleNodeName = "Style";
     constexpr auto PathNodeType = "Path";
     constexpr auto RectNodeType = "Rect";
     constexpr auto CircleNodeType = "Circle";
+    constexpr auto PolygonNodeType = "Polygon";
+    constexpr auto GroupNodeType = "Group";
+    constexpr auto ImageNodeType = "Image";
 
     constexpr auto CenterElementNodeName = "Center";
     constexpr auto RectElementNodeName = "Rect";
@@ -29,6 +44,12 @@ namespace XmlNodeKeys
     constexpr auto WidthAttribute = "width";
     constexpr auto HeightAttribute = "height";
     constexpr auto TypeAttribute = "type";
+    constexpr auto KeyAttribute = "key";
+    constexpr auto ShapeAttribute = "shape";
+    constexpr auto StyleAttribute = "style";
+    constexpr auto EntryAttribute = "entry";
+    constexpr auto PixelWidthAttribute = "pixelWidth";
+    constexpr auto PixelHeightAttribute = "pixelHeight";
 
     constexpr auto TransformationNodeName = "Transformation";
     constexpr auto RotationAttribute = "rotation";
@@ -39,18 +60,53 @@ namespace XmlNodeKeys
 
     constexpr auto DocumentNodeName = "PaintDocument";
     constexpr auto VersionAttribute = "version";
-    constexpr auto VersionValue = "1.2";
+    constexpr auto VersionValue = "2.3";
 };
 
+// Entries of the .pxz zip. The preview entries are written first, so readers can stop before the body.
+// Imported images follow the body, each as its own entry in the images/ folder.
+namespace ArchiveEntries
+{
+    constexpr auto DocumentEntryName = "paintdocument.xml";
+    constexpr auto MetadataEntryName = "metadata.xml";
+    constexpr auto ThumbnailEntryName = "thumbnail.png";
+    constexpr auto ImagesFolder = "images/";
+};
+
+// The images a document refers to while it is being saved, one entry each however many objects use them
+struct ImageEntries
+{
+    std::unordered_map<const ImageSource *, std::string> names;
+    std::vector<std::shared_ptr<const ImageSource>> sources;
+
+    const std::string &NameOf(const std::shared_ptr<const ImageSource> &source)
+    {
+        auto [it, inserted] = names.try_emplace(source.get());
+
+        if (inserted)
+        {
+            it->second = ArchiveEntries::ImagesFolder + std::to_string(sources.size()) + "." + source->GetExtension();
+            sources.push_back(source);
+        }
+
+        return it->second;
+    }
+};
+
+// Encoded image entries read from an archive, by entry name
+using EncodedImages = std::unordered_map<std::string, std::vector<unsigned char>>;
+
 struct XmlSerializingVisitor
 {
     wxXmlNode *objectNode;
+    StyleTable &styles;
+    ImageEntries &images;
 
     void operator()(const Circle &circle)
     {
         objectNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::ObjectNodeName);
         objectNode->AddAttribute(XmlNodeKeys::TypeAttribute, XmlNodeKeys::CircleNodeType);
-        objectNode->AddAttribute(XmlNodeKeys::ColorAttribute, circle.color.GetAsString(wxC2S_HTML_SYNTAX));
+        AddStyle(circle.color);
         objectNode->AddAttribute(XmlNodeKeys::RadiusAttribute, wxString::FromDouble(circle.radius));
 
         wxXmlNode *circleNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::CenterElementNodeName);
@@ -64,7 +120,7 @@ struct XmlSerializingVisitor
     {
         objectNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::ObjectNodeName);
         objectNode->AddAttribute(XmlNodeKeys::TypeAttribute, XmlNodeKeys::RectNodeType);
-        objectNode->AddAttribute(XmlNodeKeys::ColorAttribute, rectangle.color.GetAsString(wxC2S_HTML_SYNTAX));
+        AddStyle(rectangle.color);
 
         wxXmlNode *rectNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::RectElementNodeName);
         rectNode->AddAttribute(XmlNodeKeys::XAttribute, wxString::FromDouble(rectangle.rect.m_x));
@@ -80,8 +136,7 @@ struct XmlSerializingVisitor
         objectNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::ObjectNodeName);
 
         objectNode->AddAttribute(XmlNodeKeys::TypeAttribute, XmlNodeKeys::PathNodeType);
-        objectNode->AddAttribute(XmlNodeKeys::ColorAttribute, path.color.GetAsString(wxC2S_HTML_SYNTAX));
-        objectNode->AddAttribute(XmlNodeKeys::WidthAttribute, wxString::FromDouble(path.width));
+        AddStyle(path.color, path.width);
 
         for (const auto &point : path.points)
         {
@@ -91,10 +146,86 @@ struct XmlSerializingVisitor
             objectNode->AddChild(pointNode);
         }
     }
+
+    void operator()(const FilledPolygon &polygon)
+    {
+        objectNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::ObjectNodeName);
+
+        objectNode->AddAttribute(XmlNodeKeys::TypeAttribute, XmlNodeKeys::PolygonNodeType);
+        AddStyle(polygon.color);
+
+        for (const auto &point : polygon.points)
+        {
+            wxXmlNode *pointNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::PointElementNodeName);
+            pointNode->AddAttribute(XmlNodeKeys::XAttribute, wxString::FromDouble(point.m_x));
+            pointNode->AddAttribute(XmlNodeKeys::YAttribute, wxString::FromDouble(point.m_y));
+            objectNode->AddChild(pointNode);
+        }
+    }
+
+    // Children are written like top-level objects, inside the group's node
+    void operator()(const Group &group)
+    {
+        objectNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::ObjectNodeName);
+        objectNode->AddAttribute(XmlNodeKeys::TypeAttribute, XmlNodeKeys::GroupNodeType);
+
+        for (const auto &child : group.children)
+        {
+            XmlSerializingVisitor childVisitor{nullptr, styles, images};
+            std::visit(childVisitor, *child.shape);
+            SerializeTransformation(child.transformation, childVisitor.objectNode);
+
+            objectNode->AddChild(childVisitor.objectNode);
+        }
+    }
+
+    // The pixels go to their own archive entry; the node only names it
+    void operator()(const RasterImage &image)
+    {
+        objectNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::ObjectNodeName);
+        objectNode->AddAttribute(XmlNodeKeys::TypeAttribute, XmlNodeKeys::ImageNodeType);
+        objectNode->AddAttribute(XmlNodeKeys::EntryAttribute, images.NameOf(image.source));
+        objectNode->AddAttribute(XmlNodeKeys::PixelWidthAttribute, std::to_string(image.source->GetWidth()));
+        objectNode->AddAttribute(XmlNodeKeys::PixelHeightAttribute, std::to_string(image.source->GetHeight()));
+
+        wxXmlNode *rectNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::RectElementNodeName);
+        rectNode->AddAttribute(XmlNodeKeys::XAttribute, wxString::FromDouble(image.rect.m_x));
+        rectNode->AddAttribute(XmlNodeKeys::YAttribute, wxString::FromDouble(image.rect.m_y));
+        rectNode->AddAttribute(XmlNodeKeys::WidthAttribute, wxString::FromDouble(image.rect.m_width));
+        rectNode->AddAttribute(XmlNodeKeys::HeightAttribute, wxString::FromDouble(image.rect.m_height));
+
+        objectNode->AddChild(rectNode);
+    }
+
+    // Objects refer to an entry of the document's style table instead of spelling out their colour
+    void AddStyle(const wxColour &colour, int width = 1)
+    {
+        objectNode->AddAttribute(XmlNodeKeys::StyleAttribute, std::to_string(styles.Intern(colour, width)));
+    }
+
+    static void SerializeTransformation(const Transformation &t, wxXmlNode *parentNode)
+    {
+        wxXmlNode *transformationNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::TransformationNodeName);
+
+        transformationNode->AddAttribute(XmlNodeKeys::TranslationXAttribute, wxString::FromDouble(t.translationX));
+        transformationNode->AddAttribute(XmlNodeKeys::TranslationYAttribute, wxString::FromDouble(t.translationY));
+        transformationNode->AddAttribute(XmlNodeKeys::RotationAttribute, wxString::FromDouble(t.rotationAngle));
+
+        transformationNode->AddAttribute(XmlNodeKeys::ScaleXAttribute, wxString::FromDouble(t.scaleX));
+        transformationNode->AddAttribute(XmlNodeKeys::ScaleYAttribute, wxString::FromDouble(t.scaleY));
+
+        parentNode->AddChild(transformationNode);
+    }
 };
 
 struct XmlDeserializingShapeFactory
 {
+    // Image objects take their bytes from `encodedImages`; without it they can't be read
+    explicit XmlDeserializingShapeFactory(EncodedImages *encodedImages = nullptr)
+        : encodedImages(encodedImages)
+    {
+    }
+
     Shape Deserialize(const wxXmlNode *node)
     {
         auto type = node->GetAttribute(XmlNodeKeys::TypeAttribute);
@@ -110,16 +241,141 @@ struct XmlDeserializingShapeFactory
         {
             return DeserializeCircle(node);
         }
+        else if (type == XmlNodeKeys::PolygonNodeType)
+        {
+            return DeserializePolygon(node);
+        }
+        else if (type == XmlNodeKeys::GroupNodeType)
+        {
+            return DeserializeGroup(node);
+        }
+        else if (type == XmlNodeKeys::ImageNodeType)
+        {
+            return DeserializeImage(node);
+        }
 
         throw std::runtime_error("Unknown object type: " + type);
     }
 
+    // Each colour string is parsed once here; the shapes then share the parsed colours
+    void ReadStyles(const wxXmlNode *stylesNode)
+    {
+        styles.clear();
+
+        for (wxXmlNode *node = stylesNode->GetChildren(); node; node = node->GetNext())
+        {
+            if (node->GetName() != XmlNodeKeys::StyleNodeName)
+                continue;
+
+            styles.push_back({wxColour(node->GetAttribute(XmlNodeKeys::ColorAttribute)),
+                              static_cast<int>(wxAtof(node->GetAttribute(XmlNodeKeys::WidthAttribute, "1")))});
+        }
+    }
+
+    static Transformation DeserializeTransformation(const wxXmlNode *objectNode)
+    {
+        Transformation t{};
+        for (wxXmlNode *node = objectNode->GetChildren(); node; node = node->GetNext())
+        {
+            if (node->GetName() != XmlNodeKeys::TransformationNodeName)
+                continue;
+
+            t.translationX = wxAtof(node->GetAttribute(XmlNodeKeys::TranslationXAttribute));
+            t.translationY = wxAtof(node->GetAttribute(XmlNodeKeys::TranslationYAttribute));
+
+            t.rotationAngle = wxAtof(node->GetAttribute(XmlNodeKeys::RotationAttribute));
+
+            t.scaleX = wxAtof(node->GetAttribute(XmlNodeKeys::ScaleXAttribute));
+            t.scaleY = wxAtof(node->GetAttribute(XmlNodeKeys::ScaleYAttribute));
+        }
+
+        return t;
+    }
+
 private:
+    Style ReadStyle(const wxXmlNode *node) const
+    {
+        if (wxString index; node->GetAttribute(XmlNodeKeys::StyleAttribute, &index))
+        {
+            unsigned long i = 0;
+
+            if (!index.ToULong(&i) || i >= styles.size())
+            {
+                throw std::runtime_error("Unknown style: " + index);
+            }
+
+            return styles[i];
+        }
+
+        // documents before 2.2 spell the style out on every object
+        return {wxColour(node->GetAttribute(XmlNodeKeys::ColorAttribute)), static_cast<int>(wxAtof(node->GetAttribute(XmlNodeKeys::WidthAttribute)))};
+    }
+
+    Group DeserializeGroup(const wxXmlNode *node)
+    {
+        std::vector<CanvasObject> children;
+
+        for (wxXmlNode *childNode = node->GetChildren(); childNode; childNode = childNode->GetNext())
+        {
+            if (childNode->GetName() != XmlNodeKeys::ObjectNodeName)
+                continue;
+
+            children.emplace_back(Deserialize(childNode), DeserializeTransformation(childNode));
+        }
+
+        if (children.empty())
+        {
+            throw std::runtime_error("Empty group");
+        }
+
+        return Grouping::BuildGroup(std::move(children));
+    }
+
+    // Objects using the same entry share one source, which decodes the pixels on first draw
+    RasterImage DeserializeImage(const wxXmlNode *node)
+    {
+        const auto name = node->GetAttribute(XmlNodeKeys::EntryAttribute).ToStdString();
+        auto &source = images[name];
+
+        if (!source)
+        {
+            auto encoded = encodedImages ? encodedImages->find(name) : EncodedImages::iterator{};
+
+            if (!encodedImages || encoded == encodedImages->end())
+            {
+                throw std::runtime_error("Missing image: " + name);
+            }
+
+            const auto extension = name.substr(name.find_last_of('.') + 1);
+            const int width = wxAtoi(node->GetAttribute(XmlNodeKeys::PixelWidthAttribute));
+            const int height = wxAtoi(node->GetAttribute(XmlNodeKeys::PixelHeightAttribute));
+
+            if (width <= 0 || height <= 0)
+            {
+                throw std::runtime_error("Bad image size: " + name);
+            }
+
+            source = std::make_shared<const ImageSource>(std::move(encoded->second), extension, width, height);
+        }
+
+        RasterImage object{source, {}};
+
+        const wxXmlNode *rectNode = node->GetChildren();
+        object.rect.m_x = wxAtof(rectNode->GetAttribute(XmlNodeKeys::XAttribute));
+        object.rect.m_y = wxAtof(rectNode->GetAttribute(XmlNodeKeys::YAttribute));
+        object.rect.m_width = wxAtof(rectNode->GetAttribute(XmlNodeKeys::WidthAttribute));
+        object.rect.m_height = wxAtof(rectNode->GetAttribute(XmlNodeKeys::HeightAttribute));
+
+        return object;
+    }
+
     Path DeserializePath(const wxXmlNode *node)
     {
+        const auto style = ReadStyle(node);
+
         Path object{};
-        object.color = wxColor(node->GetAttribute(XmlNodeKeys::ColorAttribute));
-        object.width = wxAtof(node->GetAttribute(XmlNodeKeys::WidthAttribute));
+        object.color = style.colour;
+        object.width = style.width;
         object.points = {};
 
         for (wxXmlNode *pointNode = node->GetChildren(); pointNode; pointNode = pointNode->GetNext())
@@ -134,11 +390,28 @@ private:
         return object;
     }
 
+    FilledPolygon DeserializePolygon(const wxXmlNode *node)
+    {
+        FilledPolygon object{};
+        object.color = ReadStyle(node).colour;
+
+        for (wxXmlNode *pointNode = node->GetChildren(); pointNode; pointNode = pointNode->GetNext())
+        {
+            if (pointNode->GetName() != XmlNodeKeys::PointElementNodeName)
+                continue;
+
+            object.points.push_back(wxPoint2DDouble(wxAtof(pointNode->GetAttribute(XmlNodeKeys::XAttribute)),
+                                                    wxAtof(pointNode->GetAttribute(XmlNodeKeys::YAttribute))));
+        }
+
+        return object;
+    }
+
     Circle DeserializeCircle(const wxXmlNode *node)
     {
         Circle object{};
 
-        object.color.Set(node->GetAttribute(XmlNodeKeys::ColorAttribute));
+        object.color = ReadStyle(node).colour;
         object.radius = wxAtof(node->GetAttribute(XmlNodeKeys::RadiusAttribute));
 
         const wxXmlNode *centerNode = node->GetChildren();
@@ -151,7 +424,7 @@ private:
     Rect DeserializeRect(const wxXmlNode *node)
     {
         Rect object;
-        object.color.Set(node->GetAttribute(XmlNodeKeys::ColorAttribute));
+        object.color = ReadStyle(node).colour;
 
         const wxXmlNode *rectNode = node->GetChildren();
         object.rect.m_x = wxAtof(rectNode->GetAttribute(XmlNodeKeys::XAttribute));
@@ -161,6 +434,11 @@ private:
 
         return object;
     }
+
+    std::vector<Style> styles;
+
+    EncodedImages *encodedImages;
+    std::unordered_map<std::string, std::shared_ptr<const ImageSource>> images;
 };
 
 struct XmlSerializer
@@ -170,94 +448,183 @@ struct XmlSerializer
         wxFileSystem::AddHandler(new wxZipFSHandler);
     }
 
-    wxXmlDocument SerializeCanvasObjects(const std::vector<CanvasObject> &objects)
+    // Hands each object to `use` in document order, with its geometry in memory while `use` runs; returns
+    // false if it couldn't hand over all of them
+    using ObjectSource = std::function<bool(const std::function<void(const CanvasObject &)> &use)>;
+
+    // Geometry used by several objects (pasted or duplicated instances, which keep their id) is written
+    // once, as a SharedShape node ahead of the objects, and the objects refer to it by key. Likewise every
+    // distinct colour and width pair is written once, in the Styles node that opens the document. Images
+    // are collected in `images`, for WriteImageEntries to store next to the document.
+    //
+    // Only the ids of `objects` are read here; `source` hands the same objects over again with their
+    // geometry, so not all of it has to be in memory at once. Returns false, leaving `doc` alone, if the
+    // source fails.
+    bool SerializeCanvasObjects(const std::vector<CanvasObject> &objects, const ObjectSource &source,
+                                ImageEntries &images, wxXmlDocument &doc)
     {
-        wxXmlDocument doc;
+        Trace::Scope scope("XmlSerializer::SerializeCanvasObjects");
 
         wxXmlNode *docNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::DocumentNodeName);
         docNode->AddAttribute(XmlNodeKeys::VersionAttribute, XmlNodeKeys::VersionValue);
 
-        XmlSerializingVisitor visitor;
+        // filled in once the objects have interned their styles
+        wxXmlNode *stylesNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::StylesNodeName);
+        docNode->AddChild(stylesNode);
+
+        StyleTable styles;
+        XmlSerializingVisitor visitor{nullptr, styles, images};
+
+        std::unordered_map<std::uint64_t, std::size_t> useCounts;
 
         for (const auto &obj : objects)
         {
-            std::visit(visitor, obj.shape);
-            SerializeTransformation(obj.transformation, visitor.objectNode);
-
-            docNode->AddChild(visitor.objectNode);
+            useCounts[obj.id]++;
         }
 
-        doc.SetRoot(docNode);
+        // shared shapes go after the last one, objects at the end; both without walking the children
+        std::unordered_map<std::uint64_t, wxString> sharedKeys;
+        wxXmlNode *lastShared = stylesNode;
+        wxXmlNode *last = stylesNode;
 
-        return doc;
-    }
+        const auto add = [&](const CanvasObject &obj)
+        {
+            if (useCounts[obj.id] > 1)
+            {
+                auto [shared, added] = sharedKeys.try_emplace(obj.id, std::to_string(sharedKeys.size()));
 
-    void SerializeTransformation(const Transformation &t, wxXmlNode *parentNode)
-    {
-        wxXmlNode *transformationNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::TransformationNodeName);
+                if (added)
+                {
+                    std::visit(visitor, *obj.shape);
+                    visitor.objectNode->SetName(XmlNodeKeys::SharedShapeNodeName);
+                    visitor.objectNode->AddAttribute(XmlNodeKeys::KeyAttribute, shared->second);
 
-        transformationNode->AddAttribute(XmlNodeKeys::TranslationXAttribute, wxString::FromDouble(t.translationX));
-        transformationNode->AddAttribute(XmlNodeKeys::TranslationYAttribute, wxString::FromDouble(t.translationY));
-        transformationNode->AddAttribute(XmlNodeKeys::RotationAttribute, wxString::FromDouble(t.rotationAngle));
+                    docNode->InsertChildAfter(visitor.objectNode, lastShared);
+                    last = last == lastShared ? visitor.objectNode : last;
+                    lastShared = visitor.objectNode;
+                }
 
-        transformationNode->AddAttribute(XmlNodeKeys::ScaleXAttribute, wxString::FromDouble(t.scaleX));
-        transformationNode->AddAttribute(XmlNodeKeys::ScaleYAttribute, wxString::FromDouble(t.scaleY));
+                visitor.objectNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::ObjectNodeName);
+                visitor.objectNode->AddAttribute(XmlNodeKeys::ShapeAttribute, shared->second);
+            }
+            else
+            {
+                std::visit(visitor, *obj.shape);
+            }
 
-        parentNode->AddChild(transformationNode);
+            XmlSerializingVisitor::SerializeTransformation(obj.transformation, visitor.objectNode);
+
+            docNode->InsertChildAfter(visitor.objectNode, last);
+            last = visitor.objectNode;
+        };
+
+        if (!source(add))
+        {
+            delete docNode;
+            return false;
+        }
+
+        for (std::size_t i = 0; i < styles.Size(); i++)
+        {
+            wxXmlNode *styleNode = new wxXmlNode(wxXML_ELEMENT_NODE, XmlNodeKeys::StyleNodeName);
+            styleNode->AddAttribute(XmlNodeKeys::ColorAttribute, styles[i].colour.GetAsString(wxC2S_HTML_SYNTAX));
+            styleNode->AddAttribute(XmlNodeKeys::WidthAttribute, std::to_string(styles[i].width));
+
+            stylesNode->AddChild(styleNode);
+        }
+
+        doc.SetRoot(docNode);
+
+        return true;
     }
 
-    std::vector<CanvasObject> DeserializeCanvasObjects(const wxXmlDocument &doc)
+    // Takes the bytes of the images it uses out of `images`
+    std::vector<CanvasObject> DeserializeCanvasObjects(const wxXmlDocument &doc, EncodedImages &images)
     {
+        Trace::Scope scope("XmlSerializer::DeserializeCanvasObjects");
+
         wxXmlNode *root = doc.GetRoot();
 
         std::vector<CanvasObject> objects;
 
-        XmlDeserializingShapeFactory shapeFactory{};
+        XmlDeserializingShapeFactory shapeFactory{&images};
+
+        // instances copy these, so they share the geometry (and its bounding box) again after loading
+        std::unordered_map<std::string, CanvasObject> sharedShapes;
 
         for (wxXmlNode *node = root->GetChildren(); node; node = node->GetNext())
         {
+            if (node->GetName() == XmlNodeKeys::StylesNodeName)
+            {
+                shapeFactory.ReadStyles(node);
+                continue;
+            }
+
+            if (node->GetName() == XmlNodeKeys::SharedShapeNodeName)
+            {
+                sharedShapes.insert_or_assign(node->GetAttribute(XmlNodeKeys::KeyAttribute).ToStdString(), CanvasObject{shapeFactory.Deserialize(node)});
+                continue;
+            }
+
             if (node->GetName() != XmlNodeKeys::ObjectNodeName)
                 continue;
 
-            Shape shape = shapeFactory.Deserialize(node);
-            auto transformation = DeserializeTransformation(node);
+            auto transformation = XmlDeserializingShapeFactory::DeserializeTransformation(node);
+
+            if (wxString key; node->GetAttribute(XmlNodeKeys::ShapeAttribute, &key))
+            {
+                auto shared = sharedShapes.find(key.ToStdString());
+
+                if (shared == sharedShapes.end())
+                {
+                    throw std::runtime_error("Unknown shared shape: " + key);
+                }
 
-            objects.emplace_back(shape, transformation);
+                objects.push_back(shared->second);
+                objects.back().transformation = transformation;
+            }
+            else
+            {
+                objects.emplace_back(shapeFactory.Deserialize(node), transformation);
+            }
         }
 
         return objects;
     }
 
-    Transformation DeserializeTransformation(wxXmlNode *objectNode)
+    void CompressXml(const wxXmlDocument &doc, wxOutputStream &outStream)
     {
-        Transformation t{};
-        for (wxXmlNode *node = objectNode->GetChildren(); node; node = node->GetNext())
-        {
-            if (node->GetName() != XmlNodeKeys::TransformationNodeName)
-                continue;
-
-            t.translationX = wxAtof(node->GetAttribute(XmlNodeKeys::TranslationXAttribute));
-            t.translationY = wxAtof(node->GetAttribute(XmlNodeKeys::TranslationYAttribute));
-
-            t.rotationAngle = wxAtof(node->GetAttribute(XmlNodeKeys::RotationAttribute));
+        wxZipOutputStream zip(outStream);
 
-            t.scaleX = wxAtof(node->GetAttribute(XmlNodeKeys::ScaleXAttribute));
-            t.scaleY = wxAtof(node->GetAttribute(XmlNodeKeys::ScaleYAttribute));
-        }
+        WriteXmlEntry(doc, zip);
 
-        return t;
+        zip.Close();
     }
 
-    void CompressXml(const wxXmlDocument &doc, wxOutputStream &outStream)
+    void WriteXmlEntry(const wxXmlDocument &doc, wxZipOutputStream &zip)
     {
-        wxZipOutputStream zip(outStream);
+        Trace::Scope scope("XmlSerializer::WriteXmlEntry");
 
-        zip.PutNextEntry("paintdocument.xml");
+        zip.PutNextEntry(ArchiveEntries::DocumentEntryName);
         doc.Save(zip);
 
         zip.CloseEntry();
+    }
 
-        zip.Close();
+    // Encoded images are stored as they are: compressing PNG or JPEG data again gains next to nothing
+    void WriteImageEntries(const ImageEntries &images, wxZipOutputStream &zip)
+    {
+        Trace::Scope scope("XmlSerializer::WriteImageEntries");
+
+        for (const auto &source : images.sources)
+        {
+            auto entry = new wxZipEntry(images.names.at(source.get()));
+            entry->SetMethod(wxZIP_METHOD_STORE);
+
+            zip.PutNextEntry(entry);
+            zip.Write(source->GetEncoded().data(), source->GetEncoded().size());
+            zip.CloseEntry();
+        }
     }
 
     void CompressXml(const wxXmlDocument &doc, const wxString &zipFile)
@@ -268,22 +635,26 @@ struct XmlSerializer
         outStream.Close();
     }
 
-    wxXmlDocument DecompressXml(wxInputStream &in)
+    // Reads the document and the image entries after it into `images`
+    wxXmlDocument DecompressXml(wxInputStream &in, EncodedImages &images)
     {
+        Trace::Scope scope("XmlSerializer::DecompressXml");
+
         wxXmlDocument doc;
         wxZipInputStream zipIn(in);
         std::unique_ptr<wxZipEntry> entry(zipIn.GetNextEntry());
 
         while (entry)
         {
-            wxString entryName = entry->GetName();
+            wxString entryName = entry->GetName(wxPATH_UNIX);
 
-            if (entryName == "paintdocument.xml" && zipIn.CanRead())
+            if (entryName == ArchiveEntries::DocumentEntryName && zipIn.CanRead())
             {
                 doc.Load(zipIn);
-                zipIn.CloseEntry();
-
-                break;
+            }
+            else if (entryName.StartsWith(ArchiveEntries::ImagesFolder))
+            {
+                images[entryName.ToStdString()] = ReadEntry(zipIn);
             }
 
             zipIn.CloseEntry();
@@ -293,10 +664,25 @@ struct XmlSerializer
         return doc;
     }
 
+    static std::vector<unsigned char> ReadEntry(wxInputStream &in)
+    {
+        std::vector<unsigned char> bytes;
+        unsigned char buffer[64 * 1024];
+
+        while (in.Read(buffer, sizeof(buffer)).LastRead() > 0)
+        {
+            bytes.insert(bytes.end(), buffer, buffer + in.LastRead());
+        }
+
+        return bytes;
+    }
+
     wxXmlDocument DecompressXml(const wxString &in)
     {
+        Trace::Scope scope("XmlSerializer::DecompressXml");
+
         wxFileSystem fs;
-        std::unique_ptr<wxFSFile> zip(fs.OpenFile(in + "#zip:paintdocument.xml"));
+        std::unique_ptr<wxFSFile> zip(fs.OpenFile(in + "#zip:" + ArchiveEntries::DocumentEntryName));
 
         wxXmlDocument doc;
 